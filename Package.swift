@@ -24,10 +24,21 @@ let package = Package(
 				.headerSearchPath("MACLib"),
 				.headerSearchPath("Shared"),
 			]),
+		// Round trip checks of MAC, written in C++ and exported as C functions for the tests.
+		.target(
+			name: "MACTestSupport",
+			dependencies: [
+				"MAC",
+			],
+			path: "Tests/MACTestSupport",
+			cSettings: [
+				.define("PLATFORM_APPLE"),
+			]),
 		.testTarget(
 			name: "CXXMonkeysAudioTests",
 			dependencies: [
 				"MAC",
+				"MACTestSupport",
 			]),
 	]
 )
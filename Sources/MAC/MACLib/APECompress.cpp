@@ -31,10 +31,15 @@ CAPECompress::~CAPECompress()
 
 int CAPECompress::SetNumberOfThreads(int nThreads)
 {
-    m_nThreads = APE_CAP(nThreads, 1, 32);
+    m_nThreads = APE_CAP(nThreads, 1, APE_MAXIMUM_THREADS);
     return m_nThreads;
 }
 
+int CAPECompress::SetEncodeMode(int nMode)
+{
+    return m_spAPECompressCreate->SetEncodeMode(nMode);
+}
+
 int CAPECompress::Start(const wchar_t * pOutputFilename, const WAVEFORMATEX * pwfeInput, bool bFloat, int64 nMaxAudioBytes, int nCompressionLevel, const void * pHeaderData, int64 nHeaderBytes, int nFlags)
 {
     m_spioOutput.Delete();
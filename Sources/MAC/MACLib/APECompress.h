@@ -19,6 +19,7 @@ public:
 
     // configuration
     int SetNumberOfThreads(int nThreads);
+    int SetEncodeMode(int nMode) APE_OVERRIDE;
 
     // start encoding
     int Start(const wchar_t * pOutputFilename, const WAVEFORMATEX * pwfeInput, bool bFloat, int64 nMaxAudioBytes, int nCompressionLevel = APE_COMPRESSION_LEVEL_NORMAL, const void * pHeaderData = APE_NULL, int64 nHeaderBytes = CREATE_WAV_HEADER_ON_DECOMPRESSION, int nFlags = 0) APE_OVERRIDE;
@@ -3,23 +3,131 @@
 #include "BitArray.h"
 #include "Prepare.h"
 #include "NewPredictor.h"
+#include "APECompressCreate.h"
 
 #ifdef APE_SUPPORT_COMPRESS
 
 namespace APE
 {
 
-CAPECompressCore::CAPECompressCore(const WAVEFORMATEX * pwfeInput, int nMaxFrameBlocks, int nCompressionLevel)
-: m_semProcess(1), m_semReady(1)
+// how many blocks are predicted per pass when the channels are predicted in parallel
+#define ENCODE_BLOCKS_PER_PASS 4096
+
+// the most threads (counting the core's own) that share the prediction of a pass
+#define ENCODE_CHANNEL_THREADS 4
+
+// the predictor call interleaved encoding makes for each value, bound at compile time for the class itself
+template <class PREDICTOR> static __forceinline int64 CompressValue(IPredictorCompress * pPredictor, int nA, int nB = 0)
+{
+    return static_cast<PREDICTOR *>(pPredictor)->PREDICTOR::CompressValue(nA, nB);
+}
+
+/**************************************************************************************************
+CAPECompressFrame
+**************************************************************************************************/
+CAPECompressFrame::CAPECompressFrame(int nMaxInputBytes)
+: m_semReady(1)
+{
+    m_semReady.Wait();
+
+    m_spInputData.Assign(new unsigned char [static_cast<size_t>(nMaxInputBytes)], true);
+    m_nInputBytes = 0;
+    m_nErrorState = ERROR_SUCCESS;
+    m_spBitArray.Assign(new CBitArray(static_cast<uint32>(nMaxInputBytes / 4 * 3)));
+}
+
+/**************************************************************************************************
+CAPECompressChannelWorker
+**************************************************************************************************/
+CAPECompressChannelWorker::CAPECompressChannelWorker(CAPECompressCore * pCore, CWorkerPool * pWorkerPool)
+: m_semProcess(1), m_semDone(1)
+{
+    m_semProcess.Wait();
+    m_semDone.Wait();
+
+    m_pWorkerPool = pWorkerPool;
+    m_pCore = pCore;
+    APE_CLEAR(m_aryChannels);
+    m_nChannels = 0;
+    m_nStart = 0;
+    m_nBlocks = 0;
+    m_bExit = false;
+}
+
+CAPECompressChannelWorker::~CAPECompressChannelWorker()
+{
+    // stop the thread (or wait for a pass running on the worker pool)
+    Exit();
+    Wait();
+    WaitForTask();
+}
+
+void CAPECompressChannelWorker::AddChannel(int nChannel)
+{
+    m_aryChannels[m_nChannels++] = nChannel;
+}
+
+void CAPECompressChannelWorker::Compress(int nStart, int nBlocks)
+{
+    m_nStart = nStart;
+    m_nBlocks = nBlocks;
+
+    if (m_pWorkerPool != APE_NULL)
+        m_pWorkerPool->Submit(this);
+    else
+        m_semProcess.Post();
+}
+
+void CAPECompressChannelWorker::WaitForCompress()
+{
+    if (m_pWorkerPool != APE_NULL)
+        m_pWorkerPool->WaitForTask(this);
+    else
+        m_semDone.Wait();
+    m_nChannels = 0;
+}
+
+void CAPECompressChannelWorker::Exit()
+{
+    m_bExit = true;
+
+    m_semProcess.Post();
+}
+
+void CAPECompressChannelWorker::Run()
+{
+    while (true)
+    {
+        m_semProcess.Wait();
+
+        if (m_bExit) break;
+
+        RunTask();
+
+        m_semDone.Post();
+    }
+}
+
+void CAPECompressChannelWorker::RunTask()
+{
+    for (int z = 0; z < m_nChannels; z++)
+        m_pCore->CompressChannel(m_aryChannels[z], m_nStart, m_nBlocks);
+    m_pCore->FilterChannels(m_aryChannels, m_nChannels, m_nBlocks);
+}
+
+/**************************************************************************************************
+CAPECompressCore
+**************************************************************************************************/
+CAPECompressCore::CAPECompressCore(CAPECompressCreate * pCompress, const WAVEFORMATEX * pwfeInput, int nMaxFrameBlocks, int nCompressionLevel, CWorkerPool * pWorkerPool)
+: m_semProcess(1)
 {
     m_semProcess.Wait();
 
     APE_CLEAR(m_wfeInput);
     APE_CLEAR(m_aryBitArrayStates);
+    m_pCompress = pCompress;
+    m_pBitArray = APE_NULL;
     m_nMaxFrameBlocks = nMaxFrameBlocks;
-    int nDataSize = m_nMaxFrameBlocks * pwfeInput->nChannels * (pwfeInput->wBitsPerSample / 8);
-    m_spInputData.Assign(new unsigned char [static_cast<size_t>(nDataSize)], true);
-    m_spBitArray.Assign(new CBitArray(static_cast<uint32>(nDataSize / 4 * 3)));
     const intn nChannels = APE_MAX(pwfeInput->nChannels, 2);
     m_spData.Assign(new int [static_cast<size_t>(m_nMaxFrameBlocks * nChannels)], true);
     m_spPrepare.Assign(new CPrepare);
@@ -32,15 +140,37 @@ CAPECompressCore::CAPECompressCore(const WAVEFORMATEX * pwfeInput, int nMaxFrame
             m_aryPredictors[nChannel] = new CPredictorCompressNormal<int64, int>(nCompressionLevel, pwfeInput->wBitsPerSample);
     }
     memcpy(&m_wfeInput, pwfeInput, sizeof(WAVEFORMATEX));
-    m_nInputBytes = 0;
+    m_pWorkerPool = pWorkerPool;
     m_bExit = false;
+
+    // parallel channels predicts a pass of every channel into its own buffer, with our share of the
+    // channels predicted here and the rest on the channel workers (tasks on the worker pool if we're on
+    // it, so they come out of its thread budget, or threads of their own)
+    m_nEncodeMode = pCompress->GetEncodeMode();
+    m_nChannelWorkers = 0;
+    m_bStereoPair = false;
+    if (m_nEncodeMode == APE_ENCODE_MODE_PARALLEL_CHANNELS)
+    {
+        m_sparyResiduals.Assign(new int64 [static_cast<size_t>(nChannels * ENCODE_BLOCKS_PER_PASS)], true);
+        for (m_nChannelWorkers = 0; m_nChannelWorkers < APE_MIN(pwfeInput->nChannels, ENCODE_CHANNEL_THREADS) - 1; m_nChannelWorkers++)
+        {
+            m_spChannelWorkers[m_nChannelWorkers].Assign(new CAPECompressChannelWorker(this, m_pWorkerPool));
+            if (m_pWorkerPool == APE_NULL)
+                m_spChannelWorkers[m_nChannelWorkers]->Start();
+        }
+    }
 }
 
 CAPECompressCore::~CAPECompressCore()
 {
-    // stop any threading
+    // stop any threading (or wait for a frame running on the worker pool)
     Exit();
     Wait();
+    WaitForTask();
+
+    // stop the channel workers
+    for (int z = 0; z < m_nChannelWorkers; z++)
+        m_spChannelWorkers[z].Delete();
 
     // delete the predictors
     for (int z = 0; z < APE_MAXIMUM_CHANNELS; z++)
@@ -58,22 +188,34 @@ void CAPECompressCore::Run()
 
         if (m_bExit) break;
 
-        Encode(m_spInputData, m_nInputBytes);
-
-        m_semReady.Post();
+        RunTask();
     }
 }
 
-int CAPECompressCore::EncodeFrame(const void * pInputData, int nInputBytes)
+void CAPECompressCore::RunTask()
 {
-    memcpy(m_spInputData, pInputData, static_cast<size_t>(nInputBytes));
+    // keep taking frames until the encoding queue is empty
+    CAPECompressFrame * pFrame = APE_NULL;
+    while ((pFrame = m_pCompress->GetNextFrame(this)) != APE_NULL)
+        EncodeFrame(pFrame);
+}
 
-    m_nInputBytes = nInputBytes;
+void CAPECompressCore::Wake()
+{
+    if (m_pWorkerPool != APE_NULL)
+        m_pWorkerPool->Submit(this);
+    else
+        m_semProcess.Post();
+}
 
-    m_semProcess.Post();
+void CAPECompressCore::EncodeFrame(CAPECompressFrame * pFrame)
+{
+    // encode straight into the frame's bit array
+    m_pBitArray = pFrame->m_spBitArray;
+    pFrame->m_nErrorState = Encode(pFrame->m_spInputData, pFrame->m_nInputBytes);
+    m_pBitArray = APE_NULL;
 
-    // return success
-    return ERROR_SUCCESS;
+    pFrame->m_semReady.Post();
 }
 
 int CAPECompressCore::Encode(const void * pInputData, int nInputBytes)
@@ -83,7 +225,7 @@ int CAPECompressCore::Encode(const void * pInputData, int nInputBytes)
     int nSpecialCodes = 0;
 
     // start with an initial bit array
-    m_spBitArray->ResetBitArray();
+    m_pBitArray->ResetBitArray();
 
     // do the preparation stage
     RETURN_ON_ERROR(Prepare(pInputData, nInputBytes, &nSpecialCodes))
@@ -92,12 +234,40 @@ int CAPECompressCore::Encode(const void * pInputData, int nInputBytes)
     {
         if (m_aryPredictors[z] != APE_NULL)
             m_aryPredictors[z]->Flush();
-        m_spBitArray->FlushState(m_aryBitArrayStates[z]);
+        m_pBitArray->FlushState(m_aryBitArrayStates[z]);
     }
 
-    m_spBitArray->FlushBitArray();
+    m_pBitArray->FlushBitArray();
 
     // encode data
+    if (m_nEncodeMode == APE_ENCODE_MODE_PARALLEL_CHANNELS)
+    {
+        RETURN_ON_ERROR(EncodeBlocksParallel(nInputBlocks, nSpecialCodes))
+    }
+    else
+    {
+        RETURN_ON_ERROR(EncodeBlocksInterleaved(nInputBlocks, nSpecialCodes))
+    }
+
+    m_pBitArray->Finalize();
+    m_pBitArray->AdvanceToByteBoundary();
+
+    // return success
+    return ERROR_SUCCESS;
+}
+
+int CAPECompressCore::EncodeBlocksInterleaved(int nInputBlocks, int nSpecialCodes)
+{
+    // the predictors are created for the bit depth, so they're called directly (each value doesn't make a
+    // virtual call)
+    if (m_wfeInput.wBitsPerSample < 32)
+        return EncodeBlocksInterleaved< CPredictorCompressNormal<int, short> >(nInputBlocks, nSpecialCodes);
+    else
+        return EncodeBlocksInterleaved< CPredictorCompressNormal<int64, int> >(nInputBlocks, nSpecialCodes);
+}
+
+template <class PREDICTOR> int CAPECompressCore::EncodeBlocksInterleaved(int nInputBlocks, int nSpecialCodes)
+{
     if (m_wfeInput.nChannels == 2)
     {
         bool bEncodeX = true;
@@ -120,8 +290,8 @@ int CAPECompressCore::Encode(const void * pInputData, int nInputBytes)
             int nLastX = 0;
             for (int z = 0; z < nInputBlocks; z++)
             {
-                m_spBitArray->EncodeValue(m_aryPredictors[1]->CompressValue(m_spData[m_nMaxFrameBlocks + z], nLastX), m_aryBitArrayStates[1]);
-                m_spBitArray->EncodeValue(m_aryPredictors[0]->CompressValue(m_spData[z], m_spData[m_nMaxFrameBlocks + z]), m_aryBitArrayStates[0]);
+                m_pBitArray->EncodeValue(CompressValue<PREDICTOR>(m_aryPredictors[1], m_spData[m_nMaxFrameBlocks + z], nLastX), m_aryBitArrayStates[1]);
+                m_pBitArray->EncodeValue(CompressValue<PREDICTOR>(m_aryPredictors[0], m_spData[z], m_spData[m_nMaxFrameBlocks + z]), m_aryBitArrayStates[0]);
 
                 nLastX = m_spData[z];
             }
@@ -130,14 +300,14 @@ int CAPECompressCore::Encode(const void * pInputData, int nInputBytes)
         {
             for (int z = 0; z < nInputBlocks; z++)
             {
-                RETURN_ON_ERROR(m_spBitArray->EncodeValue(m_aryPredictors[0]->CompressValue(m_spData[z]), m_aryBitArrayStates[0]))
+                RETURN_ON_ERROR(m_pBitArray->EncodeValue(CompressValue<PREDICTOR>(m_aryPredictors[0], m_spData[z]), m_aryBitArrayStates[0]))
             }
         }
         else if (bEncodeY)
         {
             for (int z = 0; z < nInputBlocks; z++)
             {
-                RETURN_ON_ERROR(m_spBitArray->EncodeValue(m_aryPredictors[1]->CompressValue(m_spData[m_nMaxFrameBlocks + z]), m_aryBitArrayStates[1]))
+                RETURN_ON_ERROR(m_pBitArray->EncodeValue(CompressValue<PREDICTOR>(m_aryPredictors[1], m_spData[m_nMaxFrameBlocks + z]), m_aryBitArrayStates[1]))
             }
         }
     }
@@ -147,7 +317,7 @@ int CAPECompressCore::Encode(const void * pInputData, int nInputBytes)
         {
             for (int z = 0; z < nInputBlocks; z++)
             {
-                RETURN_ON_ERROR(m_spBitArray->EncodeValue(m_aryPredictors[0]->CompressValue(m_spData[z]), m_aryBitArrayStates[0]))
+                RETURN_ON_ERROR(m_pBitArray->EncodeValue(CompressValue<PREDICTOR>(m_aryPredictors[0], m_spData[z]), m_aryBitArrayStates[0]))
             }
         }
     }
@@ -157,26 +327,151 @@ int CAPECompressCore::Encode(const void * pInputData, int nInputBytes)
         {
             for (int nChannel = 0; nChannel < m_wfeInput.nChannels; nChannel++)
             {
-                m_spBitArray->EncodeValue(m_aryPredictors[nChannel]->CompressValue(m_spData[(nChannel * m_nMaxFrameBlocks) + z]), m_aryBitArrayStates[nChannel]);
+                m_pBitArray->EncodeValue(CompressValue<PREDICTOR>(m_aryPredictors[nChannel], m_spData[(nChannel * m_nMaxFrameBlocks) + z]), m_aryBitArrayStates[nChannel]);
             }
         }
     }
 
-    m_spBitArray->Finalize();
-    m_spBitArray->AdvanceToByteBoundary();
+    return ERROR_SUCCESS;
+}
+
+int CAPECompressCore::EncodeBlocksParallel(int nInputBlocks, int nSpecialCodes)
+{
+    // the channels to encode, in the order their values are interleaved in the bitstream (this matches
+    // the interleaved encoding exactly, so the output is the same)
+    int aryChannels[APE_MAXIMUM_CHANNELS];
+    int nChannels = 0;
+    m_bStereoPair = false;
+    if (m_wfeInput.nChannels == 2)
+    {
+        if ((nSpecialCodes & SPECIAL_FRAME_LEFT_SILENCE) && (nSpecialCodes & SPECIAL_FRAME_RIGHT_SILENCE))
+        {
+            // nothing to encode
+        }
+        else if (nSpecialCodes & SPECIAL_FRAME_PSEUDO_STEREO)
+        {
+            aryChannels[nChannels++] = 0;
+        }
+        else
+        {
+            // Y then X, each predicted from the other channel's input (never its output), so they're independent
+            aryChannels[nChannels++] = 1;
+            aryChannels[nChannels++] = 0;
+            m_bStereoPair = true;
+        }
+    }
+    else if (m_wfeInput.nChannels == 1)
+    {
+        if (!(nSpecialCodes & SPECIAL_FRAME_MONO_SILENCE))
+            aryChannels[nChannels++] = 0;
+    }
+    else if (m_wfeInput.nChannels > 2)
+    {
+        for (int nChannel = 0; nChannel < m_wfeInput.nChannels; nChannel++)
+            aryChannels[nChannels++] = nChannel;
+    }
+
+    if (nChannels == 0)
+        return ERROR_SUCCESS;
+
+    // predict a pass of every channel, then range code the pass in order
+    for (int nStart = 0; nStart < nInputBlocks; nStart += ENCODE_BLOCKS_PER_PASS)
+    {
+        const int nBlocks = APE_MIN(nInputBlocks - nStart, ENCODE_BLOCKS_PER_PASS);
+        CompressChannels(aryChannels, nChannels, nStart, nBlocks);
+
+        for (int z = 0; z < nBlocks; z++)
+        {
+            for (int nChannel = 0; nChannel < nChannels; nChannel++)
+            {
+                RETURN_ON_ERROR(m_pBitArray->EncodeValue(m_sparyResiduals[(aryChannels[nChannel] * ENCODE_BLOCKS_PER_PASS) + z], m_aryBitArrayStates[aryChannels[nChannel]]))
+            }
+        }
+    }
 
-    // return success
     return ERROR_SUCCESS;
 }
 
-unsigned char * CAPECompressCore::GetFrameBuffer()
+void CAPECompressCore::CompressChannels(const int * paryChannels, int nChannels, int nStart, int nBlocks)
+{
+    // the channels are dealt out to the channel workers and us
+    const int nThreads = APE_MIN(m_nChannelWorkers + 1, nChannels);
+    for (int z = 0; z < nChannels; z++)
+    {
+        if ((z % nThreads) != 0)
+            m_spChannelWorkers[(z % nThreads) - 1]->AddChannel(paryChannels[z]);
+    }
+    for (int z = 0; z < nThreads - 1; z++)
+        m_spChannelWorkers[z]->Compress(nStart, nBlocks);
+
+    int aryShare[APE_MAXIMUM_CHANNELS];
+    int nShare = 0;
+    for (int z = 0; z < nChannels; z += nThreads)
+    {
+        CompressChannel(paryChannels[z], nStart, nBlocks);
+        aryShare[nShare++] = paryChannels[z];
+    }
+    FilterChannels(aryShare, nShare, nBlocks);
+
+    for (int z = 0; z < nThreads - 1; z++)
+        m_spChannelWorkers[z]->WaitForCompress();
+}
+
+void CAPECompressCore::CompressChannel(int nChannel, int nStart, int nBlocks)
+{
+    // like the interleaved encoding, the predictor is called directly
+    if (m_wfeInput.wBitsPerSample < 32)
+        CompressChannel< CPredictorCompressNormal<int, short> >(nChannel, nStart, nBlocks);
+    else
+        CompressChannel< CPredictorCompressNormal<int64, int> >(nChannel, nStart, nBlocks);
+}
+
+template <class PREDICTOR> void CAPECompressCore::CompressChannel(int nChannel, int nStart, int nBlocks)
 {
-    return m_spBitArray->GetBitArray();
+    PREDICTOR * pPredictor = static_cast<PREDICTOR *>(m_aryPredictors[nChannel]);
+    const int * pInput = &m_spData[(nChannel * m_nMaxFrameBlocks) + nStart];
+    int64 * pOutput = &m_sparyResiduals[nChannel * ENCODE_BLOCKS_PER_PASS];
+
+    if (!m_bStereoPair)
+    {
+        for (int z = 0; z < nBlocks; z++)
+            pOutput[z] = pPredictor->PREDICTOR::CompressPrediction(pInput[z]);
+    }
+    else if (nChannel == 0)
+    {
+        // X is predicted with this block's Y
+        const int * pY = &m_spData[m_nMaxFrameBlocks + nStart];
+        for (int z = 0; z < nBlocks; z++)
+            pOutput[z] = pPredictor->PREDICTOR::CompressPrediction(pInput[z], pY[z]);
+    }
+    else
+    {
+        // Y is predicted with the last block's X
+        const int * pX = &m_spData[nStart];
+        int nLastX = (nStart > 0) ? pX[-1] : 0;
+        for (int z = 0; z < nBlocks; z++)
+        {
+            pOutput[z] = pPredictor->PREDICTOR::CompressPrediction(pInput[z], nLastX);
+            nLastX = pX[z];
+        }
+    }
 }
 
-uint32 CAPECompressCore::GetFrameBytes() const
+void CAPECompressCore::FilterChannels(const int * paryChannels, int nChannels, int nBlocks)
 {
-    return m_spBitArray->GetBitArrayBytes();
+    // the channels' NN filters run together (see IPredictorCompress::CompressFilters(...))
+    if (nChannels <= 0)
+        return;
+
+    IPredictorCompress * aryPredictors[APE_MAXIMUM_CHANNELS];
+    int64 * aryValues[APE_MAXIMUM_CHANNELS];
+    for (int z = 0; z < nChannels; z++)
+    {
+        aryPredictors[z] = m_aryPredictors[paryChannels[z]];
+        aryValues[z] = &m_sparyResiduals[paryChannels[z] * ENCODE_BLOCKS_PER_PASS];
+    }
+
+    aryPredictors[0]->CompressFilters(aryPredictors, aryValues, nChannels, nBlocks);
 }
 
 int CAPECompressCore::Prepare(const void * pInputData, int nInputBytes, int * pSpecialCodes)
@@ -190,22 +485,17 @@ int CAPECompressCore::Prepare(const void * pInputData, int nInputBytes, int * pS
         &nCRC, pSpecialCodes))
 
     // store the CRC
-    RETURN_ON_ERROR(m_spBitArray->EncodeUnsignedLong(nCRC))
+    RETURN_ON_ERROR(m_pBitArray->EncodeUnsignedLong(nCRC))
 
     // store any special codes
     if (*pSpecialCodes != 0)
     {
-        RETURN_ON_ERROR(m_spBitArray->EncodeUnsignedLong(static_cast<unsigned int>(*pSpecialCodes)))
+        RETURN_ON_ERROR(m_pBitArray->EncodeUnsignedLong(static_cast<unsigned int>(*pSpecialCodes)))
     }
 
     return ERROR_SUCCESS;
 }
 
-void CAPECompressCore::WaitUntilReady()
-{
-    m_semReady.Wait();
-}
-
 void CAPECompressCore::Exit()
 {
     m_bExit = true;
@@ -3,6 +3,7 @@
 #include "APECompress.h"
 #include "Thread.h"
 #include "Semaphore.h"
+#include "WorkerPool.h"
 #include "BitArray.h"
 
 #ifdef APE_SUPPORT_COMPRESS
@@ -12,42 +13,110 @@ namespace APE
 
 class CPrepare;
 class IPredictorCompress;
+class CAPECompressCreate;
+class CAPECompressCore;
 
 /**************************************************************************************************
-CAPECompressCore - manages the core of compression and bitstream output
+CAPECompressFrame - a frame in the encoding queue (the input is copied in when the frame is queued,
+and the output is valid once m_semReady is posted)
 **************************************************************************************************/
-class CAPECompressCore : public CThread
+class CAPECompressFrame
 {
 public:
-    CAPECompressCore(const WAVEFORMATEX * pwfeInput, int nMaxFrameBlocks, int nCompressionLevel);
-    ~CAPECompressCore();
+    CAPECompressFrame(int nMaxInputBytes);
 
-    int EncodeFrame(const void * pInputData, int nInputBytes);
-    void WaitUntilReady();
+    // input
+    CSmartPtr<unsigned char> m_spInputData;
+    int m_nInputBytes;
+
+    // results
+    int m_nErrorState;
+    CSmartPtr<CBitArray> m_spBitArray;
+    CSemaphore m_semReady;
+};
+
+/**************************************************************************************************
+CAPECompressChannelWorker - predicts some of the channels of a pass, while the core that owns it does
+the others
+
+It's a thread of its own, or a task on the shared worker pool when the core is (then the core runs it
+itself if no pool thread has taken it by the time it's waited for, so a busy pool can't stall it)
+**************************************************************************************************/
+class CAPECompressChannelWorker : public CThread, public CWorkerPoolTask
+{
+public:
+    CAPECompressChannelWorker(CAPECompressCore * pCore, CWorkerPool * pWorkerPool = APE_NULL);
+    ~CAPECompressChannelWorker();
+
+    void AddChannel(int nChannel);
+    void Compress(int nStart, int nBlocks);
+    void WaitForCompress();
 
     void Exit();
 
-    unsigned char * GetFrameBuffer();
-    uint32 GetFrameBytes() const;
+protected:
+    void Run();
+    void RunTask();
+
+    CSemaphore m_semProcess;
+    CSemaphore m_semDone;
+    CWorkerPool * m_pWorkerPool;
+    CAPECompressCore * m_pCore;
+    int m_aryChannels[APE_MAXIMUM_CHANNELS];
+    int m_nChannels;
+    int m_nStart;
+    int m_nBlocks;
+    bool m_bExit;
+};
+
+/**************************************************************************************************
+CAPECompressCore - manages the core of compression and bitstream output (a worker that encodes
+frames from the encoding queue on its own thread, or on the shared worker pool)
+**************************************************************************************************/
+class CAPECompressCore : public CThread, public CWorkerPoolTask
+{
+public:
+    CAPECompressCore(CAPECompressCreate * pCompress, const WAVEFORMATEX * pwfeInput, int nMaxFrameBlocks, int nCompressionLevel, CWorkerPool * pWorkerPool = APE_NULL);
+    ~CAPECompressCore();
+
+    void Wake();
+    void Exit();
 
 private:
+    friend class CAPECompressChannelWorker;
+
+    void EncodeFrame(CAPECompressFrame * pFrame);
     int Encode(const void * pInputData, int nInputBytes);
+    int EncodeBlocksInterleaved(int nInputBlocks, int nSpecialCodes);
+    template <class PREDICTOR> int EncodeBlocksInterleaved(int nInputBlocks, int nSpecialCodes);
+    int EncodeBlocksParallel(int nInputBlocks, int nSpecialCodes);
+    void CompressChannels(const int * paryChannels, int nChannels, int nStart, int nBlocks);
+    void CompressChannel(int nChannel, int nStart, int nBlocks);
+    template <class PREDICTOR> void CompressChannel(int nChannel, int nStart, int nBlocks);
+    void FilterChannels(const int * paryChannels, int nChannels, int nBlocks);
     int Prepare(const void * pInputData, int nInputBytes, int * pSpecialCodes);
     void Run();
+    void RunTask();
 
     CSemaphore m_semProcess;
-    CSemaphore m_semReady;
 
-    CSmartPtr<CBitArray> m_spBitArray;
+    CAPECompressCreate * m_pCompress;
+    CBitArray * m_pBitArray;
     IPredictorCompress * m_aryPredictors[APE_MAXIMUM_CHANNELS];
     BIT_ARRAY_STATE m_aryBitArrayStates[APE_MAXIMUM_CHANNELS];
     CSmartPtr<int> m_spData;
-    CSmartPtr<unsigned char> m_spInputData;
-    int m_nInputBytes;
     CSmartPtr<CPrepare> m_spPrepare;
     int m_nMaxFrameBlocks;
     WAVEFORMATEX m_wfeInput;
+    CWorkerPool * m_pWorkerPool;
     bool m_bExit;
+
+    // parallel channels
+    int m_nEncodeMode;
+    CSmartPtr<int64> m_sparyResiduals;
+    CSmartPtr<CAPECompressChannelWorker> m_spChannelWorkers[APE_MAXIMUM_CHANNELS];
+    int m_nChannelWorkers;
+    bool m_bStereoPair;
 };
 
 }
@@ -3,6 +3,7 @@
 #include "APECompressCreate.h"
 #include "APECompressCore.h"
 #include "GlobalFunctions.h"
+#include "WorkerPool.h"
 
 #ifdef APE_SUPPORT_COMPRESS
 
@@ -10,12 +11,20 @@ namespace APE
 {
 
 CAPECompressCreate::CAPECompressCreate()
+: m_semFrames(1)
 {
     m_nMaxFrames = 0;
     m_bTooMuchData = false;
 
     m_nThreads = 1;
-    m_nNextWorker = 0;
+    m_nEncodeMode = APE_ENCODE_MODE_INTERLEAVED;
+    m_pWorkerPool = APE_NULL;
+
+    m_nFrameWindow = 0;
+    m_nFrameHead = 0;
+    m_nFramesInFlight = 0;
+    m_nFramesPending = 0;
+    m_nIdleWorkers = 0;
 
     m_nFinalWord = 0;
     m_nFinalBytes = 0;
@@ -30,7 +39,14 @@ CAPECompressCreate::CAPECompressCreate()
 
 CAPECompressCreate::~CAPECompressCreate()
 {
-    // without this the compiler warns that it can't inline the destuctor
+    // if we didn't finish, let the frames being encoded finish before the workers and frames go away
+    CancelFrames();
+
+    for (int i = 0; i < m_nThreads; i++)
+    {
+        if (m_sparyAPECompressCore != APE_NULL)
+            m_sparyAPECompressCore[i].Delete();
+    }
 }
 
 int CAPECompressCreate::Start(CIO * pioOutput, int nThreads, const WAVEFORMATEX * pwfeInput, int64 nMaxAudioBytes, int nCompressionLevel, const void * pHeaderData, int64 nHeaderBytes, int32 nFlags)
@@ -83,13 +99,26 @@ int CAPECompressCreate::Start(CIO * pioOutput, int nThreads, const WAVEFORMATEX
 
     m_spIO.Assign(pioOutput, false, false);
 
-    // create and start threads
-    m_nThreads = nThreads;
+    // use the shared worker pool if it's enabled, otherwise each worker runs its own thread
+    m_pWorkerPool = CWorkerPool::GetShared();
+
+    // create the encoding queue (each worker can have a frame encoding while another waits to be written)
+    m_nThreads = APE_CAP(nThreads, 1, APE_MAXIMUM_THREADS);
+    m_nFrameWindow = 2 * m_nThreads;
 
+    m_sparyFrames.Assign(new CSmartPtr<CAPECompressFrame> [static_cast<size_t>(m_nFrameWindow)], true);
+    for (int i = 0; i < m_nFrameWindow; i++)
+        m_sparyFrames[i].Assign(new CAPECompressFrame(m_nBlocksPerFrame * pwfeInput->nBlockAlign));
+
+    // create and start threads (every worker starts out idle)
+    m_sparyAPECompressCore.Assign(new CSmartPtr<CAPECompressCore> [static_cast<size_t>(m_nThreads)], true);
+    m_sparyIdleWorkers.Assign(new CAPECompressCore * [static_cast<size_t>(m_nThreads)], true);
     for (int i = 0; i < m_nThreads; i++)
     {
-        m_spAPECompressCore[i].Assign(new CAPECompressCore(pwfeInput, m_nBlocksPerFrame, nCompressionLevel));
-        m_spAPECompressCore[i]->Start();
+        m_sparyAPECompressCore[i].Assign(new CAPECompressCore(this, pwfeInput, m_nBlocksPerFrame, nCompressionLevel, m_pWorkerPool));
+        m_sparyIdleWorkers[m_nIdleWorkers++] = m_sparyAPECompressCore[i];
+        if (m_pWorkerPool == APE_NULL)
+            m_sparyAPECompressCore[i]->Start();
     }
 
     m_nFinalWord = 0;
@@ -111,6 +140,19 @@ int CAPECompressCreate::Start(CIO * pioOutput, int nThreads, const WAVEFORMATEX
     return InitializeFile(m_spIO, &m_wfeInput, static_cast<intn>(nMaxFrames), m_nCompressionLevel, pHeaderData, nHeaderBytes, nFlags);
 }
 
+int CAPECompressCreate::SetEncodeMode(int nMode)
+{
+    // the workers pick the mode up when they're created
+    if ((m_sparyAPECompressCore == APE_NULL) && (nMode >= APE_ENCODE_MODE_INTERLEAVED) && (nMode <= APE_ENCODE_MODE_PARALLEL_CHANNELS))
+        m_nEncodeMode = nMode;
+    return m_nEncodeMode;
+}
+
+int CAPECompressCreate::GetEncodeMode() const
+{
+    return m_nEncodeMode;
+}
+
 intn CAPECompressCreate::GetFullFrameBytes() const
 {
     return static_cast<intn>(m_nBlocksPerFrame) * static_cast<intn>(m_wfeInput.nBlockAlign);
@@ -125,23 +167,95 @@ int CAPECompressCreate::EncodeFrame(const void * pInputData, int nInputBytes)
         return ERROR_UNDEFINED; // can only pass a smaller frame for the very last time
     }
 
-    CAPECompressCore * pWorker = m_spAPECompressCore[m_nNextWorker];
+    // when the queue is full, write the oldest frame to make room (the others keep encoding meanwhile)
+    int nResult = ERROR_SUCCESS;
+    if (m_nFramesInFlight == m_nFrameWindow)
+        nResult = CommitFrame();
+
+    // queue the frame and wake a worker if one is idle
+    CAPECompressFrame * pFrame = m_sparyFrames[(m_nFrameHead + m_nFramesInFlight) % m_nFrameWindow];
+    memcpy(pFrame->m_spInputData, pInputData, static_cast<size_t>(nInputBytes));
+    pFrame->m_nInputBytes = nInputBytes;
 
-    // get previously encoded frame
-    pWorker->WaitUntilReady();
+    CAPECompressCore * pWorker = APE_NULL;
 
-    if (pWorker->GetFrameBytes() > 0) WriteFrame(pWorker->GetFrameBuffer(), pWorker->GetFrameBytes());
+    m_semFrames.Wait();
+    m_nFramesInFlight++;
+    m_nFramesPending++;
+    if (m_nIdleWorkers > 0)
+        pWorker = m_sparyIdleWorkers[--m_nIdleWorkers];
+    m_semFrames.Post();
 
-    // encode next frame
-    int nResult = pWorker->EncodeFrame(pInputData, nInputBytes);
+    if (pWorker != APE_NULL)
+        pWorker->Wake();
 
     // update stats
     m_nLastFrameBlocks = nInputBlocks;
-    m_nNextWorker = (m_nNextWorker + 1) % m_nThreads;
 
     return nResult;
 }
 
+CAPECompressFrame * CAPECompressCreate::GetNextFrame(CAPECompressCore * pWorker)
+{
+    CAPECompressFrame * pFrame = APE_NULL;
+
+    m_semFrames.Wait();
+    if (m_nFramesPending > 0)
+    {
+        pFrame = m_sparyFrames[(m_nFrameHead + m_nFramesInFlight - m_nFramesPending) % m_nFrameWindow];
+        m_nFramesPending--;
+    }
+    else
+    {
+        // nothing to do, so wait to be woken by EncodeFrame(...)
+        m_sparyIdleWorkers[m_nIdleWorkers++] = pWorker;
+    }
+    m_semFrames.Post();
+
+    return pFrame;
+}
+
+/**************************************************************************************************
+Write the oldest frame in the encoding queue (waiting for it to finish encoding if necessary)
+**************************************************************************************************/
+int CAPECompressCreate::CommitFrame()
+{
+    CAPECompressFrame * pFrame = m_sparyFrames[m_nFrameHead];
+    pFrame->m_semReady.Wait();
+
+    // running out of seek table is reported through GetTooMuchData()
+    const int nResult = pFrame->m_nErrorState;
+    if (pFrame->m_spBitArray->GetBitArrayBytes() > 0)
+        WriteFrame(pFrame->m_spBitArray->GetBitArray(), pFrame->m_spBitArray->GetBitArrayBytes());
+
+    m_semFrames.Wait();
+    m_nFrameHead = (m_nFrameHead + 1) % m_nFrameWindow;
+    m_nFramesInFlight--;
+    m_semFrames.Post();
+
+    return nResult;
+}
+
+void CAPECompressCreate::CancelFrames()
+{
+    // drop the frames no worker has taken (they're the newest ones in flight)
+    m_semFrames.Wait();
+    m_nFramesInFlight -= m_nFramesPending;
+    m_nFramesPending = 0;
+    m_semFrames.Post();
+
+    // let the frames that are being encoded finish
+    while (m_nFramesInFlight > 0)
+    {
+        m_sparyFrames[m_nFrameHead]->m_semReady.Wait();
+
+        m_semFrames.Wait();
+        m_nFrameHead = (m_nFrameHead + 1) % m_nFrameWindow;
+        m_nFramesInFlight--;
+        m_semFrames.Post();
+    }
+}
+
 int CAPECompressCreate::WriteFrame(unsigned char * pOutputData, uint32 nBytes)
 {
     // update the seek table
@@ -184,19 +298,20 @@ void CAPECompressCreate::FixupFrame(unsigned char * pBuffer, uint32 nBytes, uint
 
 int CAPECompressCreate::Finish(const void * pTerminatingData, int64 nTerminatingBytes, int64 nWAVTerminatingBytes)
 {
-    // wait for worker threads to finish and write remaining frames
-    for (int i = 0; i < m_nThreads; i++)
+    // write the remaining frames in order
+    int nResult = ERROR_SUCCESS;
+    while (m_nFramesInFlight > 0)
     {
-        CAPECompressCore * pWorker = m_spAPECompressCore[m_nNextWorker];
-
-        pWorker->WaitUntilReady();
-
-        if (pWorker->GetFrameBytes() > 0) WriteFrame(pWorker->GetFrameBuffer(), pWorker->GetFrameBytes());
-
-        pWorker->Exit();
-        pWorker->Wait();
+        const int nFrameResult = CommitFrame();
+        if (nResult == ERROR_SUCCESS)
+            nResult = nFrameResult;
+    }
 
-        m_nNextWorker = (m_nNextWorker + 1) % m_nThreads;
+    // finish threads
+    for (int i = 0; i < m_nThreads; i++)
+    {
+        m_sparyAPECompressCore[i]->Exit();
+        m_sparyAPECompressCore[i]->Wait();
     }
 
     // write out final word
@@ -208,7 +323,9 @@ int CAPECompressCreate::Finish(const void * pTerminatingData, int64 nTerminating
     m_spIO->Write(&m_nFinalWord, 4, &nBytesWritten);
 
     // finalize the file
-    return FinalizeFile(m_spIO, m_nFrameIndex, m_nLastFrameBlocks, pTerminatingData, nTerminatingBytes, nWAVTerminatingBytes);
+    RETURN_ON_ERROR(FinalizeFile(m_spIO, m_nFrameIndex, m_nLastFrameBlocks, pTerminatingData, nTerminatingBytes, nWAVTerminatingBytes))
+
+    return nResult;
 }
 
 bool CAPECompressCreate::GetTooMuchData() const
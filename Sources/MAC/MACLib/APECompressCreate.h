@@ -4,10 +4,13 @@
 
 #include "APECompress.h"
 #include "MD5.h"
+#include "Semaphore.h"
 
 namespace APE
 {
 class CAPECompressCore;
+class CAPECompressFrame;
+class CWorkerPool;
 
 class CAPECompressCreate
 {
@@ -22,6 +25,9 @@ public:
 
     int Start(CIO * pioOutput, int nThreads, const WAVEFORMATEX * pwfeInput, int64 nMaxAudioBytes, int nCompressionLevel = APE_COMPRESSION_LEVEL_NORMAL, const void * pHeaderData = APE_NULL, int64 nHeaderBytes = CREATE_WAV_HEADER_ON_DECOMPRESSION, int32 nFlags = 0);
 
+    int SetEncodeMode(int nMode);
+    int GetEncodeMode() const;
+
     intn GetFullFrameBytes() const;
     int EncodeFrame(const void * pInputData, int nInputBytes);
 
@@ -29,15 +35,29 @@ public:
 
     bool GetTooMuchData() const;
 
+    // workers (take the next frame to encode, or go idle if there isn't one)
+    CAPECompressFrame * GetNextFrame(CAPECompressCore * pWorker);
+
 private:
     CSmartPtr<uint32> m_spSeekTable;
     intn m_nMaxFrames;
 
     CSmartPtr<CIO> m_spIO;
-    CSmartPtr<CAPECompressCore> m_spAPECompressCore[32];
+    CSmartPtr<CSmartPtr<CAPECompressCore> > m_sparyAPECompressCore;
+    CWorkerPool * m_pWorkerPool;
 
     int m_nThreads;
-    int m_nNextWorker;
+    int m_nEncodeMode;
+
+    // encoding queue (frames are queued in order, encoded in any order, and written in order)
+    int m_nFrameWindow;
+    CSmartPtr<CSmartPtr<CAPECompressFrame> > m_sparyFrames;
+    int m_nFrameHead;
+    int m_nFramesInFlight;
+    int m_nFramesPending;
+    CSmartPtr<CAPECompressCore *> m_sparyIdleWorkers;
+    int m_nIdleWorkers;
+    CSemaphore m_semFrames;
 
     uint32 m_nFinalWord;
     uint32 m_nFinalBytes;
@@ -52,6 +72,8 @@ private:
     bool m_bTooMuchData;
 
     int WriteFrame(unsigned char * pOutputData, uint32 nBytes);
+    int CommitFrame();
+    void CancelFrames();
     void FixupFrame(unsigned char * pBuffer, uint32 nBytes, uint32 nFinalWord, uint32 nFinalBytes);
 };
 
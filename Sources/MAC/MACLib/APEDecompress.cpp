@@ -2,19 +2,37 @@
 #include "APEDecompress.h"
 #include "APEDecompressCore.h"
 #include "APEInfo.h"
-#include "FloatTransform.h"
-#include "GlobalFunctions.h"
+#include "OutputProcessing.h"
+#include "OutputConversion.h"
+#include "WorkerPool.h"
 
 namespace APE
 {
 
 CAPEDecompress::CAPEDecompress(int * pErrorCode, CAPEInfo * pAPEInfo, int64 nStartBlock, int64 nFinishBlock)
+: m_semIO(1), m_semFrames(1), m_semDecoders(APE_MAXIMUM_THREADS), m_semDecodersLock(1)
 {
     *pErrorCode = ERROR_SUCCESS;
 
     // initialize
     m_nThreads = 1;
-    m_nNextWorker = 0;
+    m_nDecodeMode = APE_DECODE_MODE_INTERLEAVED;
+    m_pWorkerPool = APE_NULL;
+    m_nFrameWindow = 0;
+    m_nFrameHead = 0;
+    m_nFramesInFlight = 0;
+    m_nFramesPending = 0;
+    m_nIdleWorkers = 0;
+    m_pCurrentFrame = APE_NULL;
+    m_nOutputProcessing = 0;
+    m_nSampleFormat = 0;
+    m_nChannelMask = 0;
+    m_bPlanar = false;
+    m_nFrameBlockAlign = 0;
+    m_nFrameBufferBytes = 0;
+    m_nDecoders = 0;
+    m_nFreeDecoders = 0;
+    APE_CLEAR(m_aryFreeDecoders);
 
     // open / analyze the file
     m_spAPEInfo.Assign(pAPEInfo);
@@ -24,11 +42,18 @@ CAPEDecompress::CAPEDecompress(int * pErrorCode, CAPEInfo * pAPEInfo, int64 nSta
 
     // get format information
     m_nBlockAlign = static_cast<int>(m_spAPEInfo->GetInfo(APE_INFO_BLOCK_ALIGN));
+    m_nFrameBlockAlign = m_nBlockAlign;
+    m_nOutputProcessing = GetProcessing(APE_NULL);
 
     // initialize other stuff
     m_bDecompressorInitialized = false;
+    m_nDecompressorResult = ERROR_SUCCESS;
     m_nCurrentFrame = 0;
     m_nCurrentBlock = 0;
+    m_nBlocksToSkip = 0;
+    m_nSeekMicroseconds = 0;
+    m_nSeekStartTime = 0;
+    m_bSeekTiming = false;
 
     // set the "real" start and finish blocks
     m_nStartBlock = (nStartBlock < 0) ? 0 : APE_MIN(nStartBlock, m_spAPEInfo->GetInfo(APE_INFO_TOTAL_BLOCKS));
@@ -42,9 +67,6 @@ CAPEDecompress::CAPEDecompress(int * pErrorCode, CAPEInfo * pAPEInfo, int64 nSta
         *pErrorCode = ERROR_UNDEFINED;
         return;
     }
-
-    // create a frame buffer
-    m_cbFrameBuffer.CreateBuffer(static_cast<uint32>(m_spAPEInfo->GetInfo(APE_INFO_BLOCKS_PER_FRAME) * static_cast<uint32>(m_nBlockAlign)), static_cast<uint32>(m_nBlockAlign * 64));
 }
 
 CAPEDecompress::~CAPEDecompress()
@@ -53,37 +75,84 @@ CAPEDecompress::~CAPEDecompress()
     if (!m_bDecompressorInitialized)
         return;
 
+    // wait out the frames being decoded
+    CancelFrames();
+
     // finish threads
     for (int i = 0; i < m_nThreads; i++)
-        m_spAPEDecompressCore[i].Delete();
+        m_sparyAPEDecompressCore[i].Delete();
 }
 
 int CAPEDecompress::SetNumberOfThreads(int nThreads)
 {
-    m_nThreads = APE_CAP(nThreads, 1, 32);
+    // the workers are created on the first decode, so the count is fixed after that
+    if (!m_bDecompressorInitialized)
+        m_nThreads = APE_CAP(nThreads, 1, APE_MAXIMUM_THREADS);
     return m_nThreads;
 }
 
+int CAPEDecompress::SetFramesInFlight(int nFrames)
+{
+    // the window is created with the workers, so like the thread count it's fixed after the first decode
+    if (!m_bDecompressorInitialized)
+        m_nFrameWindow = APE_CAP(nFrames, 0, 2 * APE_MAXIMUM_THREADS);
+    return m_nFrameWindow;
+}
+
+int CAPEDecompress::SetDecodeMode(int nMode)
+{
+    // the workers pick the mode up when they start
+    if (!m_bDecompressorInitialized && (nMode >= APE_DECODE_MODE_INTERLEAVED) && (nMode <= APE_DECODE_MODE_PARALLEL_CHANNELS))
+        m_nDecodeMode = nMode;
+    return m_nDecodeMode;
+}
+
+int CAPEDecompress::GetDecodeMode() const
+{
+    return m_nDecodeMode;
+}
+
 int CAPEDecompress::InitializeDecompressor()
 {
-    // check if we have anything to do
+    // check if we have anything to do (if the workers couldn't be created, every call fails the same way)
     if (m_bDecompressorInitialized)
-        return ERROR_SUCCESS;
+        return m_nDecompressorResult;
 
     // update the initialized flag
     m_bDecompressorInitialized = true;
 
-    // create and start threads
+    // use the shared worker pool if it's enabled, otherwise each worker runs its own thread
+    m_pWorkerPool = CWorkerPool::GetShared();
+
+    // create the decoding window (by default, each worker can have a frame decoding while another waits to be read)
+    if (m_nFrameWindow <= 0)
+        m_nFrameWindow = 2 * m_nThreads;
+    m_nFrameWindow = APE_MAX(m_nFrameWindow, m_nThreads);
+
+    m_nFrameBufferBytes = static_cast<uint32>(m_spAPEInfo->GetInfo(APE_INFO_BLOCKS_PER_FRAME)) * static_cast<uint32>(m_nBlockAlign);
+    m_sparyFrames.Assign(new CAPEDecompressFrame [static_cast<size_t>(m_nFrameWindow)], true);
+    for (int i = 0; i < m_nFrameWindow; i++)
+        m_sparyFrames[i].m_cbFrameBuffer.CreateBuffer(m_nFrameBufferBytes, static_cast<uint32>(m_nBlockAlign * 64));
+
+    // create and start threads (every worker starts out idle)
+    m_sparyAPEDecompressCore.Assign(new CSmartPtr<CAPEDecompressCore> [static_cast<size_t>(m_nThreads)], true);
+    m_sparyIdleWorkers.Assign(new CAPEDecompressCore * [static_cast<size_t>(m_nThreads)], true);
     for (int i = 0; i < m_nThreads; i++)
     {
         int nErrorCode = ERROR_SUCCESS;
 
-        m_spAPEDecompressCore[i].Assign(new CAPEDecompressCore(&nErrorCode, this, m_spAPEInfo));
+        m_sparyAPEDecompressCore[i].Assign(new CAPEDecompressCore(&nErrorCode, this, m_spAPEInfo, m_pWorkerPool));
 
         if (nErrorCode != ERROR_SUCCESS)
+        {
+            m_nDecompressorResult = nErrorCode;
             return nErrorCode;
+        }
+
+        m_sparyIdleWorkers[m_nIdleWorkers++] = m_sparyAPEDecompressCore[i];
 
-        m_spAPEDecompressCore[i]->Start();
+        if (m_pWorkerPool == APE_NULL)
+            m_sparyAPEDecompressCore[i]->Start();
     }
 
     // seek to the beginning
@@ -95,135 +164,268 @@ int CAPEDecompress::GetData(unsigned char * pBuffer, int64 nBlocks, int64 * pBlo
     int nResult = ERROR_SUCCESS;
     if (pBlocksRetrieved) *pBlocksRetrieved = 0;
 
-    // make sure we're initialized
+    // make sure we're initialized (with the frames in packed PCM)
     RETURN_ON_ERROR(InitializeDecompressor())
+    RETURN_ON_ERROR(SetSampleFormat(0, 0, false))
 
     // cap
     const int64 nBlocksUntilFinish = m_nFinishBlock - m_nCurrentBlock;
     const int64 nBlocksToRetrieve = APE_MIN(nBlocks, nBlocksUntilFinish);
 
-    // get the data
+    // get the data (straight from the frames the workers decoded into)
     unsigned char * pBufferGet = pBuffer;
-    int64 nBlocksLeft = nBlocksToRetrieve; int nBlocksThisPass = 1;
-    while ((nBlocksLeft > 0) && (nBlocksThisPass > 0))
+    int64 nBlocksLeft = nBlocksToRetrieve;
+    while (nBlocksLeft > 0)
     {
-        // check for available data
-        int64 nFrameBufferBlocks = static_cast<int64>(m_cbFrameBuffer.MaxGet()) / m_nBlockAlign;
+        CAPEDecompressFrame * pFrame = GetCurrentFrame(&nResult);
+        if (pFrame == APE_NULL)
+            break;
 
-        while (nFrameBufferBlocks == 0 && !nResult)
-        {
-            m_cbFrameBuffer.Empty();
-
-            // get next worker
-            CAPEDecompressCore * pWorker = m_spAPEDecompressCore[m_nNextWorker];
-
-            // get data from decoder
-            pWorker->WaitUntilReady();
+        // remove as much as possible
+        const int64 nBlocksThisPass = APE_MIN(nBlocksLeft, static_cast<int64>(pFrame->m_cbFrameBuffer.MaxGet()) / m_nBlockAlign);
+        pFrame->m_cbFrameBuffer.Get(pBufferGet, static_cast<uint32>(nBlocksThisPass * m_nBlockAlign));
+        ProcessData(pBufferGet, nBlocksThisPass, pProcessing, pFrame->m_nProcessing);
+        pBufferGet = &pBufferGet[nBlocksThisPass * m_nBlockAlign];
+        nBlocksLeft -= nBlocksThisPass;
+
+        // hand the frame back as soon as it's used up so the slot can take the next frame
+        if (pFrame->m_cbFrameBuffer.MaxGet() == 0)
+            RetireCurrentFrame();
+    }
 
-            nResult = pWorker->GetErrorState();
-            if (nResult != ERROR_SUCCESS)
-            {
-                // output silence
-                const uint32 nOutputSilenceBytes = m_cbFrameBuffer.MaxAdd();
-                unsigned char cSilence = static_cast<unsigned char>((GetInfo(APE_INFO_BITS_PER_SAMPLE) == 8) ? 127 : 0);
+    // calculate the blocks retrieved
+    int64 nBlocksRetrieved = static_cast<int64>(nBlocksToRetrieve - nBlocksLeft);
 
-                memset(m_cbFrameBuffer.GetDirectWritePointer(), cSilence, nOutputSilenceBytes);
-                m_cbFrameBuffer.UpdateAfterDirectWrite(nOutputSilenceBytes);
+    // update position
+    m_nCurrentBlock += nBlocksRetrieved;
+    if (pBlocksRetrieved) *pBlocksRetrieved = nBlocksRetrieved;
 
-                nFrameBufferBlocks = nOutputSilenceBytes / static_cast<uint32>(m_nBlockAlign);
-            }
-            else if (pWorker->GetFrameBytes() > 0)
-            {
-                pWorker->GetFrameData(m_cbFrameBuffer.GetDirectWritePointer());
-                m_cbFrameBuffer.UpdateAfterDirectWrite(pWorker->GetFrameBytes());
+    return nResult;
+}
 
-                nFrameBufferBlocks = static_cast<int64>(pWorker->GetFrameBytes()) / m_nBlockAlign;
-            }
+int CAPEDecompress::GetDataEx(unsigned char ** apBuffers, int64 nBlocks, int64 * pBlocksRetrieved, const APE_OUTPUT_FORMAT * pFormat)
+{
+    int nResult = ERROR_SUCCESS;
+    if (pBlocksRetrieved) *pBlocksRetrieved = 0;
 
-            // decode next frame
-            if (m_nCurrentFrame < m_spAPEInfo->GetInfo(APE_INFO_TOTAL_FRAMES))
-            {
-                int nScheduleResult = ScheduleFrameDecode(pWorker, m_nCurrentFrame++);
-                if (nScheduleResult != ERROR_SUCCESS)
-                    nResult = nScheduleResult;
-            }
-            else
-            {
-                // reset worker to ready state
-                pWorker->SetErrorState(ERROR_SUCCESS);
-            }
+    // check the format
+    uint32 nChannelMask = 0;
+    RETURN_ON_ERROR(COutputConversion::CheckFormat(pFormat, apBuffers, static_cast<int>(m_spAPEInfo->GetInfo(APE_INFO_CHANNELS)), &nChannelMask))
+    const int nChannels = COutputConversion::GetChannels(nChannelMask);
 
-            m_nNextWorker = (m_nNextWorker + 1) % m_nThreads;
-        }
+    // make sure we're initialized (with the frames in the format)
+    RETURN_ON_ERROR(InitializeDecompressor())
+    RETURN_ON_ERROR(SetSampleFormat(pFormat->nSampleFormat, nChannelMask, pFormat->bPlanar && (nChannels > 1)))
 
-        // analyze how much to remove from the buffer
-        nBlocksThisPass = static_cast<int>(APE_MIN(nBlocksLeft, nFrameBufferBlocks));
+    // cap
+    const int64 nBlocksToRetrieve = APE_MIN(nBlocks, m_nFinishBlock - m_nCurrentBlock);
 
-        // remove as much as possible
-        if (nBlocksThisPass > 0)
+    // get the data (the frames are already converted and laid out the way they're output, so it's just copied)
+    const int nBytesPerSample = COutputConversion::GetBytesPerSample(pFormat->nSampleFormat);
+    int64 nBlocksRetrieved = 0;
+    while (nBlocksRetrieved < nBlocksToRetrieve)
+    {
+        CAPEDecompressFrame * pFrame = GetCurrentFrame(&nResult);
+        if (pFrame == APE_NULL)
+            break;
+
+        // remove as much as possible (a frame is always decoded into an empty buffer, so it never wraps)
+        const int64 nFrameBlocks = static_cast<int64>(pFrame->m_cbFrameBuffer.MaxGet()) / m_nFrameBlockAlign;
+        const int64 nBlocksThisPass = APE_MIN(nBlocksToRetrieve - nBlocksRetrieved, nFrameBlocks);
+        const unsigned char * pInput = pFrame->m_cbFrameBuffer.GetDirectReadPointer();
+        int64 nPlaneBytes = 0;
+        if (m_bPlanar)
         {
-            m_cbFrameBuffer.Get(pBufferGet, static_cast<uint32>(nBlocksThisPass * m_nBlockAlign));
-            pBufferGet = &pBufferGet[nBlocksThisPass * m_nBlockAlign];
-            nBlocksLeft -= nBlocksThisPass;
+            // the read pointer is the blocks read so far past the start of the first plane, and the planes are
+            // read that many samples in
+            const int64 nBlocksRead = pFrame->m_nPlaneBlocks - nFrameBlocks;
+            pInput = &pInput[nBlocksRead * (nBytesPerSample - m_nFrameBlockAlign)];
+            nPlaneBytes = pFrame->m_nPlaneBlocks * nBytesPerSample;
         }
-    }
+        COutputConversion::CopyOut(pInput, nBlocksThisPass, nChannels, nBytesPerSample, nPlaneBytes, apBuffers, nBlocksRetrieved);
+        pFrame->m_cbFrameBuffer.RemoveHead(static_cast<uint32>(nBlocksThisPass * m_nFrameBlockAlign));
+        nBlocksRetrieved += nBlocksThisPass;
 
-    // calculate the blocks retrieved
-    int64 nBlocksRetrieved = static_cast<int64>(nBlocksToRetrieve - nBlocksLeft);
+        // hand the frame back as soon as it's used up so the slot can take the next frame
+        if (pFrame->m_cbFrameBuffer.MaxGet() == 0)
+            RetireCurrentFrame();
+    }
 
     // update position
     m_nCurrentBlock += nBlocksRetrieved;
     if (pBlocksRetrieved) *pBlocksRetrieved = nBlocksRetrieved;
 
+    return nResult;
+}
+
+int CAPEDecompress::LeaseFrameData(unsigned char ** ppBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing)
+{
+    int nResult = ERROR_SUCCESS;
+    if (ppBuffer == APE_NULL) return ERROR_BAD_PARAMETER;
+    *ppBuffer = APE_NULL;
+    if (pBlocksRetrieved) *pBlocksRetrieved = 0;
+
+    // make sure we're initialized (with the frames in packed PCM)
+    RETURN_ON_ERROR(InitializeDecompressor())
+    RETURN_ON_ERROR(SetSampleFormat(0, 0, false))
+
+    const int64 nBlocksUntilFinish = m_nFinishBlock - m_nCurrentBlock;
+    if (nBlocksUntilFinish <= 0)
+        return ERROR_SUCCESS;
+
+    CAPEDecompressFrame * pFrame = GetCurrentFrame(&nResult);
+    if (pFrame == APE_NULL)
+        return nResult;
+
+    // hand out the rest of the frame in place (a frame is always decoded into an empty buffer, so it never wraps)
+    // the frame stays ours until the next call, so it's only marked as read here
+    const int64 nBlocks = APE_MIN(nBlocksUntilFinish, static_cast<int64>(pFrame->m_cbFrameBuffer.MaxGet()) / m_nBlockAlign);
+    *ppBuffer = pFrame->m_cbFrameBuffer.GetDirectReadPointer();
+    pFrame->m_cbFrameBuffer.RemoveHead(static_cast<uint32>(nBlocks * m_nBlockAlign));
+
+    // update position
+    m_nCurrentBlock += nBlocks;
+    if (pBlocksRetrieved) *pBlocksRetrieved = nBlocks;
+
     // process data
-    const int64 nBlocksDecoded = nBlocksRetrieved;
-    if ((pProcessing == APE_NULL) || (pProcessing->bApplyFloatProcessing == true))
-    {
-        if (GetInfo(IAPEDecompress::APE_INFO_FORMAT_FLAGS) & APE_FORMAT_FLAG_FLOATING_POINT)
-            CFloatTransform::Process(reinterpret_cast<uint32 *>(pBuffer), nBlocksDecoded * GetInfo(IAPEDecompress::APE_INFO_CHANNELS));
-    }
+    ProcessData(*ppBuffer, nBlocks, pProcessing, pFrame->m_nProcessing);
 
-    if ((pProcessing == APE_NULL) || (pProcessing->bApplySigned8BitProcessing == true))
+    return nResult;
+}
+
+int CAPEDecompress::ReleaseFrameData()
+{
+    if ((m_pCurrentFrame != APE_NULL) && (m_pCurrentFrame->m_cbFrameBuffer.MaxGet() == 0))
+        RetireCurrentFrame();
+
+    return ERROR_SUCCESS;
+}
+
+/**************************************************************************************************
+Random access decoding
+
+Each call borrows a decoder (a core and a frame buffer of its own) from a free list, creating one
+if they're all busy, so any number of threads can decode frames at the same time; the file is only
+touched through ReadFrame(...) and GetInfo(...), which hold the I/O lock
+**************************************************************************************************/
+int CAPEDecompress::DecodeFrame(int64 nFrameIndex, unsigned char * pBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing)
+{
+    if (pBlocksRetrieved) *pBlocksRetrieved = 0;
+    if ((pBuffer == APE_NULL) || (nFrameIndex < 0) || (nFrameIndex >= GetInfo(APE_INFO_TOTAL_FRAMES)))
+        return ERROR_BAD_PARAMETER;
+
+    // borrow a decoder (the semaphore counts the decoders that are free or can still be created)
+    m_semDecoders.Wait();
+
+    m_semDecodersLock.Wait();
+    const int nDecoder = (m_nFreeDecoders > 0) ? m_aryFreeDecoders[--m_nFreeDecoders] : m_nDecoders++;
+    m_semDecodersLock.Post();
+
+    int nResult = ERROR_SUCCESS;
+    if (m_spDecoderCores[nDecoder] == APE_NULL)
     {
-        if (GetInfo(IAPEDecompress::APE_INFO_FORMAT_FLAGS) & APE_FORMAT_FLAG_SIGNED_8_BIT)
+        m_spDecoderCores[nDecoder].Assign(new CAPEDecompressCore(&nResult, this, m_spAPEInfo));
+        if (nResult == ERROR_SUCCESS)
         {
-            const int64 nChannels = GetInfo(IAPEDecompress::APE_INFO_CHANNELS);
-            for (int nSample = 0; nSample < nBlocksDecoded * nChannels; nSample++)
-            {
-                const unsigned char cTemp = pBuffer[nSample];
-                const char cTemp2 = static_cast<char>(cTemp + 128);
-                pBuffer[nSample] = static_cast<unsigned char>(cTemp2);
-            }
+            m_spDecoderFrames[nDecoder].Assign(new CAPEDecompressFrame);
+            m_spDecoderFrames[nDecoder]->m_cbFrameBuffer.CreateBuffer(static_cast<uint32>(GetInfo(APE_INFO_BLOCKS_PER_FRAME)) * static_cast<uint32>(m_nBlockAlign), static_cast<uint32>(m_nBlockAlign * 64));
+        }
+        else
+        {
+            // leave the slot empty, so the next call to borrow it doesn't decode with a core that failed
+            m_spDecoderCores[nDecoder].Delete();
+            m_spDecoderFrames[nDecoder].Delete();
         }
     }
 
-    if ((pProcessing == APE_NULL) || (pProcessing->bApplyBigEndianProcessing == true))
+    // decode
+    CAPEDecompressFrame * pFrame = m_spDecoderFrames[nDecoder];
+    if (nResult == ERROR_SUCCESS)
     {
-        if (GetInfo(IAPEDecompress::APE_INFO_FORMAT_FLAGS) & APE_FORMAT_FLAG_BIG_ENDIAN)
-        {
-            const int64 nChannels = GetInfo(IAPEDecompress::APE_INFO_CHANNELS);
-            const int64 nBitdepth = GetInfo(IAPEDecompress::APE_INFO_BITS_PER_SAMPLE);
+        FillFrame(pFrame, nFrameIndex);
+        pFrame->m_nProcessing = GetProcessing(pProcessing);
+        pFrame->m_nSampleFormat = 0;
+        pFrame->m_bPlanar = false;
+        nResult = m_spDecoderCores[nDecoder]->DecodeFrame(pFrame);
+    }
 
-            if (nBitdepth >= 16)
-                SwitchBufferBytes(pBuffer, static_cast<int>(nBitdepth / 8), static_cast<int>(nBlocksDecoded * nChannels));
-        }
+    if (nResult == ERROR_SUCCESS)
+    {
+        const uint32 nFrameBytes = pFrame->m_cbFrameBuffer.Get(pBuffer, pFrame->m_cbFrameBuffer.MaxGet());
+        const int64 nBlocksRetrieved = static_cast<int64>(nFrameBytes) / m_nBlockAlign;
+
+        // (the decoder did the processing)
+        if (pBlocksRetrieved) *pBlocksRetrieved = nBlocksRetrieved;
     }
 
+    // hand the decoder back
+    m_semDecodersLock.Wait();
+    m_aryFreeDecoders[m_nFreeDecoders++] = nDecoder;
+    m_semDecodersLock.Post();
+
+    m_semDecoders.Post();
+
     return nResult;
 }
 
-int CAPEDecompress::Seek(int64 nBlockOffset)
+/**************************************************************************************************
+Output processing
+
+The workers apply the processing the last read asked for as each frame finishes, so normally the
+data is ready by the time it's read; if a read asks for something else, the frames already decoded
+are fixed up here
+**************************************************************************************************/
+int CAPEDecompress::GetProcessing(const APE_GET_DATA_PROCESSING * pProcessing)
 {
-    RETURN_ON_ERROR(InitializeDecompressor())
+    const int nFormatFlags = static_cast<int>(m_spAPEInfo->GetInfo(APE_INFO_FORMAT_FLAGS));
+    int nProcessing = 0;
 
-    for (int i = 0; i < m_nThreads; i++)
-    {
-        CAPEDecompressCore * pWorker = m_spAPEDecompressCore[m_nNextWorker];
+    if ((pProcessing == APE_NULL) || (pProcessing->bApplyFloatProcessing == true))
+        nProcessing |= (nFormatFlags & APE_FORMAT_FLAG_FLOATING_POINT);
+
+    if ((pProcessing == APE_NULL) || (pProcessing->bApplySigned8BitProcessing == true))
+        nProcessing |= (nFormatFlags & APE_FORMAT_FLAG_SIGNED_8_BIT);
 
-        pWorker->CancelFrame();
+    if ((pProcessing == APE_NULL) || (pProcessing->bApplyBigEndianProcessing == true))
+        nProcessing |= (nFormatFlags & APE_FORMAT_FLAG_BIG_ENDIAN);
+
+    return nProcessing;
+}
+
+void CAPEDecompress::ProcessData(unsigned char * pBuffer, int64 nBlocksDecoded, APE_GET_DATA_PROCESSING * pProcessing, int nProcessed)
+{
+    // frames scheduled from now on get this processing
+    const int nProcessing = GetProcessing(pProcessing);
+    m_nOutputProcessing = nProcessing;
+
+    if (nProcessing != nProcessed)
+    {
+        const int nBytesPerSample = static_cast<int>(m_spAPEInfo->GetInfo(APE_INFO_BITS_PER_SAMPLE) / 8);
+        const int64 nSamples = nBlocksDecoded * m_spAPEInfo->GetInfo(APE_INFO_CHANNELS);
 
-        m_nNextWorker = (m_nNextWorker + 1) % m_nThreads;
+        COutputProcessing::Unprocess(pBuffer, nSamples, nBytesPerSample, nProcessed);
+        COutputProcessing::Process(pBuffer, nSamples, nBytesPerSample, nProcessing);
     }
+}
+
+int CAPEDecompress::Seek(int64 nBlockOffset)
+{
+    // time the seek (cancelling the decoding window, then decoding the frame at the new position, which
+    // is only finished when it's read; see GetCurrentFrame(...))
+    TICK_COUNT_READ(m_nSeekStartTime);
+
+    const int nResult = SeekToBlock(nBlockOffset);
+    m_bSeekTiming = (nResult == ERROR_SUCCESS);
+
+    return nResult;
+}
+
+int CAPEDecompress::SeekToBlock(int64 nBlockOffset)
+{
+    RETURN_ON_ERROR(InitializeDecompressor())
+
+    // drop the decoding window
+    CancelFrames();
 
     // use the offset
     nBlockOffset += m_nStartBlock;
@@ -238,52 +440,244 @@ int CAPEDecompress::Seek(int64 nBlockOffset)
     const int64 nBaseFrame = nBlockOffset / GetInfo(APE_INFO_BLOCKS_PER_FRAME);
     const int64 nBlocksToSkip = nBlockOffset % GetInfo(APE_INFO_BLOCKS_PER_FRAME);
 
-    m_nCurrentBlock = nBaseFrame * GetInfo(APE_INFO_BLOCKS_PER_FRAME);
+    m_nCurrentBlock = nBlockOffset;
     m_nCurrentFrame = nBaseFrame;
-    m_cbFrameBuffer.Empty();
 
-    // skip necessary blocks
-    if (nBlocksToSkip > 0)
+    // the worker decodes the blocks before the seek point without outputting them (they still have to
+    // be decoded to get to the seek point and to check the frame's CRC)
+    m_nBlocksToSkip = nBlocksToSkip;
+
+    return ERROR_SUCCESS;
+}
+
+/**************************************************************************************************
+Decoding window
+
+The window is a ring of frame slots; m_nFrameHead is the oldest frame (the next one to be read),
+and the last m_nFramesPending frames in flight haven't been taken by a worker yet
+
+Only the reading thread starts and retires frames, and the workers only take pending frames, so
+m_semFrames just guards the counts and the idle worker list
+**************************************************************************************************/
+void CAPEDecompress::ScheduleFrames()
+{
+    const int64 nTotalFrames = GetInfo(APE_INFO_TOTAL_FRAMES);
+    while ((m_nFramesInFlight < m_nFrameWindow) && (m_nCurrentFrame < nTotalFrames))
     {
-        const int64 nBytesToSkip = nBlocksToSkip * m_nBlockAlign;
+        // fill in the frame (the slot isn't visible to the workers until it's pending)
+        CAPEDecompressFrame * pFrame = &m_sparyFrames[(m_nFrameHead + m_nFramesInFlight) % m_nFrameWindow];
+        FillFrame(pFrame, m_nCurrentFrame++);
+        pFrame->m_nProcessing = (m_nSampleFormat == 0) ? m_nOutputProcessing : 0;
+        pFrame->m_nSampleFormat = m_nSampleFormat;
+        pFrame->m_nChannelMask = m_nChannelMask;
+        pFrame->m_bPlanar = m_bPlanar;
+        pFrame->m_nSkipBlocks = m_nBlocksToSkip;
+        m_nBlocksToSkip = 0;
+
+        // queue it and wake a worker if one is idle
+        CAPEDecompressCore * pWorker = APE_NULL;
+
+        m_semFrames.Wait();
+        m_nFramesInFlight++;
+        m_nFramesPending++;
+        if (m_nIdleWorkers > 0)
+            pWorker = m_sparyIdleWorkers[--m_nIdleWorkers];
+        m_semFrames.Post();
+
+        if (pWorker != APE_NULL)
+            pWorker->Wake();
+    }
+}
 
-        CSmartPtr<unsigned char> spTempBuffer(new unsigned char [static_cast<size_t>(nBytesToSkip)], true);
-        if (spTempBuffer == APE_NULL)
-            return ERROR_INSUFFICIENT_MEMORY;
+void CAPEDecompress::FillFrame(CAPEDecompressFrame * pFrame, int64 nFrameIndex)
+{
+    const uint32 nSeekRemainder = static_cast<uint32>((GetInfo(APE_INFO_SEEK_BYTE, nFrameIndex) - GetInfo(APE_INFO_SEEK_BYTE, 0)) % 4);
+
+    pFrame->m_nFrameIndex = nFrameIndex;
+    pFrame->m_nFrameBlocks = GetInfo(APE_INFO_FRAME_BLOCKS, nFrameIndex);
+    pFrame->m_nSeekByte = GetInfo(APE_INFO_SEEK_BYTE, nFrameIndex) - nSeekRemainder;
+    pFrame->m_nInputBytes = static_cast<uint32>(GetInfo(APE_INFO_FRAME_BYTES, nFrameIndex)) + nSeekRemainder + 4;
+    pFrame->m_nSkipBytes = static_cast<int>(nSeekRemainder);
+    pFrame->m_pInputData = m_spIO->GetDirectReadPointer(pFrame->m_nSeekByte, pFrame->m_nInputBytes + UNBIT_ARRAY_PADDING_BYTES);
+    pFrame->m_nSkipBlocks = 0;
+    pFrame->m_nErrorState = ERROR_SUCCESS;
+    pFrame->m_Cancelled.Set(false);
+    pFrame->m_cbFrameBuffer.Empty();
+}
 
-        int64 nBlocksRetrieved = 0;
-        GetData(spTempBuffer, nBlocksToSkip, &nBlocksRetrieved, APE_NULL);
-        if (nBlocksRetrieved != nBlocksToSkip)
-            return ERROR_UNDEFINED;
+CAPEDecompressFrame * CAPEDecompress::GetNextFrame(CAPEDecompressCore * pWorker)
+{
+    CAPEDecompressFrame * pFrame = APE_NULL;
+
+    m_semFrames.Wait();
+    if (m_nFramesPending > 0)
+    {
+        pFrame = &m_sparyFrames[(m_nFrameHead + m_nFramesInFlight - m_nFramesPending) % m_nFrameWindow];
+        m_nFramesPending--;
     }
+    else
+    {
+        // nothing to do, so wait to be woken by ScheduleFrames()
+        m_sparyIdleWorkers[m_nIdleWorkers++] = pWorker;
+    }
+    m_semFrames.Post();
 
-    return ERROR_SUCCESS;
+    return pFrame;
+}
+
+int CAPEDecompress::ReadFrame(CAPEDecompressFrame * pFrame, unsigned char * pBuffer)
+{
+    // read at the frame's offset so the workers can read in parallel
+    unsigned int nBytesRead = 0;
+    int nResult = m_spIO->ReadAt(pFrame->m_nSeekByte, pBuffer, pFrame->m_nInputBytes, &nBytesRead);
+
+    // the I/O object can't do that, and the workers share it, so the seek and read have to happen together
+    if (nResult == ERROR_UNDEFINED)
+    {
+        m_semIO.Wait();
+        nResult = m_spIO->Seek(pFrame->m_nSeekByte, SeekFileBegin);
+        if (nResult == ERROR_SUCCESS)
+            nResult = m_spIO->Read(pBuffer, pFrame->m_nInputBytes, &nBytesRead);
+        m_semIO.Post();
+    }
+
+    if ((nResult == ERROR_SUCCESS) && (nBytesRead < pFrame->m_nInputBytes - 4))
+        nResult = ERROR_INPUT_FILE_TOO_SMALL;
+
+    return nResult;
 }
 
 /**************************************************************************************************
-Read frame data and pass it to worker thread
+Switch the format the workers decode the frames to
+
+The frames decoded ahead are in the old format, so they're dropped and decoded again from the
+current block; the frame buffers grow if a block gets bigger (they never shrink)
 **************************************************************************************************/
-int CAPEDecompress::ScheduleFrameDecode(CAPEDecompressCore * pWorker, int64 nFrameIndex)
+int CAPEDecompress::SetSampleFormat(int nSampleFormat, uint32 nChannelMask, bool bPlanar)
 {
-    const uint32 nSeekRemainder = static_cast<uint32>((GetInfo(APE_INFO_SEEK_BYTE, nFrameIndex) - GetInfo(APE_INFO_SEEK_BYTE, 0)) % 4);
-    const uint32 nFrameBytes = static_cast<uint32>(GetInfo(APE_INFO_FRAME_BYTES, nFrameIndex)) + nSeekRemainder + 4;
+    if ((nSampleFormat == m_nSampleFormat) && (nChannelMask == m_nChannelMask) && (bPlanar == m_bPlanar))
+        return ERROR_SUCCESS;
 
-    unsigned char * pFrameBuffer = pWorker->GetInputBuffer(nFrameBytes);
+    CancelFrames();
 
-    unsigned int nBytesRead = 0;
-    int result = m_spIO->Seek(GetInfo(APE_INFO_SEEK_BYTE, nFrameIndex) - nSeekRemainder, SeekFileBegin);
-    if (result != ERROR_SUCCESS)
-        return pWorker->SetErrorState(result);
+    m_nSampleFormat = nSampleFormat;
+    m_nChannelMask = nChannelMask;
+    m_bPlanar = bPlanar;
+    m_nFrameBlockAlign = (nSampleFormat == 0) ? m_nBlockAlign : COutputConversion::GetChannels(nChannelMask) * COutputConversion::GetBytesPerSample(nSampleFormat);
 
-    result = m_spIO->Read(pFrameBuffer, nFrameBytes, &nBytesRead);
-    if (result != ERROR_SUCCESS)
-        return pWorker->SetErrorState(result);
+    const uint32 nFrameBufferBytes = static_cast<uint32>(m_spAPEInfo->GetInfo(APE_INFO_BLOCKS_PER_FRAME)) * static_cast<uint32>(m_nFrameBlockAlign);
+    if (nFrameBufferBytes > m_nFrameBufferBytes)
+    {
+        m_nFrameBufferBytes = nFrameBufferBytes;
+        for (int i = 0; i < m_nFrameWindow; i++)
+            m_sparyFrames[i].m_cbFrameBuffer.CreateBuffer(m_nFrameBufferBytes, static_cast<uint32>(m_nFrameBlockAlign * 64));
+    }
 
-    if (nBytesRead < nFrameBytes - 4)
-        return pWorker->SetErrorState(ERROR_INPUT_FILE_TOO_SMALL);
+    // (there's nothing to decode again at the end)
+    if (m_nCurrentBlock >= m_nFinishBlock)
+        return ERROR_SUCCESS;
 
-    pWorker->DecodeFrame(static_cast<int>(nSeekRemainder), GetInfo(APE_INFO_FRAME_BLOCKS, nFrameIndex));
-    return ERROR_SUCCESS;
+    return SeekToBlock(m_nCurrentBlock - m_nStartBlock);
+}
+
+/**************************************************************************************************
+Get the frame being read (waiting for the next frame if the current one is used up)
+**************************************************************************************************/
+CAPEDecompressFrame * CAPEDecompress::GetCurrentFrame(int * pResult)
+{
+    // a leased frame is held until the next call, so hand it back now
+    if ((m_pCurrentFrame != APE_NULL) && (m_pCurrentFrame->m_cbFrameBuffer.MaxGet() == 0))
+        RetireCurrentFrame();
+
+    while ((m_pCurrentFrame == APE_NULL) && (*pResult == ERROR_SUCCESS))
+    {
+        // keep the window full, then wait for the oldest frame (later frames may already be done)
+        ScheduleFrames();
+
+        CAPEDecompressFrame * pFrame = WaitForFrame();
+        if (pFrame == APE_NULL)
+            break;
+
+        // this is the first frame since a seek, so the seek is done
+        if (m_bSeekTiming)
+        {
+            TICK_COUNT_TYPE nFinishTime = 0;
+            TICK_COUNT_READ(nFinishTime);
+            m_nSeekMicroseconds = static_cast<int64>((nFinishTime - m_nSeekStartTime) * (1000000 / TICK_COUNT_FREQ));
+            m_bSeekTiming = false;
+        }
+
+        *pResult = pFrame->m_nErrorState;
+        if (*pResult != ERROR_SUCCESS)
+        {
+            // output silence (a whole frame from the seek point, and zero is silence in every converted format)
+            pFrame->m_cbFrameBuffer.Empty();
+            const uint32 nOutputSilenceBytes = static_cast<uint32>(GetInfo(APE_INFO_BLOCKS_PER_FRAME) - pFrame->m_nSkipBlocks) * static_cast<uint32>(m_nFrameBlockAlign);
+            unsigned char cSilence = static_cast<unsigned char>(((pFrame->m_nSampleFormat == 0) && (GetInfo(APE_INFO_BITS_PER_SAMPLE) == 8)) ? 127 : 0);
+
+            memset(pFrame->m_cbFrameBuffer.GetDirectWritePointer(), cSilence, nOutputSilenceBytes);
+            pFrame->m_cbFrameBuffer.UpdateAfterDirectWrite(nOutputSilenceBytes);
+            pFrame->m_nProcessing = 0;
+            pFrame->m_nPlaneBlocks = static_cast<int64>(nOutputSilenceBytes) / m_nFrameBlockAlign;
+        }
+
+        if (pFrame->m_cbFrameBuffer.MaxGet() > 0)
+            m_pCurrentFrame = pFrame;
+        else
+            RetireFrame();
+    }
+
+    return m_pCurrentFrame;
+}
+
+void CAPEDecompress::RetireCurrentFrame()
+{
+    // the slot can take the next frame now
+    m_pCurrentFrame = APE_NULL;
+    RetireFrame();
+    ScheduleFrames();
+}
+
+CAPEDecompressFrame * CAPEDecompress::WaitForFrame()
+{
+    if (m_nFramesInFlight == 0)
+        return APE_NULL;
+
+    CAPEDecompressFrame * pFrame = &m_sparyFrames[m_nFrameHead];
+    pFrame->m_semReady.Wait();
+    return pFrame;
+}
+
+void CAPEDecompress::RetireFrame()
+{
+    m_semFrames.Wait();
+    m_nFrameHead = (m_nFrameHead + 1) % m_nFrameWindow;
+    m_nFramesInFlight--;
+    m_semFrames.Post();
+}
+
+void CAPEDecompress::CancelFrames()
+{
+    // the frame being read is already done
+    if (m_pCurrentFrame != APE_NULL)
+    {
+        m_pCurrentFrame = APE_NULL;
+        RetireFrame();
+    }
+
+    // drop the frames no worker has taken (they're the newest ones in flight)
+    m_semFrames.Wait();
+    m_nFramesInFlight -= m_nFramesPending;
+    m_nFramesPending = 0;
+    m_semFrames.Post();
+
+    // stop the frames that are being decoded (the workers check every few thousand blocks)
+    for (int z = 0; z < m_nFramesInFlight; z++)
+        m_sparyFrames[(m_nFrameHead + z) % m_nFrameWindow].m_Cancelled.Set(true);
+
+    // wait for the workers to let go of them
+    while (WaitForFrame() != APE_NULL)
+        RetireFrame();
 }
 
 /**************************************************************************************************
@@ -340,6 +734,12 @@ int64 CAPEDecompress::GetInfo(IAPEDecompress::APE_DECOMPRESS_FIELDS Field, int64
         bHandled = true;
         break;
     }
+    case APE_DECOMPRESS_SEEK_MICROSECONDS:
+    {
+        nResult = m_nSeekMicroseconds;
+        bHandled = true;
+        break;
+    }
     case APE_DECOMPRESS_AVERAGE_BITRATE:
     {
         if (m_bIsRanged)
@@ -462,7 +862,12 @@ int64 CAPEDecompress::GetInfo(IAPEDecompress::APE_DECOMPRESS_FIELDS Field, int64
     }
 
     if (!bHandled)
+    {
+        // some fields use the I/O object, which the workers share
+        m_semIO.Wait();
         nResult = m_spAPEInfo->GetInfo(Field, nParam1, nParam2);
+        m_semIO.Post();
+    }
 
     return nResult;
 }
@@ -2,12 +2,15 @@
 
 #include "MACLib.h"
 #include "CircleBuffer.h"
+#include "Semaphore.h"
 
 namespace APE
 {
 
 class CAPEDecompressCore;
+class CAPEDecompressFrame;
 class CAPEInfo;
+class CWorkerPool;
 class IPredictorDecompress;
 
 class CAPEDecompress : public IAPEDecompress
@@ -18,14 +21,25 @@ public:
 
     // configuration
     int SetNumberOfThreads(int nThreads) APE_OVERRIDE;
+    int SetFramesInFlight(int nFrames) APE_OVERRIDE;
+    int SetDecodeMode(int nMode) APE_OVERRIDE;
+    int GetDecodeMode() const;
 
     // decoding
     int GetData(unsigned char * pBuffer, int64 nBlocks, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) APE_OVERRIDE;
+    int GetDataEx(unsigned char ** apBuffers, int64 nBlocks, int64 * pBlocksRetrieved, const APE_OUTPUT_FORMAT * pFormat) APE_OVERRIDE;
     int Seek(int64 nBlockOffset) APE_OVERRIDE;
+    int LeaseFrameData(unsigned char ** ppBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) APE_OVERRIDE;
+    int ReleaseFrameData() APE_OVERRIDE;
+    int DecodeFrame(int64 nFrameIndex, unsigned char * pBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) APE_OVERRIDE;
 
     // file info
     int64 GetInfo(IAPEDecompress::APE_DECOMPRESS_FIELDS Field, int64 nParam1 = 0, int64 nParam2 = 0) APE_OVERRIDE;
 
+    // workers (take the next frame to decode, or go idle if there isn't one, and read a frame's input)
+    CAPEDecompressFrame * GetNextFrame(CAPEDecompressCore * pWorker);
+    int ReadFrame(CAPEDecompressFrame * pFrame, unsigned char * pBuffer);
+
 protected:
     // file info
     int m_nBlockAlign;
@@ -33,26 +47,66 @@ protected:
 
     // decompressor
     int m_nThreads;
-    CSmartPtr<CAPEDecompressCore> m_spAPEDecompressCore[32];
-    int m_nNextWorker;
+    int m_nDecodeMode;
+    CSmartPtr<CSmartPtr<CAPEDecompressCore> > m_sparyAPEDecompressCore;
+    CWorkerPool * m_pWorkerPool;
     CSmartPtr<CIO> m_spIO;
+    CSemaphore m_semIO;
+
+    // decoding window (frames are started in order, finish in any order, and are returned in order)
+    int m_nFrameWindow;
+    CSmartPtr<CAPEDecompressFrame> m_sparyFrames;
+    int m_nFrameHead;
+    int m_nFramesInFlight;
+    int m_nFramesPending;
+    CSmartPtr<CAPEDecompressCore *> m_sparyIdleWorkers;
+    int m_nIdleWorkers;
+    CSemaphore m_semFrames;
+    CAPEDecompressFrame * m_pCurrentFrame;
+    int m_nOutputProcessing; // the output processing the workers apply (what the last read asked for)
+    int m_nSampleFormat; // the sample format the workers convert to (0 for packed PCM), the channels they keep, and whether each goes in a plane
+    uint32 m_nChannelMask;
+    bool m_bPlanar;
+    int m_nFrameBlockAlign; // the size of a block in the frames
+    uint32 m_nFrameBufferBytes;
+
+    // random access decoders (borrowed by DecodeFrame(...), independent of the decoding window)
+    CSmartPtr<CAPEDecompressCore> m_spDecoderCores[APE_MAXIMUM_THREADS];
+    CSmartPtr<CAPEDecompressFrame> m_spDecoderFrames[APE_MAXIMUM_THREADS];
+    int m_aryFreeDecoders[APE_MAXIMUM_THREADS];
+    int m_nFreeDecoders;
+    int m_nDecoders;
+    CSemaphore m_semDecoders;
+    CSemaphore m_semDecodersLock;
 
     // start / finish information
     int64 m_nStartBlock;
     int64 m_nFinishBlock;
     int64 m_nCurrentBlock;
+    int64 m_nBlocksToSkip; // the blocks before the seek point in the next frame scheduled
+    int64 m_nSeekMicroseconds;
+    TICK_COUNT_TYPE m_nSeekStartTime;
+    bool m_bSeekTiming; // a seek is being timed (until its first frame is ready)
     bool m_bIsRanged;
     bool m_bDecompressorInitialized;
+    int m_nDecompressorResult; // the result of creating the workers
 
     // decoding tools
     int InitializeDecompressor();
-    int ScheduleFrameDecode(CAPEDecompressCore * pWorker, int64 nFrameIndex);
+    int SeekToBlock(int64 nBlockOffset);
+    void ScheduleFrames();
+    void FillFrame(CAPEDecompressFrame * pFrame, int64 nFrameIndex);
+    CAPEDecompressFrame * GetCurrentFrame(int * pResult);
+    void RetireCurrentFrame();
+    CAPEDecompressFrame * WaitForFrame();
+    void RetireFrame();
+    void CancelFrames();
+    int SetSampleFormat(int nSampleFormat, uint32 nChannelMask, bool bPlanar);
+    int GetProcessing(const APE_GET_DATA_PROCESSING * pProcessing);
+    void ProcessData(unsigned char * pBuffer, int64 nBlocksDecoded, APE_GET_DATA_PROCESSING * pProcessing, int nProcessed);
 
     // more decoding components
     CSmartPtr<CAPEInfo> m_spAPEInfo;
-
-    // decoding buffer
-    CCircleBuffer m_cbFrameBuffer;
 };
 
 }
@@ -3,14 +3,161 @@
 #include "APEDecompressCore.h"
 #include "APEInfo.h"
 #include "NewPredictor.h"
+#include "UnBitArray.h"
 #include "FloatTransform.h"
 #include "MemoryIO.h"
+#include "CRC.h"
+#include "OutputProcessing.h"
+#include "OutputConversion.h"
 
 namespace APE
 {
 
-CAPEDecompressCore::CAPEDecompressCore(int * pErrorCode, CAPEDecompress * pDecompress, CAPEInfo * pAPEInfo)
-: m_semProcess(1), m_semReady(1)
+// how many blocks are decoded in a pass (a cancelled frame is noticed between passes, and in staged
+// decoding each stage runs over the whole pass)
+#define DECODE_BLOCKS_PER_PASS 4096
+
+// the most threads (counting the core's own) that share the NN filters of a pass when decoding parallel channels
+#define DECODE_CHANNEL_THREADS 4
+
+// the calls interleaved decoding makes for each value, bound at compile time for the classes themselves (the
+// interfaces make the virtual calls)
+template <class UNBITARRAY> static __forceinline int64 DecodeValueRange(CUnBitArrayBase * pUnBitArray, UNBIT_ARRAY_STATE & BitArrayState)
+{
+    return static_cast<UNBITARRAY *>(pUnBitArray)->UNBITARRAY::DecodeValueRange(BitArrayState);
+}
+
+template <> __forceinline int64 DecodeValueRange<CUnBitArrayBase>(CUnBitArrayBase * pUnBitArray, UNBIT_ARRAY_STATE & BitArrayState)
+{
+    return pUnBitArray->DecodeValueRange(BitArrayState);
+}
+
+template <class PREDICTOR> static __forceinline int DecompressValue(IPredictorDecompress * pPredictor, int64 nA, int64 nB = 0)
+{
+    return static_cast<PREDICTOR *>(pPredictor)->PREDICTOR::DecompressValue(nA, nB);
+}
+
+template <> __forceinline int DecompressValue<IPredictorDecompress>(IPredictorDecompress * pPredictor, int64 nA, int64 nB)
+{
+    return pPredictor->DecompressValue(nA, nB);
+}
+
+/**************************************************************************************************
+CAPEDecompressFrame
+**************************************************************************************************/
+CAPEDecompressFrame::CAPEDecompressFrame()
+: m_semReady(1)
+{
+    m_semReady.Wait();
+
+    m_nFrameIndex = 0;
+    m_nFrameBlocks = 0;
+    m_nSeekByte = 0;
+    m_nInputBytes = 0;
+    m_nSkipBytes = 0;
+    m_pInputData = APE_NULL;
+    m_nProcessing = 0;
+    m_nSampleFormat = 0;
+    m_nChannelMask = 0;
+    m_bPlanar = false;
+    m_nSkipBlocks = 0;
+    m_nErrorState = ERROR_SUCCESS;
+    m_nPlaneBlocks = 0;
+}
+
+/**************************************************************************************************
+CAPEDecompressChannelWorker
+**************************************************************************************************/
+CAPEDecompressChannelWorker::CAPEDecompressChannelWorker(CWorkerPool * pWorkerPool)
+: m_semProcess(1), m_semDone(1)
+{
+    m_semProcess.Wait();
+    m_semDone.Wait();
+
+    m_pWorkerPool = pWorkerPool;
+    APE_CLEAR(m_aryPredictor);
+    APE_CLEAR(m_aryValues);
+    m_nChannels = 0;
+    m_nBlocks = 0;
+    m_bError = false;
+    m_bExit = false;
+}
+
+CAPEDecompressChannelWorker::~CAPEDecompressChannelWorker()
+{
+    // stop the thread (or wait for a pass running on the worker pool)
+    Exit();
+    Wait();
+    WaitForTask();
+}
+
+void CAPEDecompressChannelWorker::AddChannel(IPredictorDecompress * pPredictor, int64 * paryValues)
+{
+    m_aryPredictor[m_nChannels] = pPredictor;
+    m_aryValues[m_nChannels] = paryValues;
+    m_nChannels++;
+}
+
+void CAPEDecompressChannelWorker::Filter(int nBlocks)
+{
+    m_nBlocks = nBlocks;
+    m_bError = false;
+
+    if (m_pWorkerPool != APE_NULL)
+        m_pWorkerPool->Submit(this);
+    else
+        m_semProcess.Post();
+}
+
+bool CAPEDecompressChannelWorker::WaitForFilter()
+{
+    if (m_pWorkerPool != APE_NULL)
+        m_pWorkerPool->WaitForTask(this);
+    else
+        m_semDone.Wait();
+    m_nChannels = 0;
+    return !m_bError;
+}
+
+void CAPEDecompressChannelWorker::Exit()
+{
+    m_bExit = true;
+
+    m_semProcess.Post();
+}
+
+void CAPEDecompressChannelWorker::Run()
+{
+    while (true)
+    {
+        m_semProcess.Wait();
+
+        if (m_bExit) break;
+
+        RunTask();
+
+        m_semDone.Post();
+    }
+}
+
+void CAPEDecompressChannelWorker::RunTask()
+{
+    try
+    {
+        if (m_nChannels > 0)
+            m_aryPredictor[0]->DecompressFilters(m_aryPredictor, m_aryValues, m_nChannels, m_nBlocks);
+    }
+    catch (...)
+    {
+        m_bError = true;
+    }
+}
+
+/**************************************************************************************************
+CAPEDecompressCore
+**************************************************************************************************/
+CAPEDecompressCore::CAPEDecompressCore(int * pErrorCode, CAPEDecompress * pDecompress, CAPEInfo * pAPEInfo, CWorkerPool * pWorkerPool)
+: m_semProcess(1)
 {
     m_semProcess.Wait();
 
@@ -19,6 +166,7 @@ CAPEDecompressCore::CAPEDecompressCore(int * pErrorCode, CAPEDecompress * pDecom
     // open / analyze the file
     m_pAPEInfo = pAPEInfo;
     m_pDecompress = pDecompress;
+    m_pWorkerPool = pWorkerPool;
 
     // get format information
     APE_CLEAR(m_wfeInput);
@@ -27,19 +175,28 @@ CAPEDecompressCore::CAPEDecompressCore(int * pErrorCode, CAPEDecompress * pDecom
 
     // initialize other stuff
     m_nInputBytes = 0;
+    m_pFrameInput = APE_NULL;
+    m_nFrameInputBytes = 0;
     m_nSkipBytes = 0;
     m_bDecompressorInitialized = false;
     m_nFrameBlocks = 0;
+    m_nSkipBlocks = 0;
     m_bErrorDecodingCurrentFrame = false;
     m_bInterimMode = false;
     m_nLastX = 0;
     m_nSpecialCodes = 0;
     m_nCRC = 0;
     m_nStoredCRC = 0;
-    m_nErrorState = ERROR_SUCCESS;
-    m_bCancelFrame = false;
+    m_pFrameBuffer = APE_NULL;
+    m_pConvertedBuffer = APE_NULL;
+    m_nSampleFormat = 0;
+    m_nChannelMask = 0;
+    m_nPlaneBytes = 0;
+    m_pCancelled = APE_NULL;
     m_bExit = false;
     APE_CLEAR(m_aryBitArrayStates);
+    m_nDecodeMode = APE_DECODE_MODE_INTERLEAVED;
+    m_nChannelWorkers = 0;
 
     // channel data
     m_sparyChannelData.Assign(new int [APE_MAXIMUM_CHANNELS], true);
@@ -54,13 +211,28 @@ CAPEDecompressCore::CAPEDecompressCore(int * pErrorCode, CAPEDecompress * pDecom
         *pErrorCode = ERROR_UNDEFINED;
         return;
     }
+
+    // the predictors are built for the compression level, so a file with a level they don't know can't be decoded
+    // (insane came in with 3.95)
+    const int64 nCompressionLevel = m_pAPEInfo->GetInfo(IAPEDecompress::APE_INFO_COMPRESSION_LEVEL);
+    const int64 nMaximumCompressionLevel = (m_pAPEInfo->GetInfo(IAPEDecompress::APE_INFO_FILE_VERSION) >= 3950) ? APE_COMPRESSION_LEVEL_INSANE : APE_COMPRESSION_LEVEL_EXTRA_HIGH;
+    if (((nCompressionLevel % 1000) != 0) || (nCompressionLevel < APE_COMPRESSION_LEVEL_FAST) || (nCompressionLevel > nMaximumCompressionLevel))
+    {
+        *pErrorCode = ERROR_INVALID_INPUT_FILE;
+        return;
+    }
 }
 
 CAPEDecompressCore::~CAPEDecompressCore()
 {
-    // stop any threading
+    // stop any threading (or wait for a frame running on the worker pool)
     Exit();
     Wait();
+    WaitForTask();
+
+    // stop the channel workers
+    for (int z = 0; z < m_nChannelWorkers; z++)
+        m_spChannelWorkers[z].Delete();
 
     // delete the predictors
     for (int z = 0; z < APE_MAXIMUM_CHANNELS; z++)
@@ -78,69 +250,132 @@ void CAPEDecompressCore::Run()
 
         if (m_bExit) break;
 
-        int nResult = DecodeFrame();
-        if (nResult != ERROR_SUCCESS)
-            SetErrorState(nResult);
-        else
-            m_semReady.Post();
+        RunTask();
     }
 }
 
-void CAPEDecompressCore::DecodeFrame(int nSkipBytes, int64 nFrameBlocks)
+void CAPEDecompressCore::RunTask()
 {
-    m_spUnBitArray->FillAndResetBitArray(0, static_cast<int64>(nSkipBytes) * 8);
-    m_nSkipBytes = nSkipBytes;
-    m_nFrameBlocks = nFrameBlocks;
-    m_nErrorState = ERROR_SUCCESS;
-    m_bCancelFrame = false;
-
-    m_semProcess.Post();
+    // keep taking frames until the decoding window has nothing left to start
+    CAPEDecompressFrame * pFrame = APE_NULL;
+    while ((pFrame = m_pDecompress->GetNextFrame(this)) != APE_NULL)
+    {
+        pFrame->m_nErrorState = DecodeFrame(pFrame);
+        pFrame->m_semReady.Post();
+    }
 }
 
-void CAPEDecompressCore::CancelFrame()
+void CAPEDecompressCore::Wake()
 {
-    m_bCancelFrame = true;
+    if (m_pWorkerPool != APE_NULL)
+        m_pWorkerPool->Submit(this);
+    else
+        m_semProcess.Post();
 }
 
-unsigned char * CAPEDecompressCore::GetInputBuffer(uint32 nInputBytes)
+int CAPEDecompressCore::DecodeFrame(CAPEDecompressFrame * pFrame)
 {
-    if (m_nInputBytes < nInputBytes)
+    RETURN_ON_ERROR(InitializeDecompressor())
+
+    // get the frame's input
+    int nResult = GetFrameInput(pFrame);
+
+    // decode
+    if (nResult == ERROR_SUCCESS)
     {
-        m_spInputData.Assign(new unsigned char[static_cast<size_t>(nInputBytes)], true);
-        m_spIO.Assign(new CMemoryIO(m_spInputData, static_cast<int>(nInputBytes)));
-        m_spUnBitArray.Assign(CreateUnBitArray(m_pDecompress, m_spIO, static_cast<int>(m_pDecompress->GetInfo(IAPEDecompress::APE_INFO_FILE_VERSION))));
-        m_nInputBytes = nInputBytes;
+        m_nSkipBytes = pFrame->m_nSkipBytes;
+        ResetBitArray();
+        m_nFrameBlocks = pFrame->m_nFrameBlocks;
+        m_nSkipBlocks = APE_CAP(pFrame->m_nSkipBlocks, static_cast<int64>(0), m_nFrameBlocks);
+        m_pFrameBuffer = &pFrame->m_cbFrameBuffer;
+        m_pConvertedBuffer = APE_NULL;
+        m_pCancelled = &pFrame->m_Cancelled;
+
+        // skipped blocks and converted frames are decoded a pass at a time into a buffer that stays in the
+        // cache (the CRC is of the packed PCM, so it's still made)
+        if (((pFrame->m_nSampleFormat != 0) || (m_nSkipBlocks > 0)) && (m_cbPackedOutput.GetMaxDirectWriteBytes() == 0))
+            m_cbPackedOutput.CreateBuffer(static_cast<uint32>(DECODE_BLOCKS_PER_PASS * m_nBlockAlign), static_cast<uint32>(DECODE_BLOCKS_PER_PASS * m_nBlockAlign));
+
+        // a converted frame is then converted into the frame's buffer (a planar frame has a plane for each
+        // channel, as long as the frame's output)
+        pFrame->m_nPlaneBlocks = 0;
+        m_nPlaneBytes = 0;
+        if (pFrame->m_nSampleFormat != 0)
+        {
+            m_pFrameBuffer = &m_cbPackedOutput;
+            m_pConvertedBuffer = &pFrame->m_cbFrameBuffer;
+            m_nSampleFormat = pFrame->m_nSampleFormat;
+            m_nChannelMask = pFrame->m_nChannelMask;
+            if (pFrame->m_bPlanar)
+            {
+                pFrame->m_nPlaneBlocks = m_nFrameBlocks - m_nSkipBlocks;
+                m_nPlaneBytes = pFrame->m_nPlaneBlocks * COutputConversion::GetBytesPerSample(m_nSampleFormat);
+            }
+        }
+
+        nResult = DecodeFrame();
+
+        m_pFrameBuffer = APE_NULL;
+        m_pConvertedBuffer = APE_NULL;
+        m_pCancelled = APE_NULL;
     }
 
-    return m_spInputData;
-}
+    // on failure the frame buffer is left empty, and otherwise it gets the output processing here (so it
+    // runs on the workers instead of when the data is read)
+    if (nResult != ERROR_SUCCESS)
+    {
+        pFrame->m_cbFrameBuffer.Empty();
+    }
+    else if (pFrame->m_nProcessing != 0)
+    {
+        const int nBytesPerSample = m_wfeInput.wBitsPerSample / 8;
+        COutputProcessing::Process(pFrame->m_cbFrameBuffer.GetDirectReadPointer(), static_cast<int64>(pFrame->m_cbFrameBuffer.MaxGet()) / nBytesPerSample, nBytesPerSample, pFrame->m_nProcessing);
+    }
 
-void CAPEDecompressCore::GetFrameData(unsigned char * pBuffer)
-{
-    m_cbFrameBuffer.Get(pBuffer, GetFrameBytes());
+    return nResult;
 }
 
-uint32 CAPEDecompressCore::GetFrameBytes() const
+int CAPEDecompressCore::GetFrameInput(CAPEDecompressFrame * pFrame)
 {
-    if (m_bCancelFrame || m_nErrorState != ERROR_SUCCESS)
-        return 0;
+    // the bit array is sized for the biggest frame so far
+    if (m_nInputBytes < pFrame->m_nInputBytes)
+    {
+        m_nInputBytes = pFrame->m_nInputBytes;
+        m_spInputData.Delete();
+        m_spIO.Assign(new CMemoryIO(APE_NULL, static_cast<int>(m_nInputBytes)));
+        m_spUnBitArray.Assign(CreateUnBitArray(m_pDecompress, m_spIO, static_cast<int>(m_pDecompress->GetInfo(IAPEDecompress::APE_INFO_FILE_VERSION))));
+    }
 
-    return static_cast<uint32>(m_nFrameBlocks) * static_cast<uint32>(m_nBlockAlign);
-}
+    // decode the frame in place if we can (it's followed by the padding the bit array needs)
+    if (pFrame->m_pInputData != APE_NULL)
+    {
+        m_pFrameInput = pFrame->m_pInputData;
+        m_nFrameInputBytes = pFrame->m_nInputBytes;
+        m_spIO->SetBuffer(m_pFrameInput, static_cast<int>(m_nFrameInputBytes));
+        return ERROR_SUCCESS;
+    }
 
-int CAPEDecompressCore::SetErrorState(int nError)
-{
-    m_nErrorState = nError;
-    m_cbFrameBuffer.Empty();
+    // otherwise read it (into a buffer with the padding after it)
+    if (m_spInputData == APE_NULL)
+        m_spInputData.Assign(new unsigned char [static_cast<size_t>(m_nInputBytes) + UNBIT_ARRAY_PADDING_BYTES], true);
 
-    m_semReady.Post();
+    // the input is bounded by this frame's bytes, not the buffer's, so a bigger frame read earlier can't be
+    // decoded past the end of this one (the last frame can be up to four bytes short of the end, so those get
+    // cleared with the padding)
+    memset(&m_spInputData[pFrame->m_nInputBytes - 4], 0, 4 + UNBIT_ARRAY_PADDING_BYTES);
 
-    return m_nErrorState;
+    m_pFrameInput = m_spInputData;
+    m_nFrameInputBytes = pFrame->m_nInputBytes;
+    m_spIO->SetBuffer(m_pFrameInput, static_cast<int>(m_nFrameInputBytes));
+    return m_pDecompress->ReadFrame(pFrame, m_spInputData);
 }
 
-int CAPEDecompressCore::GetErrorState() const
+void CAPEDecompressCore::ResetBitArray()
 {
-    return m_nErrorState;
+    // the bit array reads straight from the frame if it can, otherwise it goes through the memory I/O object
+    const uint32 nBitIndex = static_cast<uint32>(m_nSkipBytes) * 8;
+    if (!m_spUnBitArray->SetInput(m_pFrameInput, m_nFrameInputBytes, nBitIndex))
+        m_spUnBitArray->FillAndResetBitArray(0, nBitIndex);
 }
 
 int CAPEDecompressCore::InitializeDecompressor()
@@ -156,9 +391,6 @@ int CAPEDecompressCore::InitializeDecompressor()
     if ((m_nBlockAlign <= 0) || (m_nBlockAlign > 256))
         return ERROR_INVALID_INPUT_FILE;
 
-    // create a frame buffer
-    m_cbFrameBuffer.CreateBuffer(static_cast<uint32>(m_pDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCKS_PER_FRAME)) * static_cast<uint32>(m_nBlockAlign), static_cast<uint32>(m_nBlockAlign * 64));
-
     // create the predictors
     const int nChannels = APE_MIN(APE_MAX(static_cast<int>(m_pDecompress->GetInfo(IAPEDecompress::APE_INFO_CHANNELS)), 1), 32);
     const int nCompressionLevel = static_cast<int>(m_pDecompress->GetInfo(IAPEDecompress::APE_INFO_COMPRESSION_LEVEL));
@@ -177,6 +409,26 @@ int CAPEDecompressCore::InitializeDecompressor()
             m_aryPredictor[nChannel] = new CPredictorDecompressNormal3930to3950(nCompressionLevel, nVersion);
     }
 
+    // the values of a pass are kept a channel at a time for the output (mono gets an empty second channel), and
+    // staged decoding keeps each channel's residuals together too
+    m_nDecodeMode = m_pDecompress->GetDecodeMode();
+    const int nBufferChannels = APE_MAX(nChannels, 2);
+    m_sparyValues.Assign(new int [static_cast<size_t>(nBufferChannels) * DECODE_BLOCKS_PER_PASS], true);
+    if (m_nDecodeMode != APE_DECODE_MODE_INTERLEAVED)
+        m_sparyResiduals.Assign(new int64 [static_cast<size_t>(nBufferChannels) * DECODE_BLOCKS_PER_PASS], true);
+
+    // start the workers that share the channels' filters with us (tasks on the worker pool if we're on
+    // it, so they come out of its thread budget, or threads of their own)
+    if (m_nDecodeMode == APE_DECODE_MODE_PARALLEL_CHANNELS)
+    {
+        for (m_nChannelWorkers = 0; m_nChannelWorkers < APE_MIN(nChannels, DECODE_CHANNEL_THREADS) - 1; m_nChannelWorkers++)
+        {
+            m_spChannelWorkers[m_nChannelWorkers].Assign(new CAPEDecompressChannelWorker(m_pWorkerPool));
+            if (m_pWorkerPool == APE_NULL)
+                m_spChannelWorkers[m_nChannelWorkers]->Start();
+        }
+    }
+
     return ERROR_SUCCESS;
 }
 
@@ -185,11 +437,9 @@ Decodes blocks of data
 **************************************************************************************************/
 int CAPEDecompressCore::DecodeFrame()
 {
-    InitializeDecompressor();
-
     int nResult = ERROR_SUCCESS;
 
-    m_cbFrameBuffer.Empty();
+    EmptyOutput();
 
     // determine the maximum blocks we can decode
     // note that we won't do end capping because we can't use data
@@ -209,8 +459,32 @@ int CAPEDecompressCore::DecodeFrame()
         // start the frame
         StartFrame();
 
-        // decode data
-        DecodeBlocksToFrameBuffer(nBlocksThisPass);
+        // decode data (in pieces, so a cancelled frame stops quickly, and the blocks before a seek point
+        // get pieces of their own so they're never output)
+        int64 nBlocksDecoded = 0;
+        while ((nBlocksDecoded < nBlocksThisPass) && !m_bErrorDecodingCurrentFrame)
+        {
+            if ((m_pCancelled != APE_NULL) && m_pCancelled->Get())
+            {
+                EmptyOutput();
+                return ERROR_USER_STOPPED_PROCESSING;
+            }
+
+            int64 nBlocks = APE_MIN(nBlocksThisPass - nBlocksDecoded, static_cast<int64>(DECODE_BLOCKS_PER_PASS));
+            if (nBlocksDecoded < m_nSkipBlocks)
+            {
+                nBlocks = APE_MIN(nBlocks, m_nSkipBlocks - nBlocksDecoded);
+                SkipBlocks(nBlocks);
+            }
+            else
+            {
+                DecodeBlocksToFrameBuffer(nBlocks);
+                if (m_pConvertedBuffer != APE_NULL)
+                    ConvertOutput();
+            }
+
+            nBlocksDecoded += nBlocks;
+        }
 
         // end the frame
         EndFrame();
@@ -219,7 +493,7 @@ int CAPEDecompressCore::DecodeFrame()
         if (m_bErrorDecodingCurrentFrame)
         {
             // remove any decoded data for this frame from the buffer
-            m_cbFrameBuffer.Empty();
+            EmptyOutput();
 
             // enter interim mode if we're a 24-bit file and try the frame again
             // this is because for a while (from the addition of 32-bit to version 8.50) we would encode the file using int64 values instead of int32 values for a couple things
@@ -231,7 +505,7 @@ int CAPEDecompressCore::DecodeFrame()
                     if (m_aryPredictor[z] != APE_NULL)
                         m_aryPredictor[z]->SetInterimMode(true);
                 }
-                m_spUnBitArray->FillAndResetBitArray(0, static_cast<int64>(m_nSkipBytes) * 8);
+                ResetBitArray();
                 continue;
             }
             else
@@ -247,117 +521,344 @@ int CAPEDecompressCore::DecodeFrame()
     return nResult;
 }
 
+void CAPEDecompressCore::EmptyOutput()
+{
+    m_pFrameBuffer->Empty();
+    if (m_pConvertedBuffer != APE_NULL)
+        m_pConvertedBuffer->Empty();
+}
+
+void CAPEDecompressCore::SkipBlocks(int64 nBlocks)
+{
+    // the blocks are decoded into the pass buffer (for the CRC) and dropped, so they're never processed,
+    // converted, or put in the frame
+    CCircleBuffer * pFrameBuffer = m_pFrameBuffer;
+    m_pFrameBuffer = &m_cbPackedOutput;
+
+    DecodeBlocksToFrameBuffer(nBlocks);
+
+    m_cbPackedOutput.Empty();
+    m_pFrameBuffer = pFrameBuffer;
+}
+
+void CAPEDecompressCore::ConvertOutput()
+{
+    // the pass was decoded into an empty buffer, so it's in one piece; it's converted into the planes all
+    // at once, or else as much at a time as the frame takes at its write pointer
+    const int nBlocks = static_cast<int>(m_pFrameBuffer->MaxGet()) / m_nBlockAlign;
+    const int nOutputBlockAlign = COutputConversion::GetChannels(m_nChannelMask) * COutputConversion::GetBytesPerSample(m_nSampleFormat);
+    const int nMaxChunkBlocks = APE_MAX(static_cast<int>(m_pConvertedBuffer->GetMaxDirectWriteBytes()) / nOutputBlockAlign, 1);
+    const bool bFloat = (m_pAPEInfo->GetInfo(IAPEDecompress::APE_INFO_FORMAT_FLAGS) & APE_FORMAT_FLAG_FLOATING_POINT) != 0;
+    const unsigned char * pInput = m_pFrameBuffer->GetDirectReadPointer();
+
+    if (m_nPlaneBytes != 0)
+    {
+        // each channel goes after the blocks already in its plane (the frame's buffer started out empty, so
+        // its read pointer is the start of the first plane)
+        const int64 nOutputBlocks = static_cast<int64>(m_pConvertedBuffer->MaxGet()) / nOutputBlockAlign;
+        unsigned char * pOutput = &m_pConvertedBuffer->GetDirectReadPointer()[nOutputBlocks * COutputConversion::GetBytesPerSample(m_nSampleFormat)];
+        COutputConversion::Convert(pInput, nBlocks, &m_wfeInput, bFloat, m_nSampleFormat, m_nChannelMask, pOutput, m_nPlaneBytes);
+        m_pConvertedBuffer->UpdateAfterDirectWrite(static_cast<uint32>(nBlocks * nOutputBlockAlign));
+    }
+    else
+    {
+        for (int nStart = 0; nStart < nBlocks; )
+        {
+            const int nChunkBlocks = APE_MIN(nBlocks - nStart, nMaxChunkBlocks);
+            COutputConversion::Convert(&pInput[nStart * m_nBlockAlign], nChunkBlocks, &m_wfeInput, bFloat, m_nSampleFormat, m_nChannelMask, m_pConvertedBuffer->GetDirectWritePointer(), 0);
+            m_pConvertedBuffer->UpdateAfterDirectWrite(static_cast<uint32>(nChunkBlocks * nOutputBlockAlign));
+            nStart += nChunkBlocks;
+        }
+    }
+
+    m_pFrameBuffer->Empty();
+}
+
 void CAPEDecompressCore::DecodeBlocksToFrameBuffer(int64 nBlocks)
 {
     // decode the samples
-    int nBlocksProcessed = 0;
-    const int nFrameBufferBytes = static_cast<int>(m_cbFrameBuffer.MaxGet());
+    const int nFrameBufferBytes = static_cast<int>(m_pFrameBuffer->MaxGet());
 
     try
     {
-        if (m_wfeInput.nChannels > 2)
+        if (m_nDecodeMode != APE_DECODE_MODE_INTERLEAVED)
+            DecodeBlocksStaged(static_cast<int>(nBlocks));
+        else
+            DecodeBlocksInterleaved(static_cast<int>(nBlocks));
+    }
+    catch(...)
+    {
+        m_bErrorDecodingCurrentFrame = true;
+    }
+
+    // get actual blocks that have been decoded and added to the frame buffer
+    int nActualBlocks = (static_cast<int>(m_pFrameBuffer->MaxGet()) - nFrameBufferBytes) / m_nBlockAlign;
+    nActualBlocks = APE_MAX(nActualBlocks, 0);
+    if (nBlocks != nActualBlocks)
+        m_bErrorDecodingCurrentFrame = true;
+}
+
+void CAPEDecompressCore::DecodeBlocksInterleaved(int nBlocks)
+{
+    // each block goes through every stage before the next block, and the values are kept for the output
+    // to do the whole pass at once; the current files (3990 on) call the bit array and predictor classes
+    // directly (they're created for the version and bit depth), so each value doesn't make virtual calls
+    if (m_pAPEInfo->GetInfo(IAPEDecompress::APE_INFO_FILE_VERSION) >= 3990)
+    {
+        if (m_wfeInput.wBitsPerSample < 32)
+            DecodeBlocksInterleaved< CUnBitArray, CPredictorDecompress3950toCurrent<int, short> >(nBlocks);
+        else
+            DecodeBlocksInterleaved< CUnBitArray, CPredictorDecompress3950toCurrent<int64, int> >(nBlocks);
+    }
+    else
+    {
+        DecodeBlocksInterleaved<CUnBitArrayBase, IPredictorDecompress>(nBlocks);
+    }
+
+    OutputBlocks(nBlocks);
+}
+
+template <class UNBITARRAY, class PREDICTOR> void CAPEDecompressCore::DecodeBlocksInterleaved(int nBlocks)
+{
+    int * pValuesX = &m_sparyValues[0];
+    int * pValuesY = &m_sparyValues[DECODE_BLOCKS_PER_PASS];
+    if (m_wfeInput.nChannels > 2)
+    {
+        for (int z = 0; z < nBlocks; z++)
         {
-            for (nBlocksProcessed = 0; nBlocksProcessed < nBlocks; nBlocksProcessed++)
+            for (int nChannel = 0; nChannel < m_wfeInput.nChannels; nChannel++)
             {
-                for (int nChannel = 0; nChannel < m_wfeInput.nChannels; nChannel++)
-                {
-                    const int64 nValue = m_spUnBitArray->DecodeValueRange(m_aryBitArrayStates[nChannel]);
-                    const int nValue2 = m_aryPredictor[nChannel]->DecompressValue(nValue, 0);
-                    m_sparyChannelData[nChannel] = nValue2;
-                }
-                m_Prepare.Unprepare(m_sparyChannelData, &m_wfeInput, m_cbFrameBuffer.GetDirectWritePointer());
-                m_cbFrameBuffer.UpdateAfterDirectWrite(static_cast<uint32>(m_nBlockAlign));
+                const int64 nValue = DecodeValueRange<UNBITARRAY>(m_spUnBitArray, m_aryBitArrayStates[nChannel]);
+                m_sparyValues[(nChannel * DECODE_BLOCKS_PER_PASS) + z] = DecompressValue<PREDICTOR>(m_aryPredictor[nChannel], nValue, 0);
             }
         }
-        else if (m_wfeInput.nChannels == 2)
+    }
+    else if (m_wfeInput.nChannels == 2)
+    {
+        if ((m_nSpecialCodes & SPECIAL_FRAME_LEFT_SILENCE) &&
+            (m_nSpecialCodes & SPECIAL_FRAME_RIGHT_SILENCE))
         {
-            if ((m_nSpecialCodes & SPECIAL_FRAME_LEFT_SILENCE) &&
-                (m_nSpecialCodes & SPECIAL_FRAME_RIGHT_SILENCE))
-            {
-                for (nBlocksProcessed = 0; nBlocksProcessed < nBlocks; nBlocksProcessed++)
-                {
-                    int aryValues[2] = { 0, 0 };
-                    m_Prepare.Unprepare(aryValues, &m_wfeInput, m_cbFrameBuffer.GetDirectWritePointer());
-                    m_cbFrameBuffer.UpdateAfterDirectWrite(static_cast<uint32>(m_nBlockAlign));
-                }
-            }
-            else if (m_nSpecialCodes & SPECIAL_FRAME_PSEUDO_STEREO)
+            memset(m_sparyValues, 0, sizeof(int) * 2 * DECODE_BLOCKS_PER_PASS);
+        }
+        else if (m_nSpecialCodes & SPECIAL_FRAME_PSEUDO_STEREO)
+        {
+            for (int z = 0; z < nBlocks; z++)
+                pValuesX[z] = DecompressValue<PREDICTOR>(m_aryPredictor[0], DecodeValueRange<UNBITARRAY>(m_spUnBitArray, m_aryBitArrayStates[0]));
+            memset(pValuesY, 0, sizeof(int) * DECODE_BLOCKS_PER_PASS);
+        }
+        else
+        {
+            if (m_pAPEInfo->GetInfo(IAPEDecompress::APE_INFO_FILE_VERSION) >= 3950)
             {
-                for (nBlocksProcessed = 0; nBlocksProcessed < nBlocks; nBlocksProcessed++)
+                for (int z = 0; z < nBlocks; z++)
                 {
-                    int aryValues[2] = { m_aryPredictor[0]->DecompressValue(m_spUnBitArray->DecodeValueRange(m_aryBitArrayStates[0])), 0 };
-
-                    m_Prepare.Unprepare(aryValues, &m_wfeInput, m_cbFrameBuffer.GetDirectWritePointer());
-                    m_cbFrameBuffer.UpdateAfterDirectWrite(static_cast<uint32>(m_nBlockAlign));
+                    const int64 nY = DecodeValueRange<UNBITARRAY>(m_spUnBitArray, m_aryBitArrayStates[1]);
+                    const int64 nX = DecodeValueRange<UNBITARRAY>(m_spUnBitArray, m_aryBitArrayStates[0]);
+                    const int Y = DecompressValue<PREDICTOR>(m_aryPredictor[1], nY, m_nLastX);
+                    const int X = DecompressValue<PREDICTOR>(m_aryPredictor[0], nX, Y);
+                    m_nLastX = X;
+
+                    pValuesX[z] = X;
+                    pValuesY[z] = Y;
                 }
             }
             else
             {
-                if (m_pAPEInfo->GetInfo(IAPEDecompress::APE_INFO_FILE_VERSION) >= 3950)
+                for (int z = 0; z < nBlocks; z++)
                 {
-                    for (nBlocksProcessed = 0; nBlocksProcessed < nBlocks; nBlocksProcessed++)
-                    {
-                        const int64 nY = m_spUnBitArray->DecodeValueRange(m_aryBitArrayStates[1]);
-                        const int64 nX = m_spUnBitArray->DecodeValueRange(m_aryBitArrayStates[0]);
-                        int Y = m_aryPredictor[1]->DecompressValue(nY, m_nLastX);
-                        int X = m_aryPredictor[0]->DecompressValue(nX, Y);
-                        m_nLastX = X;
-
-                        int aryValues[2] = { X, Y };
-                        unsigned char * pOutput = m_cbFrameBuffer.GetDirectWritePointer();
-                        m_Prepare.Unprepare(aryValues, &m_wfeInput, pOutput);
-                        m_cbFrameBuffer.UpdateAfterDirectWrite(static_cast<uint32>(m_nBlockAlign));
-                    }
-                }
-                else
-                {
-                    for (nBlocksProcessed = 0; nBlocksProcessed < nBlocks; nBlocksProcessed++)
-                    {
-                        int X = m_aryPredictor[0]->DecompressValue(m_spUnBitArray->DecodeValueRange(m_aryBitArrayStates[0]));
-                        int Y = m_aryPredictor[1]->DecompressValue(m_spUnBitArray->DecodeValueRange(m_aryBitArrayStates[1]));
-
-                        int aryValues[2] = { X, Y };
-                        m_Prepare.Unprepare(aryValues, &m_wfeInput, m_cbFrameBuffer.GetDirectWritePointer());
-                        m_cbFrameBuffer.UpdateAfterDirectWrite(static_cast<uint32>(m_nBlockAlign));
-                    }
+                    pValuesX[z] = DecompressValue<PREDICTOR>(m_aryPredictor[0], DecodeValueRange<UNBITARRAY>(m_spUnBitArray, m_aryBitArrayStates[0]));
+                    pValuesY[z] = DecompressValue<PREDICTOR>(m_aryPredictor[1], DecodeValueRange<UNBITARRAY>(m_spUnBitArray, m_aryBitArrayStates[1]));
                 }
             }
         }
-        else if (m_wfeInput.nChannels == 1)
+    }
+    else if (m_wfeInput.nChannels == 1)
+    {
+        if (m_nSpecialCodes & SPECIAL_FRAME_MONO_SILENCE)
         {
-            if (m_nSpecialCodes & SPECIAL_FRAME_MONO_SILENCE)
-            {
-                for (nBlocksProcessed = 0; nBlocksProcessed < nBlocks; nBlocksProcessed++)
-                {
-                    int aryValues[2] = { 0, 0 };
-                    m_Prepare.Unprepare(aryValues, &m_wfeInput, m_cbFrameBuffer.GetDirectWritePointer());
-                    m_cbFrameBuffer.UpdateAfterDirectWrite(static_cast<uint32>(m_nBlockAlign));
-                }
-            }
-            else
+            memset(pValuesX, 0, sizeof(int) * DECODE_BLOCKS_PER_PASS);
+        }
+        else
+        {
+            for (int z = 0; z < nBlocks; z++)
+                pValuesX[z] = DecompressValue<PREDICTOR>(m_aryPredictor[0], DecodeValueRange<UNBITARRAY>(m_spUnBitArray, m_aryBitArrayStates[0]));
+        }
+        memset(pValuesY, 0, sizeof(int) * DECODE_BLOCKS_PER_PASS);
+    }
+    else
+    {
+        // nothing can be decoded
+        throw(1);
+    }
+}
+
+void CAPEDecompressCore::DecodeBlocksStaged(int nBlocks)
+{
+    // each stage runs over all the blocks before the next stage: first the residuals for every channel,
+    // then each channel's NN filters and prediction, and finally the conversion to the output format
+    const int nChannels = m_wfeInput.nChannels;
+
+    if ((nChannels > 2) && (nChannels <= APE_MAXIMUM_CHANNELS))
+    {
+        int aryChannels[APE_MAXIMUM_CHANNELS];
+        for (int nChannel = 0; nChannel < nChannels; nChannel++)
+            aryChannels[nChannel] = nChannel;
+
+        DecodeResiduals(aryChannels, nChannels, nBlocks);
+        FilterChannels(aryChannels, nChannels, nBlocks);
+        for (int nChannel = 0; nChannel < nChannels; nChannel++)
+            PredictChannel(nChannel, nBlocks);
+    }
+    else if (nChannels == 2)
+    {
+        if ((m_nSpecialCodes & SPECIAL_FRAME_LEFT_SILENCE) &&
+            (m_nSpecialCodes & SPECIAL_FRAME_RIGHT_SILENCE))
+        {
+            memset(m_sparyValues, 0, sizeof(int) * 2 * DECODE_BLOCKS_PER_PASS);
+        }
+        else if (m_nSpecialCodes & SPECIAL_FRAME_PSEUDO_STEREO)
+        {
+            const int aryChannels[1] = { 0 };
+            DecodeResiduals(aryChannels, 1, nBlocks);
+            FilterChannels(aryChannels, 1, nBlocks);
+            PredictChannel(0, nBlocks);
+            memset(&m_sparyValues[DECODE_BLOCKS_PER_PASS], 0, sizeof(int) * DECODE_BLOCKS_PER_PASS);
+        }
+        else if (m_pAPEInfo->GetInfo(IAPEDecompress::APE_INFO_FILE_VERSION) >= 3950)
+        {
+            // Y is stored first, and each channel's prediction uses the other channel
+            const int aryChannels[2] = { 1, 0 };
+            DecodeResiduals(aryChannels, 2, nBlocks);
+            FilterChannels(aryChannels, 2, nBlocks);
+
+            const int64 * pResidualsX = &m_sparyResiduals[0];
+            const int64 * pResidualsY = &m_sparyResiduals[DECODE_BLOCKS_PER_PASS];
+            int * pValuesX = &m_sparyValues[0];
+            int * pValuesY = &m_sparyValues[DECODE_BLOCKS_PER_PASS];
+            for (int z = 0; z < nBlocks; z++)
             {
-                for (nBlocksProcessed = 0; nBlocksProcessed < nBlocks; nBlocksProcessed++)
-                {
-                    int aryValues[2] = { m_aryPredictor[0]->DecompressValue(m_spUnBitArray->DecodeValueRange(m_aryBitArrayStates[0])), 0 };
-                    m_Prepare.Unprepare(aryValues, &m_wfeInput, m_cbFrameBuffer.GetDirectWritePointer());
-                    m_cbFrameBuffer.UpdateAfterDirectWrite(static_cast<uint32>(m_nBlockAlign));
-                }
+                const int Y = m_aryPredictor[1]->DecompressPrediction(pResidualsY[z], m_nLastX);
+                const int X = m_aryPredictor[0]->DecompressPrediction(pResidualsX[z], Y);
+                m_nLastX = X;
+
+                pValuesX[z] = X;
+                pValuesY[z] = Y;
             }
         }
+        else
+        {
+            const int aryChannels[2] = { 0, 1 };
+            DecodeResiduals(aryChannels, 2, nBlocks);
+            FilterChannels(aryChannels, 2, nBlocks);
+            PredictChannel(0, nBlocks);
+            PredictChannel(1, nBlocks);
+        }
     }
-    catch(...)
+    else if (nChannels == 1)
     {
-        m_bErrorDecodingCurrentFrame = true;
+        if (m_nSpecialCodes & SPECIAL_FRAME_MONO_SILENCE)
+        {
+            memset(m_sparyValues, 0, sizeof(int) * DECODE_BLOCKS_PER_PASS);
+        }
+        else
+        {
+            const int aryChannels[1] = { 0 };
+            DecodeResiduals(aryChannels, 1, nBlocks);
+            FilterChannels(aryChannels, 1, nBlocks);
+            PredictChannel(0, nBlocks);
+        }
+        memset(&m_sparyValues[DECODE_BLOCKS_PER_PASS], 0, sizeof(int) * DECODE_BLOCKS_PER_PASS);
+    }
+    else
+    {
+        // nothing can be decoded
+        throw(1);
     }
 
-    // get actual blocks that have been decoded and added to the frame buffer
-    int nActualBlocks = (static_cast<int>(m_cbFrameBuffer.MaxGet()) - nFrameBufferBytes) / m_nBlockAlign;
-    nActualBlocks = APE_MAX(nActualBlocks, 0);
-    if (nBlocks != nActualBlocks)
-        m_bErrorDecodingCurrentFrame = true;
+    OutputBlocks(nBlocks);
+}
 
-    // update CRC
-    m_nCRC = m_cbFrameBuffer.UpdateCRC(m_nCRC, static_cast<uint32>(m_wfeInput.wBitsPerSample / 8), static_cast<uint32>(nActualBlocks) * m_wfeInput.nChannels);
+void CAPEDecompressCore::OutputBlocks(int nBlocks)
+{
+    // output the pass's values (as many blocks at a time as the frame buffer can take at its write pointer) and
+    // update the CRC while the output is still in the cache
+    const int nMaxChunkBlocks = APE_MAX(static_cast<int>(m_pFrameBuffer->GetMaxDirectWriteBytes()) / m_nBlockAlign, 1);
+    for (int nStart = 0; nStart < nBlocks; )
+    {
+        const int nChunkBlocks = APE_MIN(nBlocks - nStart, nMaxChunkBlocks);
+        unsigned char * pOutput = m_pFrameBuffer->GetDirectWritePointer();
+        const int nDone = m_Prepare.UnprepareBlocks(&m_sparyValues[nStart], DECODE_BLOCKS_PER_PASS, nChunkBlocks, &m_wfeInput, pOutput);
+        m_nCRC = CRC_update_samples(m_nCRC, pOutput, m_wfeInput.wBitsPerSample / 8, nDone * m_wfeInput.nChannels);
+        m_pFrameBuffer->UpdateAfterDirectWrite(static_cast<uint32>(nDone * m_nBlockAlign));
+
+        // a block overflowed the output format
+        if (nDone < nChunkBlocks)
+            throw(-1);
+
+        nStart += nChunkBlocks;
+    }
+}
+
+void CAPEDecompressCore::DecodeResiduals(const int * paryChannels, int nChannels, int nBlocks)
+{
+    // the channels are given in the order they're stored
+    UNBIT_ARRAY_STATE * paryStates[APE_MAXIMUM_CHANNELS];
+    int64 * paryOutput[APE_MAXIMUM_CHANNELS];
+    for (int z = 0; z < nChannels; z++)
+    {
+        paryStates[z] = &m_aryBitArrayStates[paryChannels[z]];
+        paryOutput[z] = &m_sparyResiduals[paryChannels[z] * DECODE_BLOCKS_PER_PASS];
+    }
+
+    m_spUnBitArray->DecodeValuesRange(paryStates, paryOutput, nChannels, nBlocks);
+}
+
+void CAPEDecompressCore::FilterChannels(const int * paryChannels, int nChannels, int nBlocks)
+{
+    // the channels are dealt out to the channel workers and us (each channel's filters only use that channel)
+    const int nThreads = APE_MIN(m_nChannelWorkers + 1, nChannels);
+    for (int z = 0; z < nChannels; z++)
+    {
+        if ((z % nThreads) != 0)
+            m_spChannelWorkers[(z % nThreads) - 1]->AddChannel(m_aryPredictor[paryChannels[z]], &m_sparyResiduals[paryChannels[z] * DECODE_BLOCKS_PER_PASS]);
+    }
+    for (int z = 0; z < nThreads - 1; z++)
+        m_spChannelWorkers[z]->Filter(nBlocks);
+
+    // do our share, all at once (the workers are using the buffers, so they have to be waited for even if we fail)
+    IPredictorDecompress * aryPredictors[APE_MAXIMUM_CHANNELS];
+    int64 * aryValues[APE_MAXIMUM_CHANNELS];
+    int nShare = 0;
+    for (int z = 0; z < nChannels; z += nThreads)
+    {
+        aryPredictors[nShare] = m_aryPredictor[paryChannels[z]];
+        aryValues[nShare] = &m_sparyResiduals[paryChannels[z] * DECODE_BLOCKS_PER_PASS];
+        nShare++;
+    }
+
+    bool bError = false;
+    try
+    {
+        m_aryPredictor[paryChannels[0]]->DecompressFilters(aryPredictors, aryValues, nShare, nBlocks);
+    }
+    catch (...)
+    {
+        bError = true;
+    }
+
+    for (int z = 0; z < nThreads - 1; z++)
+    {
+        if (!m_spChannelWorkers[z]->WaitForFilter())
+            bError = true;
+    }
+
+    if (bError)
+        throw(1);
+}
+
+void CAPEDecompressCore::PredictChannel(int nChannel, int nBlocks)
+{
+    m_aryPredictor[nChannel]->DecompressPredictions(&m_sparyResiduals[nChannel * DECODE_BLOCKS_PER_PASS], &m_sparyValues[nChannel * DECODE_BLOCKS_PER_PASS], nBlocks);
 }
 
 void CAPEDecompressCore::StartFrame()
@@ -409,11 +910,6 @@ void CAPEDecompressCore::EndFrame()
     }
 }
 
-void CAPEDecompressCore::WaitUntilReady()
-{
-    m_semReady.Wait();
-}
-
 void CAPEDecompressCore::Exit()
 {
     m_bExit = true;
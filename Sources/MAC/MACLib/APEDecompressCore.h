@@ -5,50 +5,119 @@
 #include "CircleBuffer.h"
 #include "Thread.h"
 #include "Semaphore.h"
+#include "Atomic.h"
+#include "WorkerPool.h"
 
 namespace APE
 {
 
 class CUnBitArray;
+class CMemoryIO;
 class CPrepare;
 class CAPEInfo;
 class CAPEDecompress;
 class IPredictorDecompress;
 
-class CAPEDecompressCore : public CThread
+/**************************************************************************************************
+CAPEDecompressFrame - a frame in the decoding window (filled in when the frame is scheduled, and
+the results are valid once m_semReady is posted)
+
+When the I/O object holds the file in memory, m_pInputData points at the frame and it's decoded in
+place; otherwise the worker reads it
+
+Setting m_Cancelled makes the worker decoding the frame give up within a few thousand blocks
+**************************************************************************************************/
+class CAPEDecompressFrame
+{
+public:
+    CAPEDecompressFrame();
+
+    // frame information
+    int64 m_nFrameIndex;
+    int64 m_nFrameBlocks;
+    int64 m_nSeekByte;
+    uint32 m_nInputBytes;
+    int m_nSkipBytes;
+    unsigned char * m_pInputData;
+    CAtomicFlag m_Cancelled;
+    int m_nProcessing; // the output processing the worker applies once the frame decodes (see COutputProcessing)
+    int m_nSampleFormat; // the APE_SAMPLE_FORMAT_* the worker converts to (0 leaves the packed PCM GetData(...) reads)
+    uint32 m_nChannelMask; // the channels the conversion keeps
+    bool m_bPlanar; // the conversion puts each channel in a plane of its own
+    int64 m_nSkipBlocks; // the blocks before the seek point (decoded, but not output)
+
+    // results
+    int m_nErrorState;
+    CCircleBuffer m_cbFrameBuffer;
+    int64 m_nPlaneBlocks; // the blocks in each plane of a planar frame (the planes follow each other from the start of the buffer)
+    CSemaphore m_semReady;
+};
+
+/**************************************************************************************************
+CAPEDecompressChannelWorker - runs the NN filters for some of the channels of a pass, while the core
+that owns it does the others
+
+It's a thread of its own, or a task on the shared worker pool when the core is (then the core runs it
+itself if no pool thread has taken it by the time it's waited for, so a busy pool can't stall it)
+**************************************************************************************************/
+class CAPEDecompressChannelWorker : public CThread, public CWorkerPoolTask
+{
+public:
+    CAPEDecompressChannelWorker(CWorkerPool * pWorkerPool = APE_NULL);
+    ~CAPEDecompressChannelWorker();
+
+    void AddChannel(IPredictorDecompress * pPredictor, int64 * paryValues);
+    void Filter(int nBlocks);
+    bool WaitForFilter();
+
+    void Exit();
+
+protected:
+    void Run();
+    void RunTask();
+
+    CSemaphore m_semProcess;
+    CSemaphore m_semDone;
+    CWorkerPool * m_pWorkerPool;
+    IPredictorDecompress * m_aryPredictor[APE_MAXIMUM_CHANNELS];
+    int64 * m_aryValues[APE_MAXIMUM_CHANNELS];
+    int m_nChannels;
+    int m_nBlocks;
+    bool m_bError;
+    bool m_bExit;
+};
+
+/**************************************************************************************************
+CAPEDecompressCore - a worker that decodes frames from the decoding window (on its own thread, or
+on the shared worker pool)
+**************************************************************************************************/
+class CAPEDecompressCore : public CThread, public CWorkerPoolTask
 {
 public:
-    CAPEDecompressCore(int * pErrorCode, CAPEDecompress * pDecompress, CAPEInfo * pAPEInfo);
+    CAPEDecompressCore(int * pErrorCode, CAPEDecompress * pDecompress, CAPEInfo * pAPEInfo, CWorkerPool * pWorkerPool = APE_NULL);
     ~CAPEDecompressCore();
 
     int InitializeDecompressor();
-    void WaitUntilReady();
-    int SetErrorState(int nError);
-    int GetErrorState() const;
+    int DecodeFrame(CAPEDecompressFrame * pFrame);
 
-    void CancelFrame();
+    void Wake();
     void Exit();
 
-    unsigned char * GetInputBuffer(uint32 nInputBytes);
-    void DecodeFrame(int nSkipBytes, int64 nFrameBlocks);
-    void GetFrameData(unsigned char * pBuffer);
-    uint32 GetFrameBytes() const;
-
 protected:
     void Run();
+    void RunTask();
 
     CSemaphore m_semProcess;
-    CSemaphore m_semReady;
 
     // file info
     int m_nBlockAlign;
     int m_nSkipBytes;
     int64 m_nFrameBlocks;
-    int m_nErrorState;
-    bool m_bCancelFrame;
-    CSmartPtr<CIO> m_spIO;
+    int64 m_nSkipBlocks;
+    CSmartPtr<CMemoryIO> m_spIO;
 
     CAPEDecompress * m_pDecompress;
+    CWorkerPool * m_pWorkerPool;
 
     // start / finish information
     bool m_bDecompressorInitialized;
@@ -58,11 +127,28 @@ protected:
     unsigned int m_nStoredCRC;
     int m_nSpecialCodes;
     CSmartPtr<int> m_sparyChannelData;
+    CSmartPtr<int64> m_sparyResiduals;
+    CSmartPtr<int> m_sparyValues;
+    int m_nDecodeMode;
+    CSmartPtr<CAPEDecompressChannelWorker> m_spChannelWorkers[APE_MAXIMUM_CHANNELS];
+    int m_nChannelWorkers;
     CPrepare m_Prepare;
     WAVEFORMATEX m_wfeInput;
 
+    int GetFrameInput(CAPEDecompressFrame * pFrame);
+    void ResetBitArray();
     int DecodeFrame();
     void DecodeBlocksToFrameBuffer(int64 nBlocks);
+    void DecodeBlocksInterleaved(int nBlocks);
+    template <class UNBITARRAY, class PREDICTOR> void DecodeBlocksInterleaved(int nBlocks);
+    void DecodeBlocksStaged(int nBlocks);
+    void OutputBlocks(int nBlocks);
+    void DecodeResiduals(const int * paryChannels, int nChannels, int nBlocks);
+    void FilterChannels(const int * paryChannels, int nChannels, int nBlocks);
+    void PredictChannel(int nChannel, int nBlocks);
+    void SkipBlocks(int64 nBlocks);
+    void ConvertOutput();
+    void EmptyOutput();
     void StartFrame();
     void EndFrame();
 
@@ -76,7 +162,18 @@ protected:
     // decoding buffer
     CSmartPtr<unsigned char> m_spInputData;
     uint32 m_nInputBytes;
-    CCircleBuffer m_cbFrameBuffer;
+    unsigned char * m_pFrameInput;
+    uint32 m_nFrameInputBytes;
+    CCircleBuffer * m_pFrameBuffer;
+
+    // the packed output of a pass that isn't going straight to the frame: skipped blocks, or a converted
+    // frame, where m_pFrameBuffer is this and the frame's buffer gets the conversion (see COutputConversion)
+    CCircleBuffer m_cbPackedOutput;
+    CCircleBuffer * m_pConvertedBuffer;
+    int m_nSampleFormat;
+    uint32 m_nChannelMask;
+    int64 m_nPlaneBytes; // 0 when the conversion is interleaved
+    const CAtomicFlag * m_pCancelled;
     bool m_bErrorDecodingCurrentFrame;
     bool m_bInterimMode;
     bool m_bExit;
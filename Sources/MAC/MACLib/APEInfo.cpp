@@ -8,6 +8,7 @@ CAPEInfo:
 #include "APEHeader.h"
 #include "GlobalFunctions.h"
 #include "WholeFileIO.h"
+#include "MappedFileIO.h"
 
 namespace APE
 {
@@ -73,8 +74,23 @@ CAPEInfo::CAPEInfo(int * pErrorCode, const wchar_t * pFilename, CAPETag * pTag,
         // get size
         const int64 nSize = m_spIO->GetSize();
 
-        // only create if we're less than 200 MB
-        if (nSize < (APE_BYTES_IN_MEGABYTE * 200))
+        // map the file if the application opted in (a mapped file mustn't be truncated while it's open,
+        // see CMappedFileIO), otherwise only create if we're less than 200 MB
+        bool bMapped = false;
+        const int64 nMappedFileThreshold = CMappedFileIO::GetThreshold();
+        if (bReadOnly && (nMappedFileThreshold >= 0) && (nSize >= nMappedFileThreshold))
+        {
+            // pages are read as they're used, and frames are decoded in place
+            CSmartPtr<CMappedFileIO> spMappedFile(new CMappedFileIO);
+            if (spMappedFile->Open(pFilename, true) == ERROR_SUCCESS)
+            {
+                spMappedFile.SetDelete(false);
+                m_spIO.Assign(spMappedFile.GetPtr());
+                bMapped = true;
+            }
+        }
+
+        if (!bMapped && (nSize < (APE_BYTES_IN_MEGABYTE * 200)))
         {
             CWholeFileIO * pWholeFile = CreateWholeFileIO(m_spIO, nSize);
             if (pWholeFile != APE_NULL)
@@ -522,6 +538,7 @@ int64 CAPEInfo::GetInfo(IAPEDecompress::APE_DECOMPRESS_FIELDS Field, int64 nPara
     case IAPEDecompress::APE_DECOMPRESS_CURRENT_BITRATE:
     case IAPEDecompress::APE_DECOMPRESS_AVERAGE_BITRATE:
     case IAPEDecompress::APE_DECOMPRESS_CURRENT_FRAME:
+    case IAPEDecompress::APE_DECOMPRESS_SEEK_MICROSECONDS:
         // all other conditions to prevent compiler warnings (4061, 4062, and Clang)
         break;
     }
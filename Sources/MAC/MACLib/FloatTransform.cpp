@@ -8,17 +8,13 @@ CFloatTransform
 **************************************************************************************************/
 /*static*/ void CFloatTransform::Process(uint32 * pBuffer, int64 nSamples)
 {
+    // flip bits 26 to 29, then flip the bits below the sign of negative values (without a branch, so
+    // the compiler can vectorize it)
     for (int64 n = 0; n < nSamples; n++)
     {
-        const uint32 sampleIn = pBuffer[n];
-        uint32 sampleOut = 0;
+        const uint32 sampleOut = pBuffer[n] ^ 0x3C000000;
+        const uint32 nNegativeMask = static_cast<uint32>(static_cast<int32>(sampleOut) >> 31) & 0x7FFFFFFF;
 
-        sampleOut |= sampleIn & 0xC3FFFFFF;
-        sampleOut |= ~(sampleIn & 0x3C000000) ^ 0xC3FFFFFF;
-
-        if (sampleOut & 0x80000000)
-            sampleOut = ~sampleOut | 0x80000000;
-
-        pBuffer[n] = sampleOut;
+        pBuffer[n] = sampleOut ^ nNegativeMask;
     }
 }
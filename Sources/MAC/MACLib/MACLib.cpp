@@ -8,6 +8,8 @@
 #include "CharacterHelper.h"
 #include "WAVInputSource.h"
 #include "MD5.h"
+#include "WorkerPool.h"
+#include "MappedFileIO.h"
 #ifdef APE_BACKWARDS_COMPATIBILITY
     #include "Old/APEDecompressOld.h"
 #endif
@@ -18,8 +20,6 @@ using namespace APE;
 #define UNMAC_DECODER_OUTPUT_WAV        1
 #define UNMAC_DECODER_OUTPUT_APE        2
 
-#define BLOCKS_PER_DECODE               9216
-
 IAPEDecompress * CreateIAPEDecompressCore(CAPEInfo * pAPEInfo, int nStartBlock, int nFinishBlock, int * pErrorCode);
 int DecompressCore(const APE::str_utfn * pInputFilename, const APE::str_utfn * pOutputFilename, int nOutputMode, int nCompressionLevel, IAPEProgressCallback * pProgressCallback, IAPEDecompress * pDecompress, int nThreads);
 
@@ -337,6 +337,22 @@ void __stdcall GetAPEModeName(APE::APE_MODES Mode, APE::str_utfn * pModeName, si
 
 }
 
+/**************************************************************************************************
+Shared worker pool
+**************************************************************************************************/
+int __stdcall SetSharedWorkerPoolThreads(int nThreads)
+{
+    return CWorkerPool::SetSharedThreads(nThreads);
+}
+
+/**************************************************************************************************
+Memory mapped input
+**************************************************************************************************/
+int64 __stdcall SetMappedFileThreshold(int64 nBytes)
+{
+    return CMappedFileIO::SetThreshold(nBytes);
+}
+
 /**************************************************************************************************
 Simple progress callback
 **************************************************************************************************/
@@ -796,50 +812,53 @@ int DecompressCore(const APE::str_utfn * pInputFilename, const APE::str_utfn * p
         }
 #endif
 
-        // allocate space for decompression
-        spTempBuffer.Assign(new unsigned char [static_cast<size_t>(spAPEDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCK_ALIGN)) * BLOCKS_PER_DECODE], true);
-        if (spTempBuffer == APE_NULL) throw(static_cast<intn>(ERROR_INSUFFICIENT_MEMORY));
-
-        int64 nBlocksLeft = static_cast<intn>(spAPEDecompress->GetInfo(IAPEDecompress::APE_DECOMPRESS_TOTAL_BLOCKS));
+        const int64 nTotalBlocks = spAPEDecompress->GetInfo(IAPEDecompress::APE_DECOMPRESS_TOTAL_BLOCKS);
+        int64 nBlocksLeft = nTotalBlocks;
 
         // create the progress helper
-        spMACProgressHelper.Assign(new CMACProgressHelper(nBlocksLeft / BLOCKS_PER_DECODE, pProgressCallback));
+        spMACProgressHelper.Assign(new CMACProgressHelper(nTotalBlocks, pProgressCallback));
 
         // processing flags
         IAPEDecompress::APE_GET_DATA_PROCESSING Processing = { (nOutputMode != UNMAC_DECODER_OUTPUT_APE), (nOutputMode != UNMAC_DECODER_OUTPUT_APE), (nOutputMode != UNMAC_DECODER_OUTPUT_APE) };
 
-        // main decoding loop
+        // main decoding loop (we take whole frames from the decompressor, which saves copying them)
         while (nBlocksLeft > 0)
         {
             // decode data
+            unsigned char * pDecoded = APE_NULL;
             int64 nBlocksDecoded = -1;
-            const int nResult = spAPEDecompress->GetData(spTempBuffer, BLOCKS_PER_DECODE, &nBlocksDecoded, &Processing);
+            const int nResult = spAPEDecompress->LeaseFrameData(&pDecoded, &nBlocksDecoded, &Processing);
             if (nResult != ERROR_SUCCESS)
                 throw(static_cast<intn>(nResult));
+            if (nBlocksDecoded <= 0)
+                throw(static_cast<intn>(ERROR_DECOMPRESSING_FRAME));
 
             // handle the output
             if (nOutputMode == UNMAC_DECODER_OUTPUT_WAV)
             {
 #if APE_BYTE_ORDER == APE_BIG_ENDIAN
                 if (wfeInput.wBitsPerSample >= 16)
-                    SwitchBufferBytes(spTempBuffer, wfeInput.wBitsPerSample / 8, nBlocksDecoded * wfeInput.nChannels);
+                    SwitchBufferBytes(pDecoded, wfeInput.wBitsPerSample / 8, nBlocksDecoded * wfeInput.nChannels);
 #endif
                 const unsigned int nBytesToWrite = static_cast<unsigned int>(nBlocksDecoded * spAPEDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCK_ALIGN));
                 unsigned int nBytesWritten = 0;
-                const int nWriteResult = spioOutput->Write(spTempBuffer, nBytesToWrite, &nBytesWritten);
+                const int nWriteResult = spioOutput->Write(pDecoded, nBytesToWrite, &nBytesWritten);
                 if ((nWriteResult != 0) || (nBytesToWrite != nBytesWritten))
                     throw(static_cast<intn>(ERROR_IO_WRITE));
             }
             else if (nOutputMode == UNMAC_DECODER_OUTPUT_APE)
             {
-                THROW_ON_ERROR(spAPECompress->AddData(spTempBuffer, (nBlocksDecoded * spAPEDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCK_ALIGN))))
+                THROW_ON_ERROR(spAPECompress->AddData(pDecoded, (nBlocksDecoded * spAPEDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCK_ALIGN))))
             }
 
+            // hand the frame back
+            spAPEDecompress->ReleaseFrameData();
+
             // update amount remaining
             nBlocksLeft -= nBlocksDecoded;
 
             // update progress and kill flag
-            spMACProgressHelper->UpdateProgress();
+            spMACProgressHelper->UpdateProgress(nTotalBlocks - nBlocksLeft);
             if (spMACProgressHelper->ProcessKillFlag() != ERROR_SUCCESS)
                 throw(static_cast<intn>(ERROR_USER_STOPPED_PROCESSING));
         }
@@ -6,13 +6,33 @@
 namespace APE
 {
 
+// points the filter at the implementation built for its order (see GetOrder())
+#define SELECT_NN_FILTER_ORDER(NAME, ORDER)                                     \
+{                                                                               \
+    CompressBlockImpl = &CNNFilter::CompressBlock##NAME<ORDER>;                 \
+    DecompressBlockImpl = &CNNFilter::DecompressBlock##NAME<ORDER>;             \
+}
+
+#define SELECT_NN_FILTER(NAME)                                                  \
+{                                                                               \
+    switch (m_nOrder)                                                           \
+    {                                                                           \
+    case 16: SELECT_NN_FILTER_ORDER(NAME, 16) break;                            \
+    case 32: SELECT_NN_FILTER_ORDER(NAME, 32) break;                            \
+    case 64: SELECT_NN_FILTER_ORDER(NAME, 64) break;                            \
+    case 256: SELECT_NN_FILTER_ORDER(NAME, 256) break;                          \
+    case 1280: SELECT_NN_FILTER_ORDER(NAME, 1280) break;                        \
+    default: SELECT_NN_FILTER_ORDER(NAME, 0) break;                             \
+    }                                                                           \
+}
+
 template <class INTTYPE, class DATATYPE> CNNFilter<INTTYPE, DATATYPE>::CNNFilter(int nOrder, int nShift, int nVersion)
 : m_nOrder(nOrder),
   m_nShift(nShift),
   m_nOneShiftedByShift(static_cast<int>(1 << (m_nShift - 1))),
   m_nVersion(nVersion),
-  m_rbInput(m_nOrder),
-  m_rbDeltaM(m_nOrder)
+  m_rbInput(m_nOrder, m_nOrder * NN_WINDOW_ORDER_MULTIPLE),
+  m_rbDeltaM(m_nOrder, m_nOrder * NN_WINDOW_ORDER_MULTIPLE)
 {
     if (nOrder <= 0)
         throw(1);
@@ -22,53 +42,74 @@ template <class INTTYPE, class DATATYPE> CNNFilter<INTTYPE, DATATYPE>::CNNFilter
     m_bInterimMode = false;
     m_nRunningAverage = 0;
 
-    CompressImpl = &CNNFilter::CompressGeneric;
-    DecompressImpl = &CNNFilter::DecompressGeneric;
+    SELECT_NN_FILTER(Generic)
 
 #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
-    if (GetAVX512Available() && GetAVX512Supported() && (sizeof(INTTYPE) == 8 || nOrder >= 32))
+    // VNNI only helps the 16-bit filters (the 32-bit filters have no VNNI multiply)
+    if (GetAVX512VNNIAvailable() && GetAVX512VNNISupported() && sizeof(INTTYPE) == 4 && nOrder >= 32)
+    {
+        SELECT_NN_FILTER(AVX512VNNI)
+    }
+    else if (GetAVX512Available() && GetAVX512Supported() && (sizeof(INTTYPE) == 8 || nOrder >= 32))
     {
-        CompressImpl = &CNNFilter::CompressAVX512;
-        DecompressImpl = &CNNFilter::DecompressAVX512;
+        SELECT_NN_FILTER(AVX512)
+    }
+    else if (GetAVXVNNIAvailable() && GetAVXVNNISupported() && sizeof(INTTYPE) == 4)
+    {
+        SELECT_NN_FILTER(AVXVNNI)
     }
     else if (GetAVX2Available() && GetAVX2Supported())
     {
-        CompressImpl = &CNNFilter::CompressAVX2;
-        DecompressImpl = &CNNFilter::DecompressAVX2;
+        SELECT_NN_FILTER(AVX2)
     }
     else if (GetSSE41Available() && GetSSE41Supported() && sizeof(INTTYPE) == 8)
     {
-        CompressImpl = &CNNFilter::CompressSSE41;
-        DecompressImpl = &CNNFilter::DecompressSSE41;
+        SELECT_NN_FILTER(SSE41)
     }
     else if (GetSSE2Available() && GetSSE2Supported())
     {
-        CompressImpl = &CNNFilter::CompressSSE2;
-        DecompressImpl = &CNNFilter::DecompressSSE2;
+        SELECT_NN_FILTER(SSE2)
+    }
+#endif
+
+    CompressStreamsImpl = APE_NULL;
+    DecompressStreamsImpl = APE_NULL;
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    // a stream per lane only pays off for short filters (the longer ones fill the registers on their own)
+    if ((sizeof(INTTYPE) == 4) && GetAVX2Available() && GetAVX2Supported())
+    {
+        if (m_nOrder == 16)
+        {
+            CompressStreamsImpl = &CNNFilter::CompressStreamsAVX2<16>;
+            DecompressStreamsImpl = &CNNFilter::DecompressStreamsAVX2<16>;
+        }
+        else if (m_nOrder == 32)
+        {
+            CompressStreamsImpl = &CNNFilter::CompressStreamsAVX2<32>;
+            DecompressStreamsImpl = &CNNFilter::DecompressStreamsAVX2<32>;
+        }
     }
 #endif
 
 #if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
     if (GetNeonAvailable() && GetNeonSupported())
     {
-        CompressImpl = &CNNFilter::CompressNeon;
-        DecompressImpl = &CNNFilter::DecompressNeon;
+        SELECT_NN_FILTER(Neon)
     }
 #endif
 
 #if defined(__riscv)
     if (GetRVVAvailable() && GetRVVSupported())
     {
-        CompressImpl = &CNNFilter::CompressRVV;
-        DecompressImpl = &CNNFilter::DecompressRVV;
+        SELECT_NN_FILTER(RVV)
     }
 #endif
 
 #if defined(__ppc__) || defined(__powerpc__)
     if (GetAltiVecAvailable() && GetAltiVecSupported())
     {
-        CompressImpl = &CNNFilter::CompressAltiVec;
-        DecompressImpl = &CNNFilter::DecompressAltiVec;
+        SELECT_NN_FILTER(AltiVec)
     }
 #endif
 
@@ -92,12 +133,105 @@ template <class INTTYPE, class DATATYPE> void CNNFilter<INTTYPE, DATATYPE>::Flus
     m_nRunningAverage = 0;
 }
 
+template <class INTTYPE, class DATATYPE> void CNNFilter<INTTYPE, DATATYPE>::CompressStreams(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements)
+{
+    ASSERT(nStreams <= NN_FILTER_STREAMS);
+
+    // gather the streams that can run together
+    CNNFilter<INTTYPE, DATATYPE> * aryFilters[NN_FILTER_STREAMS];
+    INTTYPE * aryValues[NN_FILTER_STREAMS];
+    int nLanes = 0;
+    for (int z = 0; z < nStreams; z++)
+    {
+        if ((apFilters[z]->CompressStreamsImpl != APE_NULL) && ((nLanes == 0) || apFilters[z]->CanShareStreams(aryFilters[0])))
+        {
+            aryFilters[nLanes] = apFilters[z];
+            aryValues[nLanes] = apValues[z];
+            nLanes++;
+        }
+        else
+        {
+            apFilters[z]->CompressBlock(apValues[z], apValues[z], nElements);
+        }
+    }
+
+    // a single stream is better off with the filter's own implementation
+    if (nLanes > 1)
+        (*aryFilters[0]->CompressStreamsImpl)(aryFilters, aryValues, nLanes, nElements);
+    else if (nLanes == 1)
+        aryFilters[0]->CompressBlock(aryValues[0], aryValues[0], nElements);
+}
+
+template <class INTTYPE, class DATATYPE> void CNNFilter<INTTYPE, DATATYPE>::DecompressStreams(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements)
+{
+    ASSERT(nStreams <= NN_FILTER_STREAMS);
+
+    // gather the streams that can run together (the interim mode needs a wider sum, so it runs on its own)
+    CNNFilter<INTTYPE, DATATYPE> * aryFilters[NN_FILTER_STREAMS];
+    INTTYPE * aryValues[NN_FILTER_STREAMS];
+    int nLanes = 0;
+    for (int z = 0; z < nStreams; z++)
+    {
+        if ((apFilters[z]->DecompressStreamsImpl != APE_NULL) && !apFilters[z]->m_bInterimMode && ((nLanes == 0) || apFilters[z]->CanShareStreams(aryFilters[0])))
+        {
+            aryFilters[nLanes] = apFilters[z];
+            aryValues[nLanes] = apValues[z];
+            nLanes++;
+        }
+        else
+        {
+            apFilters[z]->DecompressBlock(apValues[z], apValues[z], nElements);
+        }
+    }
+
+    // a single stream is better off with the filter's own implementation
+    if (nLanes > 1)
+        (*aryFilters[0]->DecompressStreamsImpl)(aryFilters, aryValues, nLanes, nElements);
+    else if (nLanes == 1)
+        aryFilters[0]->DecompressBlock(aryValues[0], aryValues[0], nElements);
+}
+
+template <class INTTYPE, class DATATYPE> bool CNNFilter<INTTYPE, DATATYPE>::CanShareStreams(const CNNFilter<INTTYPE, DATATYPE> * pFilter) const
+{
+    return (m_nOrder == pFilter->m_nOrder) && (m_nShift == pFilter->m_nShift) && (m_nVersion == pFilter->m_nVersion);
+}
+
+template <class INTTYPE, class DATATYPE> void CNNFilter<INTTYPE, DATATYPE>::GetStreamState(int nLane, int32 * paryM, int32 * paryInput, int32 * paryDeltaM, int32 * paryRunningAverage)
+{
+    for (int z = 0; z < m_nOrder; z++)
+    {
+        paryM[(z * NN_FILTER_STREAMS) + nLane] = static_cast<uint16>(m_paryM[z]);
+        paryInput[(z * NN_FILTER_STREAMS) + nLane] = static_cast<short>(m_rbInput[z - m_nOrder]);
+        paryDeltaM[(z * NN_FILTER_STREAMS) + nLane] = static_cast<uint16>(m_rbDeltaM[z - m_nOrder]);
+    }
+    paryRunningAverage[nLane] = static_cast<int32>(m_nRunningAverage);
+}
+
+template <class INTTYPE, class DATATYPE> void CNNFilter<INTTYPE, DATATYPE>::SetStreamState(int nLane, const int32 * paryM, const int32 * paryInput, const int32 * paryDeltaM, const int32 * paryRunningAverage)
+{
+    for (int z = 0; z < m_nOrder; z++)
+    {
+        m_paryM[z] = static_cast<short>(paryM[(z * NN_FILTER_STREAMS) + nLane]);
+        m_rbInput[z - m_nOrder] = static_cast<short>(paryInput[(z * NN_FILTER_STREAMS) + nLane]);
+        m_rbDeltaM[z - m_nOrder] = static_cast<short>(paryDeltaM[(z * NN_FILTER_STREAMS) + nLane]);
+    }
+    m_nRunningAverage = paryRunningAverage[nLane];
+}
+
 template CNNFilter<int, short>::CNNFilter(int nOrder, int nShift, int nVersion);
 template CNNFilter<int, short>::~CNNFilter();
 template void CNNFilter<int, short>::Flush();
+template void CNNFilter<int, short>::CompressStreams(CNNFilter<int, short> ** apFilters, int ** apValues, int nStreams, int nElements);
+template void CNNFilter<int, short>::DecompressStreams(CNNFilter<int, short> ** apFilters, int ** apValues, int nStreams, int nElements);
+template void CNNFilter<int, short>::GetStreamState(int nLane, int32 * paryM, int32 * paryInput, int32 * paryDeltaM, int32 * paryRunningAverage);
+template void CNNFilter<int, short>::SetStreamState(int nLane, const int32 * paryM, const int32 * paryInput, const int32 * paryDeltaM, const int32 * paryRunningAverage);
 
 template CNNFilter<int64, int>::CNNFilter(int nOrder, int nShift, int nVersion);
 template CNNFilter<int64, int>::~CNNFilter();
 template void CNNFilter<int64, int>::Flush();
+template void CNNFilter<int64, int>::CompressStreams(CNNFilter<int64, int> ** apFilters, int64 ** apValues, int nStreams, int nElements);
+template void CNNFilter<int64, int>::DecompressStreams(CNNFilter<int64, int> ** apFilters, int64 ** apValues, int nStreams, int nElements);
+template void CNNFilter<int64, int>::GetStreamState(int nLane, int32 * paryM, int32 * paryInput, int32 * paryDeltaM, int32 * paryRunningAverage);
+template void CNNFilter<int64, int>::SetStreamState(int nLane, const int32 * paryM, const int32 * paryInput, const int32 * paryDeltaM, const int32 * paryRunningAverage);
 
 }
@@ -2,8 +2,11 @@
 
 #include "All.h"
 #include "RollBuffer.h"
+#include "CPUFeatures.h"
 
 #define NN_WINDOW_ELEMENTS 512
+#define NN_WINDOW_ORDER_MULTIPLE 4 // the window is also at least this many times the order (so a roll copies at most a quarter of an element per value)
+#define NN_FILTER_STREAMS 8 // the most filters that run in lockstep (see CNNFilter::CompressStreams(...))
 
 namespace APE
 {
@@ -19,46 +22,99 @@ public:
     CNNFilter(int nOrder, int nShift, int nVersion = -1);
     virtual ~CNNFilter();
 
-    INTTYPE Compress(INTTYPE nInput) { return (this->*CompressImpl)(nInput); }
-    INTTYPE Decompress(INTTYPE nInput) { return (this->*DecompressImpl)(nInput); }
+    INTTYPE Compress(INTTYPE nInput) { INTTYPE nOutput; (this->*CompressBlockImpl)(&nInput, &nOutput, 1); return nOutput; }
+    INTTYPE Decompress(INTTYPE nInput) { INTTYPE nOutput; (this->*DecompressBlockImpl)(&nInput, &nOutput, 1); return nOutput; }
+
+    // run a block of values through the filter (the input and output can be the same buffer)
+    void CompressBlock(const INTTYPE * pInput, INTTYPE * pOutput, int nElements) { (this->*CompressBlockImpl)(pInput, pOutput, nElements); }
+    void DecompressBlock(const INTTYPE * pInput, INTTYPE * pOutput, int nElements) { (this->*DecompressBlockImpl)(pInput, pOutput, nElements); }
     void Flush();
 
+    // run several independent filters in lockstep, each over its own values (in place); the filters that
+    // match the first one that can (short ones with the same order, shift and version) run a stream
+    // per SIMD lane, so there's no horizontal sum for each value, and the rest run one at a time
+    static void CompressStreams(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements);
+    static void DecompressStreams(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements);
+
     void SetInterimMode(bool bInterimMode) { m_bInterimMode = bInterimMode; }
 
 private:
-    INTTYPE (CNNFilter<INTTYPE, DATATYPE>::*CompressImpl)(INTTYPE nInput);
-    INTTYPE (CNNFilter<INTTYPE, DATATYPE>::*DecompressImpl)(INTTYPE nInput);
+    void (CNNFilter<INTTYPE, DATATYPE>::*CompressBlockImpl)(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    void (CNNFilter<INTTYPE, DATATYPE>::*DecompressBlockImpl)(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
 
-    INTTYPE CompressGeneric(INTTYPE nInput);
-    INTTYPE DecompressGeneric(INTTYPE nInput);
+    // the lockstep implementations (APE_NULL when the filter always runs on its own)
+    void (*CompressStreamsImpl)(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements);
+    void (*DecompressStreamsImpl)(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements);
 
-#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
-    INTTYPE CompressSSE2(INTTYPE nInput);
-    INTTYPE DecompressSSE2(INTTYPE nInput);
+    // a lockstep stream's state goes in lane nLane of each row (a row is NN_FILTER_STREAMS values); the
+    // 16-bit values are zero extended, except for the input, which is sign extended
+    bool CanShareStreams(const CNNFilter<INTTYPE, DATATYPE> * pFilter) const;
+    void GetStreamState(int nLane, int32 * paryM, int32 * paryInput, int32 * paryDeltaM, int32 * paryRunningAverage);
+    void SetStreamState(int nLane, const int32 * paryM, const int32 * paryInput, const int32 * paryDeltaM, const int32 * paryRunningAverage);
 
-    INTTYPE CompressSSE41(INTTYPE nInput);
-    INTTYPE DecompressSSE41(INTTYPE nInput);
+    // each implementation is built for the orders the predictors use, so the loops have fixed counts
+    // and unroll (ORDER 0 is the fallback that works with any order); the per-value functions are
+    // inlined into the block functions, which are what the filter calls
+    template <int ORDER> __forceinline int GetOrder() const { return (ORDER != 0) ? ORDER : m_nOrder; }
 
-    INTTYPE CompressAVX2(INTTYPE nInput);
-    INTTYPE DecompressAVX2(INTTYPE nInput);
+    template <int ORDER> INTTYPE CompressGeneric(INTTYPE nInput);
+    template <int ORDER> void CompressBlockGeneric(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> INTTYPE DecompressGeneric(INTTYPE nInput);
+    template <int ORDER> void DecompressBlockGeneric(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
 
-    INTTYPE CompressAVX512(INTTYPE nInput);
-    INTTYPE DecompressAVX512(INTTYPE nInput);
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    template <int ORDER> APE_TARGET_SSE2 INTTYPE CompressSSE2(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_SSE2 void CompressBlockSSE2(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> APE_TARGET_SSE2 INTTYPE DecompressSSE2(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_SSE2 void DecompressBlockSSE2(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+
+    template <int ORDER> APE_TARGET_SSE41 INTTYPE CompressSSE41(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_SSE41 void CompressBlockSSE41(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> APE_TARGET_SSE41 INTTYPE DecompressSSE41(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_SSE41 void DecompressBlockSSE41(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+
+    template <int ORDER> APE_TARGET_AVX2 INTTYPE CompressAVX2(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_AVX2 void CompressBlockAVX2(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> APE_TARGET_AVX2 INTTYPE DecompressAVX2(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_AVX2 void DecompressBlockAVX2(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> APE_TARGET_AVX2 static void CompressStreamsAVX2(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements);
+    template <int ORDER> APE_TARGET_AVX2 static void DecompressStreamsAVX2(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements);
+
+    template <int ORDER> APE_TARGET_AVX512 INTTYPE CompressAVX512(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_AVX512 void CompressBlockAVX512(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> APE_TARGET_AVX512 INTTYPE DecompressAVX512(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_AVX512 void DecompressBlockAVX512(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+
+    template <int ORDER> APE_TARGET_AVXVNNI INTTYPE CompressAVXVNNI(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_AVXVNNI void CompressBlockAVXVNNI(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> APE_TARGET_AVXVNNI INTTYPE DecompressAVXVNNI(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_AVXVNNI void DecompressBlockAVXVNNI(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+
+    template <int ORDER> APE_TARGET_AVX512VNNI INTTYPE CompressAVX512VNNI(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_AVX512VNNI void CompressBlockAVX512VNNI(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> APE_TARGET_AVX512VNNI INTTYPE DecompressAVX512VNNI(INTTYPE nInput);
+    template <int ORDER> APE_TARGET_AVX512VNNI void DecompressBlockAVX512VNNI(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
 #endif
 
 #if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
-    INTTYPE CompressNeon(INTTYPE nInput);
-    INTTYPE DecompressNeon(INTTYPE nInput);
+    template <int ORDER> INTTYPE CompressNeon(INTTYPE nInput);
+    template <int ORDER> void CompressBlockNeon(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> INTTYPE DecompressNeon(INTTYPE nInput);
+    template <int ORDER> void DecompressBlockNeon(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
 #endif
 
 #if defined(__riscv)
-    INTTYPE CompressRVV(INTTYPE nInput);
-    INTTYPE DecompressRVV(INTTYPE nInput);
+    template <int ORDER> INTTYPE CompressRVV(INTTYPE nInput);
+    template <int ORDER> void CompressBlockRVV(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> INTTYPE DecompressRVV(INTTYPE nInput);
+    template <int ORDER> void DecompressBlockRVV(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
 #endif
 
 #if defined(__ppc__) || defined(__powerpc__)
-    INTTYPE CompressAltiVec(INTTYPE nInput);
-    INTTYPE DecompressAltiVec(INTTYPE nInput);
+    template <int ORDER> INTTYPE CompressAltiVec(INTTYPE nInput);
+    template <int ORDER> void CompressBlockAltiVec(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
+    template <int ORDER> INTTYPE DecompressAltiVec(INTTYPE nInput);
+    template <int ORDER> void DecompressBlockAltiVec(const INTTYPE * pInput, INTTYPE * pOutput, int nElements);
 #endif
 
     const int m_nOrder;
@@ -2,14 +2,21 @@
 #include "NNFilterCommon.h"
 #include "CPUFeatures.h"
 
-#if defined(__AVX2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC))
+#if defined(__AVX2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC)) || defined(APE_TARGET_ATTRIBUTES_X86)
     #define APE_USE_AVX2_INTRINSICS
 #endif
 
+#if (defined(__AVXVNNI__) && defined(__AVX2__)) || (defined(_MSC_VER) && (_MSC_VER >= 1930) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC)) || defined(APE_TARGET_ATTRIBUTES_X86_VNNI)
+    #define APE_USE_AVXVNNI_INTRINSICS
+#endif
+
 #ifdef APE_USE_AVX2_INTRINSICS
     #include <immintrin.h> // AVX2
 #endif
 
+// how many values of each stream the lockstep filters take at a time
+#define NN_FILTER_STREAM_ROWS 128
+
 namespace APE
 {
 
@@ -22,6 +29,15 @@ bool GetAVX2Available()
 #endif
 }
 
+bool GetAVXVNNIAvailable()
+{
+#ifdef APE_USE_AVXVNNI_INTRINSICS
+    return true;
+#else
+    return false;
+#endif
+}
+
 #ifdef APE_USE_AVX2_INTRINSICS
 
 #define ADAPT_AVX2_SIMD_SHORT                                                                       \
@@ -32,7 +48,7 @@ bool GetAVX2Available()
     _mm256_store_si256(reinterpret_cast<__m256i *>(&pM[z + n]), avxNew);                            \
 }
 
-static void AdaptAVX2(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
+APE_TARGET_AVX2 static __forceinline void AdaptAVX2(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
 {
     // we require that pM is aligned, allowing faster loads and stores
     ASSERT((reinterpret_cast<size_t>(pM) % 32) == 0);
@@ -67,7 +83,7 @@ static void AdaptAVX2(short * pM, const short * pAdapt, int32 nDirection, int nO
     _mm256_store_si256(reinterpret_cast<__m256i *>(&pM[z + n]), avxNew);                            \
 }
 
-static void AdaptAVX2(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
+APE_TARGET_AVX2 static __forceinline void AdaptAVX2(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
 {
     // we require that pM is aligned, allowing faster loads and stores
     ASSERT((reinterpret_cast<size_t>(pM) % 32) == 0);
@@ -91,7 +107,7 @@ static void AdaptAVX2(int * pM, const int * pAdapt, int64 nDirection, int nOrder
     }
 }
 
-static int32 CalculateDotProductAVX2(const short * pA, const short * pB, int nOrder)
+APE_TARGET_AVX2 static __forceinline int32 CalculateDotProductAVX2(const short * pA, const short * pB, int nOrder)
 {
     // we require that pB is aligned, allowing faster loads
     ASSERT((reinterpret_cast<size_t>(pB) % 32) == 0);
@@ -125,7 +141,7 @@ static int32 CalculateDotProductAVX2(const short * pA, const short * pB, int nOr
     return _mm_cvtsi128_si32(sseSum);
 }
 
-static int64 CalculateDotProductAVX2(const int * pA, const int * pB, int nOrder)
+APE_TARGET_AVX2 static __forceinline int64 CalculateDotProductAVX2(const int * pA, const int * pB, int nOrder)
 {
     // we require that pB is aligned, allowing faster loads
     ASSERT((reinterpret_cast<size_t>(pB) % 32) == 0);
@@ -167,20 +183,140 @@ static int64 CalculateDotProductAVX2(const int * pA, const int * pB, int nOrder)
     return _mm_cvtsi128_si64(sseSum);
 #endif
 }
+
+/**************************************************************************************************
+Lockstep helpers (a stream per 32-bit lane, with the 16-bit values in the low half of each lane and
+the weights and deltas zero extended, so pmaddwd only multiplies the low halves)
+**************************************************************************************************/
+APE_TARGET_AVX2 static __forceinline __m256i CalculateDotProductStreamsAVX2(const __m256i * pA, const __m256i * pB, int nOrder)
+{
+    __m256i avxSum0 = _mm256_setzero_si256();
+    __m256i avxSum1 = _mm256_setzero_si256();
+    for (int z = 0; z < nOrder; z += 2)
+    {
+        avxSum0 = _mm256_add_epi32(avxSum0, _mm256_madd_epi16(pA[z + 0], pB[z + 0]));
+        avxSum1 = _mm256_add_epi32(avxSum1, _mm256_madd_epi16(pA[z + 1], pB[z + 1]));
+    }
+    return _mm256_add_epi32(avxSum0, avxSum1);
+}
+
+APE_TARGET_AVX2 static __forceinline void AdaptStreamsAVX2(__m256i * pM, const __m256i * pAdapt, const __m256i & avxDirection, int nOrder)
+{
+    // -1, 0 or 1 in each lane (the low half is what psignw looks at, and the high halves are all zero)
+    const __m256i avxDir = _mm256_sub_epi32(_mm256_cmpgt_epi32(avxDirection, _mm256_setzero_si256()), _mm256_cmpgt_epi32(_mm256_setzero_si256(), avxDirection));
+    for (int z = 0; z < nOrder; z++)
+        pM[z] = _mm256_add_epi16(pM[z], _mm256_sign_epi16(pAdapt[z], avxDir));
+}
+
+APE_TARGET_AVX2 static __forceinline void UpdateDeltaNewStreamsAVX2(__m256i * pDeltaM, const __m256i & avxValue, __m256i & avxRunningAverage)
+{
+    // the same choices as UPDATE_DELTA_NEW, made for every lane
+    const __m256i avxAbs = _mm256_abs_epi32(avxValue);
+    const __m256i avxAverage3 = _mm256_add_epi32(avxRunningAverage, _mm256_add_epi32(avxRunningAverage, avxRunningAverage));
+
+    // (average * 4) / 3 as a multiply (rounding toward zero like the division)
+    const __m256i avxAverage4 = _mm256_slli_epi32(avxRunningAverage, 2);
+    const __m256i avxMagic = _mm256_set1_epi32(0x55555556);
+    const __m256i avxEven = _mm256_srli_epi64(_mm256_mul_epi32(avxAverage4, avxMagic), 32);
+    const __m256i avxOdd = _mm256_and_si256(_mm256_mul_epi32(_mm256_srli_epi64(avxAverage4, 32), avxMagic), _mm256_set1_epi64x(static_cast<int64>(0xFFFFFFFF00000000)));
+    const __m256i avxAverage4Over3 = _mm256_sub_epi32(_mm256_or_si256(avxEven, avxOdd), _mm256_srai_epi32(avxAverage4, 31));
+
+    const __m256i avxDelta1 = _mm256_sub_epi32(_mm256_and_si256(_mm256_srai_epi32(avxValue, 25), _mm256_set1_epi32(64)), _mm256_set1_epi32(32));
+    const __m256i avxDelta2 = _mm256_sub_epi32(_mm256_and_si256(_mm256_srai_epi32(avxValue, 26), _mm256_set1_epi32(32)), _mm256_set1_epi32(16));
+    const __m256i avxDelta3 = _mm256_sub_epi32(_mm256_and_si256(_mm256_srai_epi32(avxValue, 27), _mm256_set1_epi32(16)), _mm256_set1_epi32(8));
+
+    __m256i avxDelta = _mm256_and_si256(avxDelta3, _mm256_cmpgt_epi32(avxAbs, _mm256_setzero_si256()));
+    avxDelta = _mm256_blendv_epi8(avxDelta, avxDelta2, _mm256_cmpgt_epi32(avxAbs, avxAverage4Over3));
+    avxDelta = _mm256_blendv_epi8(avxDelta, avxDelta1, _mm256_cmpgt_epi32(avxAbs, avxAverage3));
+    pDeltaM[0] = _mm256_and_si256(avxDelta, _mm256_set1_epi32(0xFFFF));
+
+    // average += (abs - average) / 16 (rounding toward zero)
+    const __m256i avxDifference = _mm256_sub_epi32(avxAbs, avxRunningAverage);
+    avxRunningAverage = _mm256_add_epi32(avxRunningAverage, _mm256_srai_epi32(_mm256_add_epi32(avxDifference, _mm256_srli_epi32(_mm256_srai_epi32(avxDifference, 31), 28)), 4));
+
+    pDeltaM[-1] = _mm256_srai_epi16(pDeltaM[-1], 1);
+    pDeltaM[-2] = _mm256_srai_epi16(pDeltaM[-2], 1);
+    pDeltaM[-8] = _mm256_srai_epi16(pDeltaM[-8], 1);
+}
+
+APE_TARGET_AVX2 static __forceinline void UpdateDeltaOldStreamsAVX2(__m256i * pDeltaM, const __m256i & avxValue)
+{
+    // the same choices as UPDATE_DELTA_OLD, made for every lane
+    const __m256i avxDelta = _mm256_sub_epi32(_mm256_and_si256(_mm256_srai_epi32(avxValue, 28), _mm256_set1_epi32(8)), _mm256_set1_epi32(4));
+    pDeltaM[0] = _mm256_and_si256(_mm256_andnot_si256(_mm256_cmpeq_epi32(avxValue, _mm256_setzero_si256()), avxDelta), _mm256_set1_epi32(0xFFFF));
+
+    pDeltaM[-4] = _mm256_srai_epi16(pDeltaM[-4], 1);
+    pDeltaM[-8] = _mm256_srai_epi16(pDeltaM[-8], 1);
+}
+
+APE_TARGET_AVX2 static __forceinline __m256i GetSaturatedShortStreamsAVX2(const __m256i & avxValue)
+{
+    return _mm256_min_epi32(_mm256_max_epi32(avxValue, _mm256_set1_epi32(-32768)), _mm256_set1_epi32(32767));
+}
+
+#ifdef APE_USE_AVXVNNI_INTRINSICS
+APE_TARGET_AVXVNNI static __forceinline int32 CalculateDotProductAVXVNNI(const short * pA, const short * pB, int nOrder)
+{
+    // we require that pB is aligned, allowing faster loads
+    ASSERT((reinterpret_cast<size_t>(pB) % 32) == 0);
+
+    // we're working 16 elements at a time
+    ASSERT((nOrder % 16) == 0);
+
+    // vpdpwssd multiplies and accumulates in one step, so use four sums to keep the chains independent
+    __m256i avxSum0 = _mm256_setzero_si256();
+    __m256i avxSum1 = _mm256_setzero_si256();
+    __m256i avxSum2 = _mm256_setzero_si256();
+    __m256i avxSum3 = _mm256_setzero_si256();
+
+    int z = 0;
+    for (; z + 64 <= nOrder; z += 64)
+    {
+        avxSum0 = _mm256_dpwssd_avx_epi32(avxSum0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&pA[z + 0])), _mm256_load_si256(reinterpret_cast<const __m256i *>(&pB[z + 0])));
+        avxSum1 = _mm256_dpwssd_avx_epi32(avxSum1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&pA[z + 16])), _mm256_load_si256(reinterpret_cast<const __m256i *>(&pB[z + 16])));
+        avxSum2 = _mm256_dpwssd_avx_epi32(avxSum2, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&pA[z + 32])), _mm256_load_si256(reinterpret_cast<const __m256i *>(&pB[z + 32])));
+        avxSum3 = _mm256_dpwssd_avx_epi32(avxSum3, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&pA[z + 48])), _mm256_load_si256(reinterpret_cast<const __m256i *>(&pB[z + 48])));
+    }
+    for (; z < nOrder; z += 16)
+        avxSum0 = _mm256_dpwssd_avx_epi32(avxSum0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&pA[z])), _mm256_load_si256(reinterpret_cast<const __m256i *>(&pB[z])));
+
+    // build output
+    const __m256i avxSum = _mm256_add_epi32(_mm256_add_epi32(avxSum0, avxSum1), _mm256_add_epi32(avxSum2, avxSum3));
+
+    const __m128i lo128 = _mm256_castsi256_si128(avxSum);
+    const __m128i hi128 = _mm256_extracti128_si256(avxSum, 0x1);
+
+    __m128i sseSum = _mm_add_epi32(lo128, hi128);
+    __m128i sseShift = _mm_srli_si128(sseSum, 0x8);
+
+    sseSum = _mm_add_epi32(sseSum, sseShift);
+    sseShift = _mm_srli_si128(sseSum, 0x4);
+    sseSum = _mm_add_epi32(sseSum, sseShift);
+
+    return _mm_cvtsi128_si32(sseSum);
+}
+
+APE_TARGET_AVXVNNI static __forceinline int64 CalculateDotProductAVXVNNI(const int * pA, const int * pB, int nOrder)
+{
+    // VNNI only has 16-bit multiplies
+    return CalculateDotProductAVX2(pA, pB, nOrder);
+}
+#endif
 #endif
 
 #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressAVX2(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressAVX2(INTTYPE nInput)
 {
 #ifdef APE_USE_AVX2_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductAVX2(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAVX2(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptAVX2(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nOutput, m_nOrder);
+    AdaptAVX2(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
 
     // update delta
     UPDATE_DELTA_NEW(nInput)
@@ -188,11 +324,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
     // convert the input to a short and store it
     m_rbInput[0] = GetSaturatedShortFromInt(nInput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
-
-    _mm256_zeroupper();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -201,14 +335,23 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
 #endif
 }
 
-template int CNNFilter<int, short>::CompressAVX2(int nInput);
-template int64 CNNFilter<int64, int>::CompressAVX2(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockAVX2(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressAVX2)
+
+#ifdef APE_USE_AVX2_INTRINSICS
+    _mm256_zeroupper();
+#endif
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockAVX2)
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressAVX2(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressAVX2(INTTYPE nInput)
 {
 #ifdef APE_USE_AVX2_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductAVX2(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAVX2(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput;
@@ -218,7 +361,7 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
         nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptAVX2(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nInput, m_nOrder);
+    AdaptAVX2(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
 
     // update delta
     if ((m_nVersion == -1) || (m_nVersion >= 3980))
@@ -229,11 +372,210 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
     // update the input buffer
     m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
+
+    return nOutput;
+#else
+    (void) nInput;
+    return 0;
+#endif
+}
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockAVX2(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressAVX2)
+
+#ifdef APE_USE_AVX2_INTRINSICS
+    _mm256_zeroupper();
+#endif
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockAVX2)
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressStreamsAVX2(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements)
+{
+#ifdef APE_USE_AVX2_INTRINSICS
+    // the filters all have the same order and shift (see CanShareStreams(...))
+    ASSERT((nStreams <= NN_FILTER_STREAMS) && (apFilters[0]->m_nOrder == ORDER));
+    const __m128i sseShift = _mm_cvtsi32_si128(apFilters[0]->m_nShift);
+    const __m256i avxRound = _mm256_set1_epi32(apFilters[0]->m_nOneShiftedByShift);
+
+    // the state and values, as rows with a lane for each stream (the input and delta histories are
+    // followed by the rows for the values being filtered)
+    __m256i aryM[ORDER];
+    __m256i aryInput[ORDER + NN_FILTER_STREAM_ROWS];
+    __m256i aryDeltaM[ORDER + NN_FILTER_STREAM_ROWS];
+    __m256i aryValues[NN_FILTER_STREAM_ROWS];
+    __m256i avxRunningAverage;
+    memset(aryM, 0, sizeof(aryM));
+    memset(aryInput, 0, sizeof(aryInput));
+    memset(aryDeltaM, 0, sizeof(aryDeltaM));
+    memset(aryValues, 0, sizeof(aryValues));
+    avxRunningAverage = _mm256_setzero_si256();
+
+    for (int nLane = 0; nLane < nStreams; nLane++)
+        apFilters[nLane]->GetStreamState(nLane, reinterpret_cast<int32 *>(aryM), reinterpret_cast<int32 *>(aryInput), reinterpret_cast<int32 *>(aryDeltaM), reinterpret_cast<int32 *>(&avxRunningAverage));
+
+    for (int nStart = 0; nStart < nElements; nStart += NN_FILTER_STREAM_ROWS)
+    {
+        const int nRows = APE_MIN(nElements - nStart, NN_FILTER_STREAM_ROWS);
+
+        int32 * pValues = reinterpret_cast<int32 *>(aryValues);
+        for (int nLane = 0; nLane < nStreams; nLane++)
+        {
+            for (int z = 0; z < nRows; z++)
+                pValues[(z * NN_FILTER_STREAMS) + nLane] = static_cast<int32>(apValues[nLane][nStart + z]);
+        }
+
+        for (int z = 0; z < nRows; z++)
+        {
+            // figure a dot product
+            const __m256i avxDotProduct = CalculateDotProductStreamsAVX2(&aryInput[z], &aryM[0], ORDER);
+
+            // calculate the output
+            const __m256i avxInput = aryValues[z];
+            const __m256i avxOutput = _mm256_sub_epi32(avxInput, _mm256_sra_epi32(_mm256_add_epi32(avxDotProduct, avxRound), sseShift));
+
+            // adapt
+            AdaptStreamsAVX2(&aryM[0], &aryDeltaM[z], avxOutput, ORDER);
+
+            // update delta
+            UpdateDeltaNewStreamsAVX2(&aryDeltaM[z + ORDER], avxInput, avxRunningAverage);
+
+            // convert the input to a short and store it
+            aryInput[z + ORDER] = GetSaturatedShortStreamsAVX2(avxInput);
+
+            aryValues[z] = avxOutput;
+        }
+
+        for (int nLane = 0; nLane < nStreams; nLane++)
+        {
+            for (int z = 0; z < nRows; z++)
+                apValues[nLane][nStart + z] = pValues[(z * NN_FILTER_STREAMS) + nLane];
+        }
+
+        // keep the history for the next rows
+        memmove(&aryInput[0], &aryInput[nRows], ORDER * sizeof(aryInput[0]));
+        memmove(&aryDeltaM[0], &aryDeltaM[nRows], ORDER * sizeof(aryDeltaM[0]));
+    }
+
+    for (int nLane = 0; nLane < nStreams; nLane++)
+        apFilters[nLane]->SetStreamState(nLane, reinterpret_cast<int32 *>(aryM), reinterpret_cast<int32 *>(aryInput), reinterpret_cast<int32 *>(aryDeltaM), reinterpret_cast<int32 *>(&avxRunningAverage));
 
     _mm256_zeroupper();
+#else
+    (void) apFilters; (void) apValues; (void) nStreams; (void) nElements;
+#endif
+}
+
+INSTANTIATE_NN_FILTER_STREAMS(CompressStreamsAVX2)
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressStreamsAVX2(CNNFilter<INTTYPE, DATATYPE> ** apFilters, INTTYPE ** apValues, int nStreams, int nElements)
+{
+#ifdef APE_USE_AVX2_INTRINSICS
+    // the filters all have the same order, shift and version, and none are in interim mode (see DecompressStreams(...))
+    ASSERT((nStreams <= NN_FILTER_STREAMS) && (apFilters[0]->m_nOrder == ORDER));
+    const __m128i sseShift = _mm_cvtsi32_si128(apFilters[0]->m_nShift);
+    const __m256i avxRound = _mm256_set1_epi32(apFilters[0]->m_nOneShiftedByShift);
+    const bool bNewDelta = (apFilters[0]->m_nVersion == -1) || (apFilters[0]->m_nVersion >= 3980);
+
+    // the state and values, as rows with a lane for each stream (the input and delta histories are
+    // followed by the rows for the values being filtered)
+    __m256i aryM[ORDER];
+    __m256i aryInput[ORDER + NN_FILTER_STREAM_ROWS];
+    __m256i aryDeltaM[ORDER + NN_FILTER_STREAM_ROWS];
+    __m256i aryValues[NN_FILTER_STREAM_ROWS];
+    __m256i avxRunningAverage;
+    memset(aryM, 0, sizeof(aryM));
+    memset(aryInput, 0, sizeof(aryInput));
+    memset(aryDeltaM, 0, sizeof(aryDeltaM));
+    memset(aryValues, 0, sizeof(aryValues));
+    avxRunningAverage = _mm256_setzero_si256();
+
+    for (int nLane = 0; nLane < nStreams; nLane++)
+        apFilters[nLane]->GetStreamState(nLane, reinterpret_cast<int32 *>(aryM), reinterpret_cast<int32 *>(aryInput), reinterpret_cast<int32 *>(aryDeltaM), reinterpret_cast<int32 *>(&avxRunningAverage));
+
+    for (int nStart = 0; nStart < nElements; nStart += NN_FILTER_STREAM_ROWS)
+    {
+        const int nRows = APE_MIN(nElements - nStart, NN_FILTER_STREAM_ROWS);
+
+        int32 * pValues = reinterpret_cast<int32 *>(aryValues);
+        for (int nLane = 0; nLane < nStreams; nLane++)
+        {
+            for (int z = 0; z < nRows; z++)
+                pValues[(z * NN_FILTER_STREAMS) + nLane] = static_cast<int32>(apValues[nLane][nStart + z]);
+        }
+
+        for (int z = 0; z < nRows; z++)
+        {
+            // figure a dot product
+            const __m256i avxDotProduct = CalculateDotProductStreamsAVX2(&aryInput[z], &aryM[0], ORDER);
+
+            // calculate the output
+            const __m256i avxInput = aryValues[z];
+            const __m256i avxOutput = _mm256_add_epi32(avxInput, _mm256_sra_epi32(_mm256_add_epi32(avxDotProduct, avxRound), sseShift));
+
+            // adapt
+            AdaptStreamsAVX2(&aryM[0], &aryDeltaM[z], avxInput, ORDER);
+
+            // update delta
+            if (bNewDelta)
+                UpdateDeltaNewStreamsAVX2(&aryDeltaM[z + ORDER], avxOutput, avxRunningAverage);
+            else
+                UpdateDeltaOldStreamsAVX2(&aryDeltaM[z + ORDER], avxOutput);
+
+            // update the input buffer
+            aryInput[z + ORDER] = GetSaturatedShortStreamsAVX2(avxOutput);
+
+            aryValues[z] = avxOutput;
+        }
+
+        for (int nLane = 0; nLane < nStreams; nLane++)
+        {
+            for (int z = 0; z < nRows; z++)
+                apValues[nLane][nStart + z] = pValues[(z * NN_FILTER_STREAMS) + nLane];
+        }
+
+        // keep the history for the next rows
+        memmove(&aryInput[0], &aryInput[nRows], ORDER * sizeof(aryInput[0]));
+        memmove(&aryDeltaM[0], &aryDeltaM[nRows], ORDER * sizeof(aryDeltaM[0]));
+    }
+
+    for (int nLane = 0; nLane < nStreams; nLane++)
+        apFilters[nLane]->SetStreamState(nLane, reinterpret_cast<int32 *>(aryM), reinterpret_cast<int32 *>(aryInput), reinterpret_cast<int32 *>(aryDeltaM), reinterpret_cast<int32 *>(&avxRunningAverage));
+
+    _mm256_zeroupper();
+#else
+    (void) apFilters; (void) apValues; (void) nStreams; (void) nElements;
+#endif
+}
+
+INSTANTIATE_NN_FILTER_STREAMS(DecompressStreamsAVX2)
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressAVXVNNI(INTTYPE nInput)
+{
+#ifdef APE_USE_AVXVNNI_INTRINSICS
+    // figure a dot product
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAVXVNNI(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
+
+    // calculate the output
+    INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
+
+    // adapt
+    AdaptAVX2(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
+
+    // update delta
+    UPDATE_DELTA_NEW(nInput)
+
+    // convert the input to a short and store it
+    m_rbInput[0] = GetSaturatedShortFromInt(nInput);
+
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -242,8 +584,64 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
 #endif
 }
 
-template int CNNFilter<int, short>::DecompressAVX2(int nInput);
-template int64 CNNFilter<int64, int>::DecompressAVX2(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockAVXVNNI(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressAVXVNNI)
+
+#ifdef APE_USE_AVXVNNI_INTRINSICS
+    _mm256_zeroupper();
+#endif
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockAVXVNNI)
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressAVXVNNI(INTTYPE nInput)
+{
+#ifdef APE_USE_AVXVNNI_INTRINSICS
+    // figure a dot product
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAVXVNNI(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
+
+    // calculate the output
+    INTTYPE nOutput;
+    if (m_bInterimMode)
+        nOutput = static_cast<INTTYPE>(nInput + ((static_cast<int64>(nDotProduct) + m_nOneShiftedByShift) >> m_nShift));
+    else
+        nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
+
+    // adapt
+    AdaptAVX2(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
+
+    // update delta
+    if ((m_nVersion == -1) || (m_nVersion >= 3980))
+        UPDATE_DELTA_NEW(nOutput)
+    else
+        UPDATE_DELTA_OLD(nOutput)
+
+    // update the input buffer
+    m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
+
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
+
+    return nOutput;
+#else
+    (void) nInput;
+    return 0;
+#endif
+}
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockAVXVNNI(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressAVXVNNI)
+
+#ifdef APE_USE_AVXVNNI_INTRINSICS
+    _mm256_zeroupper();
+#endif
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockAVXVNNI)
 #endif
 
 }
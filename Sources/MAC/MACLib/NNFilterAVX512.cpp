@@ -2,10 +2,14 @@
 #include "NNFilterCommon.h"
 #include "CPUFeatures.h"
 
-#if (defined(__AVX512DQ__) && defined(__AVX512BW__)) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC))
+#if (defined(__AVX512DQ__) && defined(__AVX512BW__)) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC)) || defined(APE_TARGET_ATTRIBUTES_X86)
     #define APE_USE_AVX512_INTRINSICS
 #endif
 
+#if (defined(__AVX512VNNI__) && defined(__AVX512DQ__) && defined(__AVX512BW__)) || (defined(_MSC_VER) && (_MSC_VER >= 1920) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC)) || defined(APE_TARGET_ATTRIBUTES_X86_VNNI)
+    #define APE_USE_AVX512VNNI_INTRINSICS
+#endif
+
 #ifdef APE_USE_AVX512_INTRINSICS
     #include <immintrin.h> // AVX-512
 #endif
@@ -22,8 +26,53 @@ bool GetAVX512Available()
 #endif
 }
 
+bool GetAVX512VNNIAvailable()
+{
+#ifdef APE_USE_AVX512VNNI_INTRINSICS
+    return true;
+#else
+    return false;
+#endif
+}
+
 #ifdef APE_USE_AVX512_INTRINSICS
 
+// GCC's AVX-512 header makes the unmasked widening, extracting, and reduction intrinsics (and even the
+// cast to 256 bits) with a self-initialized "undefined" pass-through value, which -Wmaybe-uninitialized
+// flags once they're inlined into the kernels, so these use the zero-masking forms with every lane kept
+APE_TARGET_AVX512 static __forceinline __m512i WidenAVX512(__m256i avxValue)
+{
+    return _mm512_maskz_cvtepi32_epi64(0xFF, avxValue);
+}
+
+APE_TARGET_AVX512 static __forceinline __m256i GetLowAVX512(__m512i avxValue)
+{
+    return _mm512_maskz_extracti64x4_epi64(0xF, avxValue, 0);
+}
+
+APE_TARGET_AVX512 static __forceinline __m256i GetHighAVX512(__m512i avxValue)
+{
+    return _mm512_maskz_extracti64x4_epi64(0xF, avxValue, 1);
+}
+
+APE_TARGET_AVX512 static __forceinline int32 SumAVX512(__m512i avxSum)
+{
+    const __m256i avxHalf = _mm256_add_epi32(GetLowAVX512(avxSum), GetHighAVX512(avxSum));
+    __m128i sseQuarter = _mm_add_epi32(_mm256_castsi256_si128(avxHalf), _mm256_extracti128_si256(avxHalf, 1));
+    sseQuarter = _mm_add_epi32(sseQuarter, _mm_shuffle_epi32(sseQuarter, _MM_SHUFFLE(1, 0, 3, 2)));
+    sseQuarter = _mm_add_epi32(sseQuarter, _mm_shuffle_epi32(sseQuarter, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sseQuarter);
+}
+
+APE_TARGET_AVX512 static __forceinline int64 SumAVX512Int64(__m512i avxSum)
+{
+    const __m256i avxHalf = _mm256_add_epi64(GetLowAVX512(avxSum), GetHighAVX512(avxSum));
+    const __m128i sseQuarter = _mm_add_epi64(_mm256_castsi256_si128(avxHalf), _mm256_extracti128_si256(avxHalf, 1));
+    int64 aryLanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(aryLanes), sseQuarter);
+    return aryLanes[0] + aryLanes[1];
+}
+
 #define ADAPT_AVX512_SIMD_SHORT                                                                                    \
 {                                                                                                                  \
     const __m512i avxM = _mm512_load_si512(&pM[z + n]);                                                            \
@@ -32,7 +81,7 @@ bool GetAVX512Available()
     _mm512_mask_store_epi32(&pM[z + n], avxZeroMask, avxNew);                                                      \
 }
 
-static void AdaptAVX512(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
+APE_TARGET_AVX512 static __forceinline void AdaptAVX512(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
 {
     // we require that pM is aligned, allowing faster loads and stores
     ASSERT((reinterpret_cast<size_t>(pM) % 64) == 0);
@@ -66,7 +115,7 @@ static void AdaptAVX512(short * pM, const short * pAdapt, int32 nDirection, int
     _mm512_mask_store_epi32(&pM[z + n], avxZeroMask, avxNew);                                                      \
 }
 
-static void AdaptAVX512(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
+APE_TARGET_AVX512 static __forceinline void AdaptAVX512(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
 {
     // we require that pM is aligned, allowing faster loads and stores
     ASSERT((reinterpret_cast<size_t>(pM) % 64) == 0);
@@ -92,7 +141,7 @@ static void AdaptAVX512(int * pM, const int * pAdapt, int64 nDirection, int nOrd
     }
 }
 
-static int32 CalculateDotProductAVX512(const short * pA, const short * pB, int nOrder)
+APE_TARGET_AVX512 static __forceinline int32 CalculateDotProductAVX512(const short * pA, const short * pB, int nOrder)
 {
     // we require that pB is aligned, allowing faster loads
     ASSERT((reinterpret_cast<size_t>(pB) % 64) == 0);
@@ -113,10 +162,10 @@ static int32 CalculateDotProductAVX512(const short * pA, const short * pB, int n
     }
 
     // build output
-    return _mm512_reduce_add_epi32(avxSum);
+    return SumAVX512(avxSum);
 }
 
-static int64 CalculateDotProductAVX512(const int * pA, const int * pB, int nOrder)
+APE_TARGET_AVX512 static __forceinline int64 CalculateDotProductAVX512(const int * pA, const int * pB, int nOrder)
 {
     // we require that pB is aligned, allowing faster loads
     ASSERT((reinterpret_cast<size_t>(pB) % 64) == 0);
@@ -134,8 +183,8 @@ static int64 CalculateDotProductAVX512(const int * pA, const int * pB, int nOrde
 
         const __m512i avxProduct = _mm512_mullo_epi32(avxA, avxB);
 
-        const __m512i avxProductLo = _mm512_cvtepi32_epi64(_mm512_castsi512_si256(avxProduct));
-        const __m512i avxProductHi = _mm512_cvtepi32_epi64(_mm512_extracti32x8_epi32(avxProduct, 0x1));
+        const __m512i avxProductLo = WidenAVX512(GetLowAVX512(avxProduct));
+        const __m512i avxProductHi = WidenAVX512(GetHighAVX512(avxProduct));
 
         avxSumLo = _mm512_add_epi64(avxSumLo, avxProductLo);
         avxSumHi = _mm512_add_epi64(avxSumHi, avxProductHi);
@@ -144,22 +193,60 @@ static int64 CalculateDotProductAVX512(const int * pA, const int * pB, int nOrde
     // build output
     const __m512i avxSum = _mm512_add_epi64(avxSumLo, avxSumHi);
 
-    return _mm512_reduce_add_epi64(avxSum);
+    return SumAVX512Int64(avxSum);
+}
+
+#ifdef APE_USE_AVX512VNNI_INTRINSICS
+APE_TARGET_AVX512VNNI static __forceinline int32 CalculateDotProductAVX512VNNI(const short * pA, const short * pB, int nOrder)
+{
+    // we require that pB is aligned, allowing faster loads
+    ASSERT((reinterpret_cast<size_t>(pB) % 64) == 0);
+
+    // we're working 32 elements at a time
+    ASSERT((nOrder % 32) == 0);
+
+    // vpdpwssd multiplies and accumulates in one step, so use four sums to keep the chains independent
+    __m512i avxSum0 = _mm512_setzero_si512();
+    __m512i avxSum1 = _mm512_setzero_si512();
+    __m512i avxSum2 = _mm512_setzero_si512();
+    __m512i avxSum3 = _mm512_setzero_si512();
+
+    int z = 0;
+    for (; z + 128 <= nOrder; z += 128)
+    {
+        avxSum0 = _mm512_dpwssd_epi32(avxSum0, _mm512_loadu_si512(&pA[z + 0]), _mm512_load_si512(&pB[z + 0]));
+        avxSum1 = _mm512_dpwssd_epi32(avxSum1, _mm512_loadu_si512(&pA[z + 32]), _mm512_load_si512(&pB[z + 32]));
+        avxSum2 = _mm512_dpwssd_epi32(avxSum2, _mm512_loadu_si512(&pA[z + 64]), _mm512_load_si512(&pB[z + 64]));
+        avxSum3 = _mm512_dpwssd_epi32(avxSum3, _mm512_loadu_si512(&pA[z + 96]), _mm512_load_si512(&pB[z + 96]));
+    }
+    for (; z < nOrder; z += 32)
+        avxSum0 = _mm512_dpwssd_epi32(avxSum0, _mm512_loadu_si512(&pA[z]), _mm512_load_si512(&pB[z]));
+
+    // build output
+    return SumAVX512(_mm512_add_epi32(_mm512_add_epi32(avxSum0, avxSum1), _mm512_add_epi32(avxSum2, avxSum3)));
+}
+
+APE_TARGET_AVX512VNNI static __forceinline int64 CalculateDotProductAVX512VNNI(const int * pA, const int * pB, int nOrder)
+{
+    // VNNI only has 16-bit multiplies
+    return CalculateDotProductAVX512(pA, pB, nOrder);
 }
 #endif
+#endif
 
 #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressAVX512(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressAVX512(INTTYPE nInput)
 {
 #ifdef APE_USE_AVX512_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductAVX512(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAVX512(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptAVX512(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nOutput, m_nOrder);
+    AdaptAVX512(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
 
     // update delta
     UPDATE_DELTA_NEW(nInput)
@@ -167,11 +254,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
     // convert the input to a short and store it
     m_rbInput[0] = GetSaturatedShortFromInt(nInput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
-
-    _mm256_zeroupper();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -180,14 +265,23 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
 #endif
 }
 
-template int CNNFilter<int, short>::CompressAVX512(int nInput);
-template int64 CNNFilter<int64, int>::CompressAVX512(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockAVX512(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressAVX512)
+
+#ifdef APE_USE_AVX512_INTRINSICS
+    _mm256_zeroupper();
+#endif
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockAVX512)
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressAVX512(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressAVX512(INTTYPE nInput)
 {
 #ifdef APE_USE_AVX512_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductAVX512(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAVX512(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput;
@@ -197,7 +291,7 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
         nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptAVX512(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nInput, m_nOrder);
+    AdaptAVX512(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
 
     // update delta
     if ((m_nVersion == -1) || (m_nVersion >= 3980))
@@ -208,11 +302,98 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
     // update the input buffer
     m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
+    return nOutput;
+#else
+    (void) nInput;
+    return 0;
+#endif
+}
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockAVX512(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressAVX512)
+
+#ifdef APE_USE_AVX512_INTRINSICS
     _mm256_zeroupper();
+#endif
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockAVX512)
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressAVX512VNNI(INTTYPE nInput)
+{
+#ifdef APE_USE_AVX512VNNI_INTRINSICS
+    // figure a dot product
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAVX512VNNI(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
+
+    // calculate the output
+    INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
+
+    // adapt
+    AdaptAVX512(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
+
+    // update delta
+    UPDATE_DELTA_NEW(nInput)
+
+    // convert the input to a short and store it
+    m_rbInput[0] = GetSaturatedShortFromInt(nInput);
+
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
+
+    return nOutput;
+#else
+    (void) nInput;
+    return 0;
+#endif
+}
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockAVX512VNNI(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressAVX512VNNI)
+
+#ifdef APE_USE_AVX512VNNI_INTRINSICS
+    _mm256_zeroupper();
+#endif
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockAVX512VNNI)
+
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressAVX512VNNI(INTTYPE nInput)
+{
+#ifdef APE_USE_AVX512VNNI_INTRINSICS
+    // figure a dot product
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAVX512VNNI(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
+
+    // calculate the output
+    INTTYPE nOutput;
+    if (m_bInterimMode)
+        nOutput = static_cast<INTTYPE>(nInput + ((static_cast<int64>(nDotProduct) + m_nOneShiftedByShift) >> m_nShift));
+    else
+        nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
+
+    // adapt
+    AdaptAVX512(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
+
+    // update delta
+    if ((m_nVersion == -1) || (m_nVersion >= 3980))
+        UPDATE_DELTA_NEW(nOutput)
+    else
+        UPDATE_DELTA_OLD(nOutput)
+
+    // update the input buffer
+    m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
+
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -221,8 +402,16 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
 #endif
 }
 
-template int CNNFilter<int, short>::DecompressAVX512(int nInput);
-template int64 CNNFilter<int64, int>::DecompressAVX512(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockAVX512VNNI(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressAVX512VNNI)
+
+#ifdef APE_USE_AVX512VNNI_INTRINSICS
+    _mm256_zeroupper();
+#endif
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockAVX512VNNI)
 #endif
 
 }
@@ -55,7 +55,7 @@ bool GetAltiVecAvailable()
     vec_st(avNew, 0, &pM[z + n]);                            \
 }
 
-static void AdaptAltiVec(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
+static __forceinline void AdaptAltiVec(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
 {
     // we require that pM is aligned, allowing faster loads and stores
     ASSERT((reinterpret_cast<size_t>(pM) % 16) == 0);
@@ -92,7 +92,7 @@ static void AdaptAltiVec(short * pM, const short * pAdapt, int32 nDirection, int
     vec_st(avNew, 0, &pM[z + n]);                        \
 }
 
-static void AdaptAltiVec(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
+static __forceinline void AdaptAltiVec(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
 {
 #if defined(_ARCH_PWR7)
     // we require that pM is aligned, allowing faster loads and stores
@@ -117,7 +117,7 @@ static void AdaptAltiVec(int * pM, const int * pAdapt, int64 nDirection, int nOr
 #endif
 }
 
-static int32 CalculateDotProductAltiVec(const short * pA, const short * pB, int nOrder)
+static __forceinline int32 CalculateDotProductAltiVec(const short * pA, const short * pB, int nOrder)
 {
     // we require that pB is aligned, allowing faster loads
     ASSERT((reinterpret_cast<size_t>(pB) % 16) == 0);
@@ -156,7 +156,7 @@ static int32 CalculateDotProductAltiVec(const short * pA, const short * pB, int
 #endif
 }
 
-static int64 CalculateDotProductAltiVec(const int * pA, const int * pB, int nOrder)
+static __forceinline int64 CalculateDotProductAltiVec(const int * pA, const int * pB, int nOrder)
 {
 #if defined(_ARCH_PWR8)
     // we require that pB is aligned, allowing faster loads
@@ -199,17 +199,18 @@ static int64 CalculateDotProductAltiVec(const int * pA, const int * pB, int nOrd
 #endif
 
 #if defined(__ppc__) || defined(__powerpc__)
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressAltiVec(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressAltiVec(INTTYPE nInput)
 {
 #ifdef APE_USE_ALTIVEC_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductAltiVec(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAltiVec(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptAltiVec(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nOutput, m_nOrder);
+    AdaptAltiVec(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
 
     // update delta
     UPDATE_DELTA_NEW(nInput)
@@ -217,9 +218,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
     // convert the input to a short and store it
     m_rbInput[0] = GetSaturatedShortFromInt(nInput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -228,14 +229,19 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
 #endif
 }
 
-template int CNNFilter<int, short>::CompressAltiVec(int nInput);
-template int64 CNNFilter<int64, int>::CompressAltiVec(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockAltiVec(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressAltiVec)
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockAltiVec)
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressAltiVec(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressAltiVec(INTTYPE nInput)
 {
 #ifdef APE_USE_ALTIVEC_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductAltiVec(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductAltiVec(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput;
@@ -245,7 +251,7 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
         nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptAltiVec(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nInput, m_nOrder);
+    AdaptAltiVec(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
 
     // update delta
     if ((m_nVersion == -1) || (m_nVersion >= 3980))
@@ -256,9 +262,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
     // update the input buffer
     m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -267,8 +273,12 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
 #endif
 }
 
-template int CNNFilter<int, short>::DecompressAltiVec(int nInput);
-template int64 CNNFilter<int64, int>::DecompressAltiVec(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockAltiVec(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressAltiVec)
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockAltiVec)
 #endif
 
 }
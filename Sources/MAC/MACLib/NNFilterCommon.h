@@ -40,6 +40,67 @@ Macros to avoid code duplication
     m_rbDeltaM[-8] >>= 1;                                       \
 }
 
+/**************************************************************************************************
+The per-value filter functions are only called from the block functions, and they have to be inlined
+there (__forceinline is just a hint on some compilers)
+**************************************************************************************************/
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define NN_FILTER_INLINE inline __attribute__((always_inline))
+#else
+    #define NN_FILTER_INLINE __forceinline
+#endif
+
+/**************************************************************************************************
+Macro for the block functions (runs the values through the filter a run at a time, rolling the input
+and delta buffers between runs instead of checking on every value; they always roll together)
+**************************************************************************************************/
+
+#define NN_FILTER_BLOCK(FUNCTION)                                               \
+{                                                                               \
+    while (nElements > 0)                                                       \
+    {                                                                           \
+        const int nRun = APE_MIN(nElements, m_rbInput.GetRollElements());       \
+        for (int z = 0; z < nRun; z++)                                          \
+            pOutput[z] = FUNCTION<ORDER>(pInput[z]);                            \
+                                                                                \
+        if (m_rbInput.GetRollElements() == 0)                                   \
+        {                                                                       \
+            m_rbInput.Roll();                                                   \
+            m_rbDeltaM.Roll();                                                  \
+        }                                                                       \
+                                                                                \
+        pInput += nRun;                                                         \
+        pOutput += nRun;                                                        \
+        nElements -= nRun;                                                      \
+    }                                                                           \
+}
+
+/**************************************************************************************************
+Macros to build a filter function for every order the predictors use (see CNNFilter::GetOrder()), and
+the lockstep functions for the short orders
+**************************************************************************************************/
+
+#define INSTANTIATE_NN_FILTER_ORDER(FUNCTION, ORDER)                                                    \
+    template void CNNFilter<int, short>::FUNCTION<ORDER>(const int * pInput, int * pOutput, int nElements);     \
+    template void CNNFilter<int64, int>::FUNCTION<ORDER>(const int64 * pInput, int64 * pOutput, int nElements);
+
+#define INSTANTIATE_NN_FILTER(FUNCTION)                                         \
+    INSTANTIATE_NN_FILTER_ORDER(FUNCTION, 0)                                    \
+    INSTANTIATE_NN_FILTER_ORDER(FUNCTION, 16)                                   \
+    INSTANTIATE_NN_FILTER_ORDER(FUNCTION, 32)                                   \
+    INSTANTIATE_NN_FILTER_ORDER(FUNCTION, 64)                                   \
+    INSTANTIATE_NN_FILTER_ORDER(FUNCTION, 256)                                  \
+    INSTANTIATE_NN_FILTER_ORDER(FUNCTION, 1280)
+
+#define INSTANTIATE_NN_FILTER_STREAMS_ORDER(FUNCTION, ORDER)                                                                    \
+    template void CNNFilter<int, short>::FUNCTION<ORDER>(CNNFilter<int, short> ** apFilters, int ** apValues, int nStreams, int nElements);       \
+    template void CNNFilter<int64, int>::FUNCTION<ORDER>(CNNFilter<int64, int> ** apFilters, int64 ** apValues, int nStreams, int nElements);
+
+#define INSTANTIATE_NN_FILTER_STREAMS(FUNCTION)                                 \
+    INSTANTIATE_NN_FILTER_STREAMS_ORDER(FUNCTION, 16)                           \
+    INSTANTIATE_NN_FILTER_STREAMS_ORDER(FUNCTION, 32)
+
 namespace APE
 {
 
@@ -4,36 +4,37 @@
 namespace APE
 {
 
-static void AdaptGeneric(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
+static __forceinline void AdaptGeneric(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
 {
     return Adapt(pM, pAdapt, nDirection, nOrder);
 }
 
-static void AdaptGeneric(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
+static __forceinline void AdaptGeneric(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
 {
     return Adapt(pM, pAdapt, nDirection, nOrder);
 }
 
-static int32 CalculateDotProductGeneric(const short * pA, const short * pB, int nOrder)
+static __forceinline int32 CalculateDotProductGeneric(const short * pA, const short * pB, int nOrder)
 {
     return CalculateDotProduct(pA, pB, nOrder);
 }
 
-static int64 CalculateDotProductGeneric(const int * pA, const int * pB, int nOrder)
+static __forceinline int64 CalculateDotProductGeneric(const int * pA, const int * pB, int nOrder)
 {
     return CalculateDotProduct(pA, pB, nOrder);
 }
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressGeneric(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressGeneric(INTTYPE nInput)
 {
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductGeneric(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductGeneric(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptGeneric(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nOutput, m_nOrder);
+    AdaptGeneric(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
 
     // update delta
     UPDATE_DELTA_NEW(nInput)
@@ -41,20 +42,25 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
     // convert the input to a short and store it
     m_rbInput[0] = GetSaturatedShortFromInt(nInput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 }
 
-template int CNNFilter<int, short>::CompressGeneric(int nInput);
-template int64 CNNFilter<int64, int>::CompressGeneric(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockGeneric(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressGeneric)
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockGeneric)
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressGeneric(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressGeneric(INTTYPE nInput)
 {
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductGeneric(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductGeneric(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput;
@@ -64,7 +70,7 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
         nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptGeneric(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nInput, m_nOrder);
+    AdaptGeneric(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
 
     // update delta
     if ((m_nVersion == -1) || (m_nVersion >= 3980))
@@ -75,14 +81,18 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
     // update the input buffer
     m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 }
 
-template int CNNFilter<int, short>::DecompressGeneric(int nInput);
-template int64 CNNFilter<int64, int>::DecompressGeneric(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockGeneric(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressGeneric)
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockGeneric)
 
 }
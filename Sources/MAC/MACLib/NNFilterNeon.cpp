@@ -89,7 +89,7 @@ void AdaptNeon(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
         EXPAND_SIMD_4(n, 4, ADAPT_NEON_SIMD_INT)
 }
 
-static int32 CalculateDotProductNeon(const short * pA, const short * pB, int nOrder)
+static __forceinline int32 CalculateDotProductNeon(const short * pA, const short * pB, int nOrder)
 {
     // we're working 16 elements at a time
     ASSERT((nOrder % 16) == 0);
@@ -127,7 +127,7 @@ static int32 CalculateDotProductNeon(const short * pA, const short * pB, int nOr
     #endif
 }
 
-static int64 CalculateDotProductNeon(const int * pA, const int * pB, int nOrder)
+static __forceinline int64 CalculateDotProductNeon(const int * pA, const int * pB, int nOrder)
 {
     // we're working 8 elements at a time
     ASSERT((nOrder % 8) == 0);
@@ -169,17 +169,18 @@ static int64 CalculateDotProductNeon(const int * pA, const int * pB, int nOrder)
 #endif
 
 #if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressNeon(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressNeon(INTTYPE nInput)
 {
 #ifdef APE_USE_NEON_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductNeon(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductNeon(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptNeon(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nOutput, m_nOrder);
+    AdaptNeon(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
 
     // update delta
     UPDATE_DELTA_NEW(nInput)
@@ -187,9 +188,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
     // convert the input to a short and store it
     m_rbInput[0] = GetSaturatedShortFromInt(nInput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -198,14 +199,19 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
 #endif
 }
 
-template int CNNFilter<int, short>::CompressNeon(int nInput);
-template int64 CNNFilter<int64, int>::CompressNeon(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockNeon(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressNeon)
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockNeon)
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressNeon(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressNeon(INTTYPE nInput)
 {
 #ifdef APE_USE_NEON_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductNeon(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductNeon(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput;
@@ -215,7 +221,7 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
         nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptNeon(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nInput, m_nOrder);
+    AdaptNeon(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
 
     // update delta
     if ((m_nVersion == -1) || (m_nVersion >= 3980))
@@ -226,9 +232,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
     // update the input buffer
     m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -237,8 +243,12 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
 #endif
 }
 
-template int CNNFilter<int, short>::DecompressNeon(int nInput);
-template int64 CNNFilter<int64, int>::DecompressNeon(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockNeon(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressNeon)
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockNeon)
 #endif
 
 }
@@ -62,7 +62,7 @@ void AdaptRVV(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
     }
 }
 
-static int32 CalculateDotProductRVV(const short * pA, const short * pB, int nOrder)
+static __forceinline int32 CalculateDotProductRVV(const short * pA, const short * pB, int nOrder)
 {
     size_t vlmax = __riscv_vsetvlmax_e32m2();
 
@@ -82,7 +82,7 @@ static int32 CalculateDotProductRVV(const short * pA, const short * pB, int nOrd
     return __riscv_vmv_x(__riscv_vredsum(rvvSum, __riscv_vmv_v_x_i32m1(0, 1), vlmax));
 }
 
-static int64 CalculateDotProductRVV(const int * pA, const int * pB, int nOrder)
+static __forceinline int64 CalculateDotProductRVV(const int * pA, const int * pB, int nOrder)
 {
     size_t vlmax = __riscv_vsetvlmax_e64m2();
 
@@ -106,17 +106,18 @@ static int64 CalculateDotProductRVV(const int * pA, const int * pB, int nOrder)
 #endif
 
 #if defined(__riscv)
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressRVV(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressRVV(INTTYPE nInput)
 {
 #ifdef APE_USE_RVV_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductRVV(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductRVV(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptRVV(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nOutput, m_nOrder);
+    AdaptRVV(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
 
     // update delta
     UPDATE_DELTA_NEW(nInput)
@@ -124,9 +125,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
     // convert the input to a short and store it
     m_rbInput[0] = GetSaturatedShortFromInt(nInput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -135,14 +136,19 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
 #endif
 }
 
-template int CNNFilter<int, short>::CompressRVV(int nInput);
-template int64 CNNFilter<int64, int>::CompressRVV(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockRVV(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressRVV)
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockRVV)
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressRVV(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressRVV(INTTYPE nInput)
 {
 #ifdef APE_USE_RVV_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductRVV(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductRVV(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput;
@@ -152,7 +158,7 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
         nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptRVV(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nInput, m_nOrder);
+    AdaptRVV(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
 
     // update delta
     if ((m_nVersion == -1) || (m_nVersion >= 3980))
@@ -163,9 +169,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
     // update the input buffer
     m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -174,8 +180,12 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
 #endif
 }
 
-template int CNNFilter<int, short>::DecompressRVV(int nInput);
-template int64 CNNFilter<int64, int>::DecompressRVV(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockRVV(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressRVV)
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockRVV)
 #endif
 
 }
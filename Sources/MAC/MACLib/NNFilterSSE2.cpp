@@ -2,7 +2,7 @@
 #include "NNFilterCommon.h"
 #include "CPUFeatures.h"
 
-#if defined(__SSE2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)))
+#if defined(__SSE2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) || defined(APE_TARGET_ATTRIBUTES_X86)
     #define APE_USE_SSE2_INTRINSICS
 #endif
 
@@ -24,9 +24,9 @@ bool GetSSE2Available()
 
 #ifdef APE_USE_SSE2_INTRINSICS
 
-void AdaptSSE2(short * pM, const short * pAdapt, int32 nDirection, int nOrder);
+APE_TARGET_SSE2 void AdaptSSE2(short * pM, const short * pAdapt, int32 nDirection, int nOrder);
 
-int32 CalculateDotProductSSE2(const short * pA, const short * pB, int nOrder);
+APE_TARGET_SSE2 int32 CalculateDotProductSSE2(const short * pA, const short * pB, int nOrder);
 
 #define ADAPT_SSE2_SIMD_SHORT                                                                    \
 {                                                                                                \
@@ -36,7 +36,7 @@ int32 CalculateDotProductSSE2(const short * pA, const short * pB, int nOrder);
     _mm_store_si128(reinterpret_cast<__m128i *>(&pM[z + n]), sseNew);                            \
 }
 
-void AdaptSSE2(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
+APE_TARGET_SSE2 void AdaptSSE2(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
 {
     // we require that pM is aligned, allowing faster loads and stores
     ASSERT((reinterpret_cast<size_t>(pM) % 16) == 0);
@@ -76,7 +76,7 @@ void AdaptSSE2(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
     _mm_store_si128(reinterpret_cast<__m128i *>(&pM[z + n]), sseNew);                            \
 }
 
-static void AdaptSSE2(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
+APE_TARGET_SSE2 static __forceinline void AdaptSSE2(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
 {
     // we require that pM is aligned, allowing faster loads and stores
     ASSERT((reinterpret_cast<size_t>(pM) % 16) == 0);
@@ -97,7 +97,7 @@ static void AdaptSSE2(int * pM, const int * pAdapt, int64 nDirection, int nOrder
     }
 }
 
-int32 CalculateDotProductSSE2(const short * pA, const short * pB, int nOrder)
+APE_TARGET_SSE2 int32 CalculateDotProductSSE2(const short * pA, const short * pB, int nOrder)
 {
     // we require that pB is aligned, allowing faster loads
     ASSERT((reinterpret_cast<size_t>(pB) % 16) == 0);
@@ -133,24 +133,25 @@ int32 CalculateDotProductSSE2(const short * pA, const short * pB, int nOrder)
     return _mm_cvtsi128_si32(sseSum);
 }
 
-static int64 CalculateDotProductSSE2(const int * pA, const int * pB, int nOrder)
+APE_TARGET_SSE2 static __forceinline int64 CalculateDotProductSSE2(const int * pA, const int * pB, int nOrder)
 {
     return CalculateDotProduct(pA, pB, nOrder);
 }
 #endif
 
 #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressSSE2(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressSSE2(INTTYPE nInput)
 {
 #ifdef APE_USE_SSE2_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductSSE2(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductSSE2(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptSSE2(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nOutput, m_nOrder);
+    AdaptSSE2(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
 
     // update delta
     UPDATE_DELTA_NEW(nInput)
@@ -158,9 +159,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
     // convert the input to a short and store it
     m_rbInput[0] = GetSaturatedShortFromInt(nInput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -169,14 +170,19 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
 #endif
 }
 
-template int CNNFilter<int, short>::CompressSSE2(int nInput);
-template int64 CNNFilter<int64, int>::CompressSSE2(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockSSE2(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressSSE2)
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockSSE2)
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressSSE2(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressSSE2(INTTYPE nInput)
 {
 #ifdef APE_USE_SSE2_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductSSE2(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductSSE2(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput;
@@ -186,7 +192,7 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
         nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptSSE2(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nInput, m_nOrder);
+    AdaptSSE2(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
 
     // update delta
     if ((m_nVersion == -1) || (m_nVersion >= 3980))
@@ -197,9 +203,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
     // update the input buffer
     m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -208,8 +214,12 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
 #endif
 }
 
-template int CNNFilter<int, short>::DecompressSSE2(int nInput);
-template int64 CNNFilter<int64, int>::DecompressSSE2(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockSSE2(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressSSE2)
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockSSE2)
 #endif
 
 }
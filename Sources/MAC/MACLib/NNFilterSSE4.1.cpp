@@ -2,7 +2,7 @@
 #include "NNFilterCommon.h"
 #include "CPUFeatures.h"
 
-#if defined(__SSE4_1__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)))
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) || defined(APE_TARGET_ATTRIBUTES_X86)
     #define APE_USE_SSE41_INTRINSICS
 #endif
 
@@ -13,9 +13,9 @@
 namespace APE
 {
 
-void AdaptSSE2(short * pM, const short * pAdapt, int32 nDirection, int nOrder);
+APE_TARGET_SSE2 void AdaptSSE2(short * pM, const short * pAdapt, int32 nDirection, int nOrder);
 
-int32 CalculateDotProductSSE2(const short * pA, const short * pB, int nOrder);
+APE_TARGET_SSE2 int32 CalculateDotProductSSE2(const short * pA, const short * pB, int nOrder);
 
 bool GetSSE41Available()
 {
@@ -28,7 +28,7 @@ bool GetSSE41Available()
 
 #ifdef APE_USE_SSE41_INTRINSICS
 
-static void AdaptSSE41(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
+APE_TARGET_SSE41 static __forceinline void AdaptSSE41(short * pM, const short * pAdapt, int32 nDirection, int nOrder)
 {
     return AdaptSSE2(pM, pAdapt, nDirection, nOrder);
 }
@@ -41,7 +41,7 @@ static void AdaptSSE41(short * pM, const short * pAdapt, int32 nDirection, int n
     _mm_store_si128(reinterpret_cast<__m128i *>(&pM[z + n]), sseNew);                            \
 }
 
-static void AdaptSSE41(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
+APE_TARGET_SSE41 static __forceinline void AdaptSSE41(int * pM, const int * pAdapt, int64 nDirection, int nOrder)
 {
     // we require that pM is aligned, allowing faster loads and stores
     ASSERT((reinterpret_cast<size_t>(pM) % 16) == 0);
@@ -57,12 +57,12 @@ static void AdaptSSE41(int * pM, const int * pAdapt, int64 nDirection, int nOrde
         EXPAND_SIMD_4(n, 4, ADAPT_SSE41_SIMD_INT)
 }
 
-static int32 CalculateDotProductSSE41(const short * pA, const short * pB, int nOrder)
+APE_TARGET_SSE41 static __forceinline int32 CalculateDotProductSSE41(const short * pA, const short * pB, int nOrder)
 {
     return CalculateDotProductSSE2(pA, pB, nOrder);
 }
 
-static int64 CalculateDotProductSSE41(const int * pA, const int * pB, int nOrder)
+APE_TARGET_SSE41 static __forceinline int64 CalculateDotProductSSE41(const int * pA, const int * pB, int nOrder)
 {
     // we require that pB is aligned, allowing faster loads
     ASSERT((reinterpret_cast<size_t>(pB) % 16) == 0);
@@ -111,17 +111,18 @@ static int64 CalculateDotProductSSE41(const int * pA, const int * pB, int nOrder
 #endif
 
 #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressSSE41(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::CompressSSE41(INTTYPE nInput)
 {
 #ifdef APE_USE_SSE41_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductSSE41(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductSSE41(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput = static_cast<INTTYPE>(nInput - ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptSSE41(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nOutput, m_nOrder);
+    AdaptSSE41(&m_paryM[0], &m_rbDeltaM[-nOrder], nOutput, nOrder);
 
     // update delta
     UPDATE_DELTA_NEW(nInput)
@@ -129,9 +130,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
     // convert the input to a short and store it
     m_rbInput[0] = GetSaturatedShortFromInt(nInput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -140,14 +141,19 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::C
 #endif
 }
 
-template int CNNFilter<int, short>::CompressSSE41(int nInput);
-template int64 CNNFilter<int64, int>::CompressSSE41(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::CompressBlockSSE41(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(CompressSSE41)
+}
+
+INSTANTIATE_NN_FILTER(CompressBlockSSE41)
 
-template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressSSE41(INTTYPE nInput)
+template <class INTTYPE, class DATATYPE> template <int ORDER> NN_FILTER_INLINE INTTYPE CNNFilter<INTTYPE, DATATYPE>::DecompressSSE41(INTTYPE nInput)
 {
 #ifdef APE_USE_SSE41_INTRINSICS
     // figure a dot product
-    INTTYPE nDotProduct = CalculateDotProductSSE41(&m_rbInput[-m_nOrder], &m_paryM[0], m_nOrder);
+    const int nOrder = GetOrder<ORDER>();
+    INTTYPE nDotProduct = CalculateDotProductSSE41(&m_rbInput[-nOrder], &m_paryM[0], nOrder);
 
     // calculate the output
     INTTYPE nOutput;
@@ -157,7 +163,7 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
         nOutput = static_cast<INTTYPE>(nInput + ((nDotProduct + m_nOneShiftedByShift) >> m_nShift));
 
     // adapt
-    AdaptSSE41(&m_paryM[0], &m_rbDeltaM[-m_nOrder], nInput, m_nOrder);
+    AdaptSSE41(&m_paryM[0], &m_rbDeltaM[-nOrder], nInput, nOrder);
 
     // update delta
     if ((m_nVersion == -1) || (m_nVersion >= 3980))
@@ -168,9 +174,9 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
     // update the input buffer
     m_rbInput[0] = GetSaturatedShortFromInt(nOutput);
 
-    // increment and roll if necessary
-    m_rbInput.IncrementSafe();
-    m_rbDeltaM.IncrementSafe();
+    // increment (the block rolls the buffers)
+    m_rbInput.IncrementFast();
+    m_rbDeltaM.IncrementFast();
 
     return nOutput;
 #else
@@ -179,8 +185,12 @@ template <class INTTYPE, class DATATYPE> INTTYPE CNNFilter<INTTYPE, DATATYPE>::D
 #endif
 }
 
-template int CNNFilter<int, short>::DecompressSSE41(int nInput);
-template int64 CNNFilter<int64, int>::DecompressSSE41(int64 nInput);
+template <class INTTYPE, class DATATYPE> template <int ORDER> void CNNFilter<INTTYPE, DATATYPE>::DecompressBlockSSE41(const INTTYPE * pInput, INTTYPE * pOutput, int nElements)
+{
+    NN_FILTER_BLOCK(DecompressSSE41)
+}
+
+INSTANTIATE_NN_FILTER(DecompressBlockSSE41)
 #endif
 
 }
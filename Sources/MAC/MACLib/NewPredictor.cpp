@@ -78,6 +78,27 @@ template <class INTTYPE, class DATATYPE> int CPredictorCompressNormal<INTTYPE, D
 }
 
 template <class INTTYPE, class DATATYPE> int64 CPredictorCompressNormal<INTTYPE, DATATYPE>::CompressValue(int _nA, int _nB)
+{
+    INTTYPE nOutput = static_cast<INTTYPE>(CPredictorCompressNormal<INTTYPE, DATATYPE>::CompressPrediction(_nA, _nB));
+
+    // stage 3: NNFilters
+    if (m_spNNFilter)
+    {
+        nOutput = m_spNNFilter->Compress(nOutput);
+
+        if (m_spNNFilter1)
+        {
+            nOutput = m_spNNFilter1->Compress(nOutput);
+
+            if (m_spNNFilter2)
+                nOutput = m_spNNFilter2->Compress(nOutput);
+        }
+    }
+
+    return nOutput;
+}
+
+template <class INTTYPE, class DATATYPE> int64 CPredictorCompressNormal<INTTYPE, DATATYPE>::CompressPrediction(int _nA, int _nB)
 {
     // roll the buffers if necessary
     if (m_nCurrentIndex == WINDOW_BLOCKS)
@@ -123,26 +144,68 @@ template <class INTTYPE, class DATATYPE> int64 CPredictorCompressNormal<INTTYPE,
     INTTYPE * pM = &paryM[-8]; INTTYPE * pAdapt = &m_rbAdapt[-8];
     EXPAND_9_TIMES(*pM++ += *pAdapt++ * ((nOutput < 0) - (nOutput > 0));)
 
-    // stage 3: NNFilters
-    if (m_spNNFilter)
-    {
-        nOutput = m_spNNFilter->Compress(nOutput);
-
-        if (m_spNNFilter1)
-        {
-            nOutput = m_spNNFilter1->Compress(nOutput);
-
-            if (m_spNNFilter2)
-                nOutput = m_spNNFilter2->Compress(nOutput);
-        }
-    }
-
     m_rbPrediction.IncrementFast(); m_rbAdapt.IncrementFast();
     m_nCurrentIndex++;
 
     return nOutput;
 }
 
+template <class INTTYPE, class DATATYPE> void CPredictorCompressNormal<INTTYPE, DATATYPE>::CompressFilters(IPredictorCompress ** apPredictors, int64 ** apValues, int nPredictors, int nValues)
+{
+    // stage 3: NNFilters (each filter only sees the output of the one before it, so a chunk of values can
+    // go through them one after another, and the same filter of every predictor runs at once)
+    for (int nFirst = 0; nFirst < nPredictors; nFirst += NN_FILTER_STREAMS)
+    {
+        const int nStreams = APE_MIN(nPredictors - nFirst, NN_FILTER_STREAMS);
+        CPredictorCompressNormal<INTTYPE, DATATYPE> * aryPredictors[NN_FILTER_STREAMS];
+        for (int z = 0; z < nStreams; z++)
+            aryPredictors[z] = static_cast<CPredictorCompressNormal<INTTYPE, DATATYPE> *>(apPredictors[nFirst + z]);
+
+        INTTYPE aryValues[NN_FILTER_STREAMS][WINDOW_BLOCKS];
+        INTTYPE * aryStreams[NN_FILTER_STREAMS];
+        CNNFilter<INTTYPE, DATATYPE> * aryFilters[NN_FILTER_STREAMS];
+        for (int nStart = 0; nStart < nValues; nStart += WINDOW_BLOCKS)
+        {
+            const int nChunk = APE_MIN(nValues - nStart, WINDOW_BLOCKS);
+            for (int nStream = 0; nStream < nStreams; nStream++)
+            {
+                const int64 * pValues = &apValues[nFirst + nStream][nStart];
+                for (int z = 0; z < nChunk; z++)
+                    aryValues[nStream][z] = static_cast<INTTYPE>(pValues[z]);
+                aryStreams[nStream] = aryValues[nStream];
+            }
+
+            if (m_spNNFilter)
+            {
+                for (int z = 0; z < nStreams; z++)
+                    aryFilters[z] = aryPredictors[z]->m_spNNFilter;
+                CNNFilter<INTTYPE, DATATYPE>::CompressStreams(aryFilters, aryStreams, nStreams, nChunk);
+
+                if (m_spNNFilter1)
+                {
+                    for (int z = 0; z < nStreams; z++)
+                        aryFilters[z] = aryPredictors[z]->m_spNNFilter1;
+                    CNNFilter<INTTYPE, DATATYPE>::CompressStreams(aryFilters, aryStreams, nStreams, nChunk);
+
+                    if (m_spNNFilter2)
+                    {
+                        for (int z = 0; z < nStreams; z++)
+                            aryFilters[z] = aryPredictors[z]->m_spNNFilter2;
+                        CNNFilter<INTTYPE, DATATYPE>::CompressStreams(aryFilters, aryStreams, nStreams, nChunk);
+                    }
+                }
+            }
+
+            for (int nStream = 0; nStream < nStreams; nStream++)
+            {
+                int64 * pValues = &apValues[nFirst + nStream][nStart];
+                for (int z = 0; z < nChunk; z++)
+                    pValues[z] = aryValues[nStream][z];
+            }
+        }
+    }
+}
+
 template class CPredictorCompressNormal<int, short>;
 template class CPredictorCompressNormal<int64, int>;
 
@@ -341,6 +404,104 @@ template <class INTTYPE, class DATATYPE> int CPredictorDecompress3950toCurrent<I
 }
 
 template <class INTTYPE, class DATATYPE> int CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE>::DecompressValue(int64 _nA, int64 _nB)
+{
+    INTTYPE nA = static_cast<INTTYPE>(_nA);
+
+    // stage 2: NNFilter
+    if (m_spNNFilter2)
+        nA = m_spNNFilter2->Decompress(nA);
+    if (m_spNNFilter1)
+        nA = m_spNNFilter1->Decompress(nA);
+    if (m_spNNFilter)
+        nA = m_spNNFilter->Decompress(nA);
+
+    // stage 1
+    return CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE>::DecompressPrediction(nA, _nB);
+}
+
+template <class INTTYPE, class DATATYPE> void CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE>::DecompressFilters(int64 * paryValues, int nValues)
+{
+    // stage 2: NNFilter (each filter only sees the output of the one before it, so a chunk of values
+    // can go through them one after another)
+    INTTYPE aryValues[WINDOW_BLOCKS];
+    for (int nStart = 0; nStart < nValues; nStart += WINDOW_BLOCKS)
+    {
+        const int nChunk = APE_MIN(nValues - nStart, WINDOW_BLOCKS);
+        for (int z = 0; z < nChunk; z++)
+            aryValues[z] = static_cast<INTTYPE>(paryValues[nStart + z]);
+
+        if (m_spNNFilter2)
+            m_spNNFilter2->DecompressBlock(aryValues, aryValues, nChunk);
+        if (m_spNNFilter1)
+            m_spNNFilter1->DecompressBlock(aryValues, aryValues, nChunk);
+        if (m_spNNFilter)
+            m_spNNFilter->DecompressBlock(aryValues, aryValues, nChunk);
+
+        for (int z = 0; z < nChunk; z++)
+            paryValues[nStart + z] = aryValues[z];
+    }
+}
+
+template <class INTTYPE, class DATATYPE> void CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE>::DecompressFilters(IPredictorDecompress ** apPredictors, int64 ** apValues, int nPredictors, int nValues)
+{
+    // stage 2: NNFilter (like above, with the same filter of every predictor running at once)
+    for (int nFirst = 0; nFirst < nPredictors; nFirst += NN_FILTER_STREAMS)
+    {
+        const int nStreams = APE_MIN(nPredictors - nFirst, NN_FILTER_STREAMS);
+        CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE> * aryPredictors[NN_FILTER_STREAMS];
+        for (int z = 0; z < nStreams; z++)
+            aryPredictors[z] = static_cast<CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE> *>(apPredictors[nFirst + z]);
+
+        INTTYPE aryValues[NN_FILTER_STREAMS][WINDOW_BLOCKS];
+        INTTYPE * aryStreams[NN_FILTER_STREAMS];
+        CNNFilter<INTTYPE, DATATYPE> * aryFilters[NN_FILTER_STREAMS];
+        for (int nStart = 0; nStart < nValues; nStart += WINDOW_BLOCKS)
+        {
+            const int nChunk = APE_MIN(nValues - nStart, WINDOW_BLOCKS);
+            for (int nStream = 0; nStream < nStreams; nStream++)
+            {
+                const int64 * pValues = &apValues[nFirst + nStream][nStart];
+                for (int z = 0; z < nChunk; z++)
+                    aryValues[nStream][z] = static_cast<INTTYPE>(pValues[z]);
+                aryStreams[nStream] = aryValues[nStream];
+            }
+
+            if (m_spNNFilter2)
+            {
+                for (int z = 0; z < nStreams; z++)
+                    aryFilters[z] = aryPredictors[z]->m_spNNFilter2;
+                CNNFilter<INTTYPE, DATATYPE>::DecompressStreams(aryFilters, aryStreams, nStreams, nChunk);
+            }
+            if (m_spNNFilter1)
+            {
+                for (int z = 0; z < nStreams; z++)
+                    aryFilters[z] = aryPredictors[z]->m_spNNFilter1;
+                CNNFilter<INTTYPE, DATATYPE>::DecompressStreams(aryFilters, aryStreams, nStreams, nChunk);
+            }
+            if (m_spNNFilter)
+            {
+                for (int z = 0; z < nStreams; z++)
+                    aryFilters[z] = aryPredictors[z]->m_spNNFilter;
+                CNNFilter<INTTYPE, DATATYPE>::DecompressStreams(aryFilters, aryStreams, nStreams, nChunk);
+            }
+
+            for (int nStream = 0; nStream < nStreams; nStream++)
+            {
+                int64 * pValues = &apValues[nFirst + nStream][nStart];
+                for (int z = 0; z < nChunk; z++)
+                    pValues[z] = aryValues[nStream][z];
+            }
+        }
+    }
+}
+
+template <class INTTYPE, class DATATYPE> void CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE>::DecompressPredictions(const int64 * paryInput, int * paryOutput, int nValues)
+{
+    for (int z = 0; z < nValues; z++)
+        paryOutput[z] = CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE>::DecompressPrediction(paryInput[z], 0);
+}
+
+template <class INTTYPE, class DATATYPE> int CPredictorDecompress3950toCurrent<INTTYPE, DATATYPE>::DecompressPrediction(int64 _nA, int64 _nB)
 {
     if (m_nCurrentIndex == WINDOW_BLOCKS)
     {
@@ -351,17 +512,9 @@ template <class INTTYPE, class DATATYPE> int CPredictorDecompress3950toCurrent<I
         m_nCurrentIndex = 0;
     }
 
-    INTTYPE nA = static_cast<INTTYPE>(_nA);
+    const INTTYPE nA = static_cast<INTTYPE>(_nA);
     INTTYPE nB = static_cast<INTTYPE>(_nB);
 
-    // stage 2: NNFilter
-    if (m_spNNFilter2)
-        nA = m_spNNFilter2->Decompress(nA);
-    if (m_spNNFilter1)
-        nA = m_spNNFilter1->Decompress(nA);
-    if (m_spNNFilter)
-        nA = m_spNNFilter->Decompress(nA);
-
     // stage 1: multiple predictors (order 2 and offset 1)
     m_rbPredictionA[0] = m_nLastValueA;
     m_rbPredictionA[-1] = m_rbPredictionA[0] - m_rbPredictionA[-1];
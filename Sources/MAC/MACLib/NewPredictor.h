@@ -23,6 +23,9 @@ public:
     int64 CompressValue(int nA, int nB = 0) APE_OVERRIDE;
     int Flush() APE_OVERRIDE;
 
+    int64 CompressPrediction(int nA, int nB = 0) APE_OVERRIDE;
+    void CompressFilters(IPredictorCompress ** apPredictors, int64 ** apValues, int nPredictors, int nValues) APE_OVERRIDE;
+
 protected:
     // buffer information
     CRollBufferFast<INTTYPE, WINDOW_BLOCKS, 10> m_rbPrediction;
@@ -77,6 +80,11 @@ public:
     int DecompressValue(int64 nA, int64 nB = 0) APE_OVERRIDE;
     int Flush() APE_OVERRIDE;
 
+    void DecompressFilters(int64 * paryValues, int nValues) APE_OVERRIDE;
+    void DecompressFilters(IPredictorDecompress ** apPredictors, int64 ** apValues, int nPredictors, int nValues) APE_OVERRIDE;
+    int DecompressPrediction(int64 nA, int64 nB = 0) APE_OVERRIDE;
+    void DecompressPredictions(const int64 * paryInput, int * paryOutput, int nValues) APE_OVERRIDE;
+
     void SetInterimMode(bool bSet) APE_OVERRIDE;
 
 protected:
@@ -4,6 +4,7 @@
 
 #include "APEDecompressOld.h"
 #include "APEInfo.h"
+#include "OutputConversion.h"
 
 namespace APE
 {
@@ -54,6 +55,16 @@ int CAPEDecompressOld::SetNumberOfThreads(int)
     return 1;
 }
 
+int CAPEDecompressOld::SetFramesInFlight(int)
+{
+    return 1;
+}
+
+int CAPEDecompressOld::SetDecodeMode(int)
+{
+    return APE_DECODE_MODE_INTERLEAVED;
+}
+
 int CAPEDecompressOld::InitializeDecompressor()
 {
     // check if we have anything to do
@@ -131,6 +142,76 @@ int CAPEDecompressOld::GetData(unsigned char * pBuffer, int64 nBlocks, int64 * p
     return ERROR_SUCCESS;
 }
 
+int CAPEDecompressOld::GetDataEx(unsigned char ** apBuffers, int64 nBlocks, int64 * pBlocksRetrieved, const APE_OUTPUT_FORMAT * pFormat)
+{
+    if (pBlocksRetrieved) *pBlocksRetrieved = 0;
+
+    uint32 nChannelMask = 0;
+    RETURN_ON_ERROR(COutputConversion::CheckFormat(pFormat, apBuffers, static_cast<int>(GetInfo(APE_INFO_CHANNELS)), &nChannelMask))
+
+    RETURN_ON_ERROR(InitializeDecompressor())
+
+    // there are no workers, so a frame's worth at a time is decoded into the lease buffer and converted here
+    const int64 nBlocksPerFrame = GetInfo(APE_INFO_BLOCKS_PER_FRAME);
+    const int nChannels = COutputConversion::GetChannels(nChannelMask);
+    const int nBytesPerSample = COutputConversion::GetBytesPerSample(pFormat->nSampleFormat);
+    if (m_spLeaseBuffer == APE_NULL)
+        m_spLeaseBuffer.Assign(new unsigned char [static_cast<size_t>(nBlocksPerFrame * m_nBlockAlign)], true);
+    if (m_spConvertBuffer == APE_NULL)
+        m_spConvertBuffer.Assign(new unsigned char [static_cast<size_t>(nBlocksPerFrame * GetInfo(APE_INFO_CHANNELS) * 4)], true);
+
+    WAVEFORMATEX wfeInput; APE_CLEAR(wfeInput);
+    GetInfo(APE_INFO_WAVEFORMATEX, POINTER_TO_INT64(&wfeInput));
+
+    int64 nBlocksRetrieved = 0;
+    while (nBlocksRetrieved < nBlocks)
+    {
+        int64 nBlocksThisPass = 0;
+        RETURN_ON_ERROR(GetData(m_spLeaseBuffer, APE_MIN(nBlocks - nBlocksRetrieved, nBlocksPerFrame), &nBlocksThisPass))
+        if (nBlocksThisPass <= 0)
+            break;
+
+        const int64 nPlaneBytes = pFormat->bPlanar ? nBlocksThisPass * nBytesPerSample : 0;
+        COutputConversion::Convert(m_spLeaseBuffer, static_cast<int>(nBlocksThisPass), &wfeInput, false, pFormat->nSampleFormat, nChannelMask, m_spConvertBuffer, nPlaneBytes);
+        COutputConversion::CopyOut(m_spConvertBuffer, nBlocksThisPass, nChannels, nBytesPerSample, nPlaneBytes, apBuffers, nBlocksRetrieved);
+        nBlocksRetrieved += nBlocksThisPass;
+        if (pBlocksRetrieved) *pBlocksRetrieved = nBlocksRetrieved;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+int CAPEDecompressOld::LeaseFrameData(unsigned char ** ppBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing)
+{
+    if (ppBuffer == APE_NULL) return ERROR_BAD_PARAMETER;
+    *ppBuffer = APE_NULL;
+    if (pBlocksRetrieved) *pBlocksRetrieved = 0;
+
+    RETURN_ON_ERROR(InitializeDecompressor())
+
+    // we can't hand out our decoding buffer since it gets shifted, so a frame is copied out instead
+    const int64 nBlocksPerFrame = GetInfo(APE_INFO_BLOCKS_PER_FRAME);
+    if (m_spLeaseBuffer == APE_NULL)
+        m_spLeaseBuffer.Assign(new unsigned char [static_cast<size_t>(nBlocksPerFrame * m_nBlockAlign)], true);
+
+    RETURN_ON_ERROR(GetData(m_spLeaseBuffer, nBlocksPerFrame, pBlocksRetrieved, pProcessing))
+
+    *ppBuffer = m_spLeaseBuffer;
+    return ERROR_SUCCESS;
+}
+
+int CAPEDecompressOld::ReleaseFrameData()
+{
+    return ERROR_SUCCESS;
+}
+
+int CAPEDecompressOld::DecodeFrame(int64, unsigned char *, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING *)
+{
+    // the old decoder has a single decoding state that belongs to GetData(...) / Seek(...)
+    if (pBlocksRetrieved) *pBlocksRetrieved = 0;
+    return ERROR_UNSUPPORTED_FILE_VERSION;
+}
+
 int CAPEDecompressOld::Seek(int64 nBlockOffset)
 {
     RETURN_ON_ERROR(InitializeDecompressor())
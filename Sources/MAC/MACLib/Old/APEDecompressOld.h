@@ -13,9 +13,15 @@ public:
     ~CAPEDecompressOld();
 
     int SetNumberOfThreads(int nThreads) APE_OVERRIDE;
+    int SetFramesInFlight(int nFrames) APE_OVERRIDE;
+    int SetDecodeMode(int nMode) APE_OVERRIDE;
 
     int GetData(unsigned char * pBuffer, int64 nBlocks, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) APE_OVERRIDE;
+    int GetDataEx(unsigned char ** apBuffers, int64 nBlocks, int64 * pBlocksRetrieved, const APE_OUTPUT_FORMAT * pFormat) APE_OVERRIDE;
     int Seek(int64 nBlockOffset) APE_OVERRIDE;
+    int LeaseFrameData(unsigned char ** ppBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) APE_OVERRIDE;
+    int ReleaseFrameData() APE_OVERRIDE;
+    int DecodeFrame(int64 nFrameIndex, unsigned char * pBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) APE_OVERRIDE;
 
     int64 GetInfo(APE_DECOMPRESS_FIELDS Field, int64 nParam1 = 0, int64 nParam2 = 0) APE_OVERRIDE;
 
@@ -23,6 +29,8 @@ protected:
     // buffer
     CSmartPtr<unsigned char> m_spBuffer;
     int64 m_nBufferTail;
+    CSmartPtr<unsigned char> m_spLeaseBuffer;
+    CSmartPtr<unsigned char> m_spConvertBuffer;
 
     // file info
     int64 m_nBlockAlign;
@@ -371,9 +371,6 @@ CUnBitArray3891To3989::CUnBitArray3891To3989(CIO * pIO, intn nVersion, int64 nFu
 {
     APE_CLEAR(m_RangeCoderInfo);
     CreateHelper(pIO, 16384, nVersion);
-
-    // create the range table
-    m_spRangeTable.Assign(new RangeOverflowTable(RANGE_TOTAL_1));
 }
 
 CUnBitArray3891To3989::~CUnBitArray3891To3989()
@@ -448,7 +445,7 @@ int64 CUnBitArray3891To3989::DecodeValueRange(UNBIT_ARRAY_STATE & BitArrayState)
         throw(ERROR_INVALID_INPUT_FILE);
 
     // lookup the symbol from lookup table
-    uint32 nOverflow = m_spRangeTable->Get(nRangeTotal);
+    uint32 nOverflow = GetRangeOverflow(RANGE_TOTAL_1, RANGE_OVERFLOW_1, nRangeTotal);
 
     // update
     m_RangeCoderInfo.low -= m_RangeCoderInfo.range * RANGE_TOTAL_1[nOverflow];
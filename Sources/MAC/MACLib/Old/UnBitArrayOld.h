@@ -66,7 +66,6 @@ public:
 
 private:
     // data
-    CSmartPtr<RangeOverflowTable> m_spRangeTable;
     RANGE_CODER_STRUCT_DECOMPRESS m_RangeCoderInfo;
 
     // functions
@@ -0,0 +1,316 @@
+#include "All.h"
+#include "MACLib.h"
+#include "OutputConversion.h"
+#include "OutputProcessing.h"
+#include "FloatTransform.h"
+#include "CPUFeatures.h"
+
+#if APE_BYTE_ORDER == APE_LITTLE_ENDIAN
+    #define APE_24_SHIFT_1ST 0
+    #define APE_24_SHIFT_2ND 8
+    #define APE_24_SHIFT_3RD 16
+#else
+    #define APE_24_SHIFT_1ST 16
+    #define APE_24_SHIFT_2ND 8
+    #define APE_24_SHIFT_3RD 0
+#endif
+
+namespace APE
+{
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    int64 ConvertSamplesAVX2(const unsigned char * pInput, int64 nSamples, int nBytesPerSample, int nSampleFormat, unsigned char * pOutput);
+#endif
+
+#if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    int64 ConvertSamplesNeon(const unsigned char * pInput, int64 nSamples, int nBytesPerSample, int nSampleFormat, unsigned char * pOutput);
+#endif
+
+// the SIMD code is picked once (the CPU can't change)
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    static bool UseAVX2() { static const bool bAVX2 = GetAVX2Available() && GetAVX2Supported(); return bAVX2; }
+#endif
+
+#if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    static bool UseNeon() { static const bool bNeon = GetNeonAvailable() && GetNeonSupported(); return bNeon; }
+#endif
+
+/**************************************************************************************************
+Format information
+**************************************************************************************************/
+/*static*/ bool COutputConversion::IsValidFormat(int nSampleFormat)
+{
+    return (nSampleFormat >= APE_SAMPLE_FORMAT_INT16) && (nSampleFormat <= APE_SAMPLE_FORMAT_FLOAT32);
+}
+
+/*static*/ int COutputConversion::GetBytesPerSample(int nSampleFormat)
+{
+    return (nSampleFormat == APE_SAMPLE_FORMAT_INT16) ? 2 : 4;
+}
+
+/*static*/ uint32 COutputConversion::GetAllChannels(int nChannels)
+{
+    return (nChannels >= 32) ? 0xFFFFFFFF : ((static_cast<uint32>(1) << nChannels) - 1);
+}
+
+/*static*/ int COutputConversion::GetChannels(uint32 nChannelMask)
+{
+    int nChannels = 0;
+    for (; nChannelMask != 0; nChannelMask &= nChannelMask - 1)
+        nChannels++;
+    return nChannels;
+}
+
+/*static*/ int COutputConversion::CheckFormat(const IAPEDecompress::APE_OUTPUT_FORMAT * pFormat, unsigned char ** apBuffers, int nChannels, uint32 * pChannelMask)
+{
+    if ((apBuffers == APE_NULL) || (pFormat == APE_NULL) || !IsValidFormat(pFormat->nSampleFormat))
+        return ERROR_BAD_PARAMETER;
+
+    const uint32 nAllChannels = GetAllChannels(nChannels);
+    const uint32 nChannelMask = (pFormat->nChannelMask == 0) ? nAllChannels : pFormat->nChannelMask;
+    if ((nChannelMask & ~nAllChannels) != 0)
+        return ERROR_BAD_PARAMETER;
+
+    // planar output needs a buffer for each channel
+    const int nBuffers = pFormat->bPlanar ? GetChannels(nChannelMask) : 1;
+    for (int z = 0; z < nBuffers; z++)
+    {
+        if (apBuffers[z] == APE_NULL)
+            return ERROR_BAD_PARAMETER;
+    }
+
+    *pChannelMask = nChannelMask;
+    return ERROR_SUCCESS;
+}
+
+/**************************************************************************************************
+Conversion
+
+Integer samples are read as full scale 32-bit values (shifted up), so every sample size converts
+the same way: shifted down for the integer formats, and scaled by 2^-31 for floats (which is exact
+up to 24 bits); floating point files are scaled and rounded for the integer formats
+**************************************************************************************************/
+template <int BYTES> static __forceinline int32 ReadSample(const unsigned char * pInput)
+{
+    if (BYTES == 1)
+    {
+        // 8-bit is stored unsigned
+        return static_cast<int32>(static_cast<uint32>(pInput[0] ^ 0x80) << 24);
+    }
+    else if (BYTES == 2)
+    {
+        int16 nValue;
+        memcpy(&nValue, pInput, 2);
+        return static_cast<int32>(static_cast<uint32>(static_cast<int32>(nValue)) << 16);
+    }
+    else if (BYTES == 3)
+    {
+        const uint32 nValue = (static_cast<uint32>(pInput[0]) << APE_24_SHIFT_1ST) | (static_cast<uint32>(pInput[1]) << APE_24_SHIFT_2ND) | (static_cast<uint32>(pInput[2]) << APE_24_SHIFT_3RD);
+        return static_cast<int32>(nValue << 8);
+    }
+    else
+    {
+        int32 nValue;
+        memcpy(&nValue, pInput, 4);
+        return nValue;
+    }
+}
+
+template <int FORMAT> static __forceinline void WriteSample(int32 nValue, unsigned char * pOutput)
+{
+    if (FORMAT == APE_SAMPLE_FORMAT_INT16)
+    {
+        const int16 nOutput = static_cast<int16>(nValue >> 16);
+        memcpy(pOutput, &nOutput, 2);
+    }
+    else if (FORMAT == APE_SAMPLE_FORMAT_INT24_IN_INT32)
+    {
+        const int32 nOutput = nValue >> 8;
+        memcpy(pOutput, &nOutput, 4);
+    }
+    else if (FORMAT == APE_SAMPLE_FORMAT_INT32)
+    {
+        memcpy(pOutput, &nValue, 4);
+    }
+    else
+    {
+        const float fOutput = static_cast<float>(nValue) * (1.0f / 2147483648.0f);
+        memcpy(pOutput, &fOutput, 4);
+    }
+}
+
+template <int FORMAT> static __forceinline void WriteFloatSample(float fValue, unsigned char * pOutput)
+{
+    if (FORMAT == APE_SAMPLE_FORMAT_FLOAT32)
+    {
+        memcpy(pOutput, &fValue, 4);
+        return;
+    }
+
+    // round and clip (a NaN comes out as the lowest value)
+    const int nBits = (FORMAT == APE_SAMPLE_FORMAT_INT16) ? 16 : ((FORMAT == APE_SAMPLE_FORMAT_INT24_IN_INT32) ? 24 : 32);
+    const double dMaximum = static_cast<double>((static_cast<int64>(1) << (nBits - 1)) - 1);
+    double dValue = floor(static_cast<double>(fValue) * (dMaximum + 1) + 0.5);
+    if (dValue > dMaximum)
+        dValue = dMaximum;
+    if (!(dValue >= -dMaximum - 1))
+        dValue = -dMaximum - 1;
+
+    if (FORMAT == APE_SAMPLE_FORMAT_INT16)
+    {
+        const int16 nOutput = static_cast<int16>(dValue);
+        memcpy(pOutput, &nOutput, 2);
+    }
+    else
+    {
+        const int32 nOutput = static_cast<int32>(dValue);
+        memcpy(pOutput, &nOutput, 4);
+    }
+}
+
+template <int FORMAT> static void GetOutputSteps(uint32 nChannelMask, int64 nPlaneBytes, int64 * pChannelStep, int64 * pBlockStep)
+{
+    // interleaved output has a block's channels side by side, and planar output has each channel in its plane
+    const int nOutputBytes = (FORMAT == APE_SAMPLE_FORMAT_INT16) ? 2 : 4;
+    *pChannelStep = (nPlaneBytes == 0) ? nOutputBytes : nPlaneBytes;
+    *pBlockStep = (nPlaneBytes == 0) ? static_cast<int64>(COutputConversion::GetChannels(nChannelMask)) * nOutputBytes : nOutputBytes;
+}
+
+template <int BYTES, int FORMAT> static void ConvertGeneric(const unsigned char * pInput, int nBlocks, int nChannels, uint32 nChannelMask, unsigned char * pOutput, int64 nPlaneBytes)
+{
+    int64 nChannelStep = 0, nBlockStep = 0;
+    GetOutputSteps<FORMAT>(nChannelMask, nPlaneBytes, &nChannelStep, &nBlockStep);
+    for (int nBlock = 0; nBlock < nBlocks; nBlock++)
+    {
+        unsigned char * pChannelOutput = pOutput;
+        for (int nChannel = 0; nChannel < nChannels; nChannel++)
+        {
+            if (nChannelMask & (static_cast<uint32>(1) << nChannel))
+            {
+                WriteSample<FORMAT>(ReadSample<BYTES>(pInput), pChannelOutput);
+                pChannelOutput += nChannelStep;
+            }
+            pInput += BYTES;
+        }
+        pOutput += nBlockStep;
+    }
+}
+
+template <int FORMAT> static void ConvertFloatGeneric(const unsigned char * pInput, int nBlocks, int nChannels, uint32 nChannelMask, unsigned char * pOutput, int64 nPlaneBytes)
+{
+    int64 nChannelStep = 0, nBlockStep = 0;
+    GetOutputSteps<FORMAT>(nChannelMask, nPlaneBytes, &nChannelStep, &nBlockStep);
+    for (int nBlock = 0; nBlock < nBlocks; nBlock++)
+    {
+        unsigned char * pChannelOutput = pOutput;
+        for (int nChannel = 0; nChannel < nChannels; nChannel++)
+        {
+            if (nChannelMask & (static_cast<uint32>(1) << nChannel))
+            {
+                uint32 nValue;
+                memcpy(&nValue, pInput, 4);
+                CFloatTransform::Process(&nValue, 1);
+
+                float fValue;
+                memcpy(&fValue, &nValue, 4);
+                WriteFloatSample<FORMAT>(fValue, pChannelOutput);
+                pChannelOutput += nChannelStep;
+            }
+            pInput += 4;
+        }
+        pOutput += nBlockStep;
+    }
+}
+
+template <int BYTES> static void ConvertBytes(const unsigned char * pInput, int nBlocks, int nChannels, uint32 nChannelMask, int nSampleFormat, unsigned char * pOutput, int64 nPlaneBytes)
+{
+    if (nSampleFormat == APE_SAMPLE_FORMAT_INT16)
+        ConvertGeneric<BYTES, APE_SAMPLE_FORMAT_INT16>(pInput, nBlocks, nChannels, nChannelMask, pOutput, nPlaneBytes);
+    else if (nSampleFormat == APE_SAMPLE_FORMAT_INT24_IN_INT32)
+        ConvertGeneric<BYTES, APE_SAMPLE_FORMAT_INT24_IN_INT32>(pInput, nBlocks, nChannels, nChannelMask, pOutput, nPlaneBytes);
+    else if (nSampleFormat == APE_SAMPLE_FORMAT_INT32)
+        ConvertGeneric<BYTES, APE_SAMPLE_FORMAT_INT32>(pInput, nBlocks, nChannels, nChannelMask, pOutput, nPlaneBytes);
+    else
+        ConvertGeneric<BYTES, APE_SAMPLE_FORMAT_FLOAT32>(pInput, nBlocks, nChannels, nChannelMask, pOutput, nPlaneBytes);
+}
+
+/*static*/ void COutputConversion::Convert(const unsigned char * pInput, int nBlocks, const WAVEFORMATEX * pwfeInput, bool bFloat,
+    int nSampleFormat, uint32 nChannelMask, unsigned char * pOutput, int64 nPlaneBytes)
+{
+    int nChannels = pwfeInput->nChannels;
+    const int nBytesPerSample = pwfeInput->wBitsPerSample / 8;
+
+    // a single channel is the same planar or interleaved
+    if (GetChannels(nChannelMask) == 1)
+        nPlaneBytes = 0;
+
+    if (bFloat)
+    {
+        // floats output as floats only need the transform
+        if ((nSampleFormat == APE_SAMPLE_FORMAT_FLOAT32) && (nChannelMask == GetAllChannels(nChannels)) && (nPlaneBytes == 0))
+        {
+            memcpy(pOutput, pInput, static_cast<size_t>(nBlocks) * static_cast<size_t>(nChannels) * 4);
+            COutputProcessing::Process(pOutput, static_cast<int64>(nBlocks) * nChannels, 4, APE_FORMAT_FLAG_FLOATING_POINT);
+        }
+        else if (nSampleFormat == APE_SAMPLE_FORMAT_INT16)
+            ConvertFloatGeneric<APE_SAMPLE_FORMAT_INT16>(pInput, nBlocks, nChannels, nChannelMask, pOutput, nPlaneBytes);
+        else if (nSampleFormat == APE_SAMPLE_FORMAT_INT24_IN_INT32)
+            ConvertFloatGeneric<APE_SAMPLE_FORMAT_INT24_IN_INT32>(pInput, nBlocks, nChannels, nChannelMask, pOutput, nPlaneBytes);
+        else if (nSampleFormat == APE_SAMPLE_FORMAT_INT32)
+            ConvertFloatGeneric<APE_SAMPLE_FORMAT_INT32>(pInput, nBlocks, nChannels, nChannelMask, pOutput, nPlaneBytes);
+        else
+            ConvertFloatGeneric<APE_SAMPLE_FORMAT_FLOAT32>(pInput, nBlocks, nChannels, nChannelMask, pOutput, nPlaneBytes);
+        return;
+    }
+
+    // with every channel interleaved it's just a run of samples, so the SIMD code does whole vectors of
+    // them and the scalar code does the rest
+    if ((nChannelMask == GetAllChannels(nChannels)) && (nPlaneBytes == 0))
+    {
+        const int64 nSamples = static_cast<int64>(nBlocks) * nChannels;
+        int64 nDone = 0;
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+        if (UseAVX2())
+            nDone = ConvertSamplesAVX2(pInput, nSamples, nBytesPerSample, nSampleFormat, pOutput);
+#elif defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+        if (UseNeon())
+            nDone = ConvertSamplesNeon(pInput, nSamples, nBytesPerSample, nSampleFormat, pOutput);
+#endif
+
+        pInput = &pInput[nDone * nBytesPerSample];
+        pOutput = &pOutput[nDone * GetBytesPerSample(nSampleFormat)];
+        nBlocks = static_cast<int>(nSamples - nDone);
+        nChannels = 1;
+        nChannelMask = 1;
+    }
+
+    if (nBytesPerSample == 1)
+        ConvertBytes<1>(pInput, nBlocks, nChannels, nChannelMask, nSampleFormat, pOutput, nPlaneBytes);
+    else if (nBytesPerSample == 2)
+        ConvertBytes<2>(pInput, nBlocks, nChannels, nChannelMask, nSampleFormat, pOutput, nPlaneBytes);
+    else if (nBytesPerSample == 3)
+        ConvertBytes<3>(pInput, nBlocks, nChannels, nChannelMask, nSampleFormat, pOutput, nPlaneBytes);
+    else
+        ConvertBytes<4>(pInput, nBlocks, nChannels, nChannelMask, nSampleFormat, pOutput, nPlaneBytes);
+}
+
+/**************************************************************************************************
+Copy out
+**************************************************************************************************/
+/*static*/ void COutputConversion::CopyOut(const unsigned char * pInput, int64 nBlocks, int nChannels, int nBytesPerSample,
+    int64 nPlaneBytes, unsigned char ** apBuffers, int64 nOffset)
+{
+    // the input is already laid out the way the caller wants it, so it's a copy for each buffer
+    if ((nPlaneBytes == 0) || (nChannels == 1))
+    {
+        const int64 nBlockAlign = static_cast<int64>(nChannels) * nBytesPerSample;
+        memcpy(&apBuffers[0][nOffset * nBlockAlign], pInput, static_cast<size_t>(nBlocks * nBlockAlign));
+    }
+    else
+    {
+        for (int nChannel = 0; nChannel < nChannels; nChannel++)
+            memcpy(&apBuffers[nChannel][nOffset * nBytesPerSample], &pInput[nChannel * nPlaneBytes], static_cast<size_t>(nBlocks * nBytesPerSample));
+    }
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MACLib.h"
+
+namespace APE
+{
+
+/**************************************************************************************************
+COutputConversion - converts decoded data to the sample formats GetDataEx(...) outputs (see
+APE_OUTPUT_FORMAT)
+
+The input is the packed PCM the decoder makes (before any APE_GET_DATA_PROCESSING), and the output
+is the channels in the mask, interleaved or each in a plane of its own (nPlaneBytes apart, 0 for
+interleaved); CopyOut(...) then copies them into the caller's buffers as they are
+**************************************************************************************************/
+class COutputConversion
+{
+public:
+    // format information
+    static bool IsValidFormat(int nSampleFormat);
+    static int GetBytesPerSample(int nSampleFormat);
+    static uint32 GetAllChannels(int nChannels);
+    static int GetChannels(uint32 nChannelMask);
+
+    // check the caller's format and buffers, and get the channels to output (a mask of 0 is every channel)
+    static int CheckFormat(const IAPEDecompress::APE_OUTPUT_FORMAT * pFormat, unsigned char ** apBuffers, int nChannels, uint32 * pChannelMask);
+
+    // convert
+    static void Convert(const unsigned char * pInput, int nBlocks, const WAVEFORMATEX * pwfeInput, bool bFloat,
+        int nSampleFormat, uint32 nChannelMask, unsigned char * pOutput, int64 nPlaneBytes);
+
+    // copy converted blocks to block nOffset of the caller's buffers
+    static void CopyOut(const unsigned char * pInput, int64 nBlocks, int nChannels, int nBytesPerSample,
+        int64 nPlaneBytes, unsigned char ** apBuffers, int64 nOffset);
+};
+
+}
@@ -0,0 +1,123 @@
+#include "All.h"
+#include "MACLib.h"
+#include "CPUFeatures.h"
+
+#if defined(__AVX2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC)) || defined(APE_TARGET_ATTRIBUTES_X86)
+    #define APE_USE_AVX2_INTRINSICS
+#endif
+
+#ifdef APE_USE_AVX2_INTRINSICS
+    #include <immintrin.h> // AVX2
+#endif
+
+namespace APE
+{
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+
+#ifdef APE_USE_AVX2_INTRINSICS
+
+/**************************************************************************************************
+Output conversion with AVX2 (see COutputConversion)
+
+Eight samples are loaded as full scale 32-bit values, then stored in the output format
+**************************************************************************************************/
+template <int BYTES> static APE_TARGET_AVX2 __m256i LoadSamplesAVX2(const unsigned char * pInput)
+{
+    if (BYTES == 1)
+    {
+        // 8-bit is stored unsigned
+        const __m256i avxValues = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(pInput)));
+        return _mm256_slli_epi32(_mm256_xor_si256(avxValues, _mm256_set1_epi32(0x80)), 24);
+    }
+    else if (BYTES == 2)
+    {
+        return _mm256_slli_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput))), 16);
+    }
+    else if (BYTES == 3)
+    {
+        // each lane gets four samples (bytes 0 to 11 and 12 to 23), which go to the top of their values
+        // (this reads 32 bytes)
+        const __m256i avxSpread = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+        const __m256i avxShuffle = _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+        const __m256i avxValues = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pInput));
+        return _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(avxValues, avxSpread), avxShuffle);
+    }
+    else
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pInput));
+    }
+}
+
+template <int FORMAT> static APE_TARGET_AVX2 void StoreSamplesAVX2(__m256i avxValues, unsigned char * pOutput)
+{
+    if (FORMAT == APE_SAMPLE_FORMAT_INT16)
+    {
+        // the pack works within lanes, so the halves are put back together after
+        const __m256i avxPacked = _mm256_packs_epi32(_mm256_srai_epi32(avxValues, 16), avxValues);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pOutput), _mm256_castsi256_si128(_mm256_permute4x64_epi64(avxPacked, 0x08)));
+    }
+    else if (FORMAT == APE_SAMPLE_FORMAT_INT24_IN_INT32)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pOutput), _mm256_srai_epi32(avxValues, 8));
+    }
+    else if (FORMAT == APE_SAMPLE_FORMAT_INT32)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pOutput), avxValues);
+    }
+    else
+    {
+        const __m256 avxScaled = _mm256_mul_ps(_mm256_cvtepi32_ps(avxValues), _mm256_set1_ps(1.0f / 2147483648.0f));
+        _mm256_storeu_ps(reinterpret_cast<float *>(pOutput), avxScaled);
+    }
+}
+
+template <int BYTES, int FORMAT> static APE_TARGET_AVX2 int64 ConvertSamplesAVX2Generic(const unsigned char * pInput, int64 nSamples, unsigned char * pOutput)
+{
+    // the 24-bit load reads 8 bytes past the samples
+    const int nOutputBytes = (FORMAT == APE_SAMPLE_FORMAT_INT16) ? 2 : 4;
+    const int64 nReadBytes = (BYTES == 3) ? 32 : 8 * BYTES;
+    int64 nSample = 0;
+    for (; (nSample * BYTES) + nReadBytes <= nSamples * BYTES; nSample += 8)
+        StoreSamplesAVX2<FORMAT>(LoadSamplesAVX2<BYTES>(&pInput[nSample * BYTES]), &pOutput[nSample * nOutputBytes]);
+    return nSample;
+}
+
+template <int BYTES> static APE_TARGET_AVX2 int64 ConvertBytesAVX2(const unsigned char * pInput, int64 nSamples, int nSampleFormat, unsigned char * pOutput)
+{
+    if (nSampleFormat == APE_SAMPLE_FORMAT_INT16)
+        return ConvertSamplesAVX2Generic<BYTES, APE_SAMPLE_FORMAT_INT16>(pInput, nSamples, pOutput);
+    else if (nSampleFormat == APE_SAMPLE_FORMAT_INT24_IN_INT32)
+        return ConvertSamplesAVX2Generic<BYTES, APE_SAMPLE_FORMAT_INT24_IN_INT32>(pInput, nSamples, pOutput);
+    else if (nSampleFormat == APE_SAMPLE_FORMAT_INT32)
+        return ConvertSamplesAVX2Generic<BYTES, APE_SAMPLE_FORMAT_INT32>(pInput, nSamples, pOutput);
+    else
+        return ConvertSamplesAVX2Generic<BYTES, APE_SAMPLE_FORMAT_FLOAT32>(pInput, nSamples, pOutput);
+}
+
+#endif
+
+/**************************************************************************************************
+Converts whole vectors of integer samples and returns how many it did (the scalar code does the rest)
+**************************************************************************************************/
+APE_TARGET_AVX2 int64 ConvertSamplesAVX2(const unsigned char * pInput, int64 nSamples, int nBytesPerSample, int nSampleFormat, unsigned char * pOutput)
+{
+#ifdef APE_USE_AVX2_INTRINSICS
+    if (nBytesPerSample == 1)
+        return ConvertBytesAVX2<1>(pInput, nSamples, nSampleFormat, pOutput);
+    else if (nBytesPerSample == 2)
+        return ConvertBytesAVX2<2>(pInput, nSamples, nSampleFormat, pOutput);
+    else if (nBytesPerSample == 3)
+        return ConvertBytesAVX2<3>(pInput, nSamples, nSampleFormat, pOutput);
+    else
+        return ConvertBytesAVX2<4>(pInput, nSamples, nSampleFormat, pOutput);
+#else
+    (void) pInput; (void) nSamples; (void) nBytesPerSample; (void) nSampleFormat; (void) pOutput;
+    return 0;
+#endif
+}
+
+#endif
+
+}
@@ -0,0 +1,60 @@
+#include "All.h"
+#include "MACLib.h"
+#include "CPUFeatures.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    #define APE_USE_NEON_INTRINSICS
+#endif
+
+#ifdef APE_USE_NEON_INTRINSICS
+    #include <arm_neon.h> // Neon
+#endif
+
+namespace APE
+{
+
+#if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+
+/**************************************************************************************************
+Output conversion with Neon (see COutputConversion)
+
+Converts whole vectors of 16-bit and 32-bit samples (four at a time, as full scale 32-bit values)
+and returns how many it did (the scalar code does the rest, and the other sizes)
+**************************************************************************************************/
+int64 ConvertSamplesNeon(const unsigned char * pInput, int64 nSamples, int nBytesPerSample, int nSampleFormat, unsigned char * pOutput)
+{
+    int64 nSample = 0;
+
+#ifdef APE_USE_NEON_INTRINSICS
+    if ((nBytesPerSample != 2) && (nBytesPerSample != 4))
+        return 0;
+
+    const int nOutputBytes = (nSampleFormat == APE_SAMPLE_FORMAT_INT16) ? 2 : 4;
+    for (; nSample + 4 <= nSamples; nSample += 4)
+    {
+        int32x4_t neonValues;
+        if (nBytesPerSample == 2)
+            neonValues = vshlq_n_s32(vmovl_s16(vld1_s16(reinterpret_cast<const int16_t *>(&pInput[nSample * 2]))), 16);
+        else
+            neonValues = vld1q_s32(reinterpret_cast<const int32_t *>(&pInput[nSample * 4]));
+
+        unsigned char * pValues = &pOutput[nSample * nOutputBytes];
+        if (nSampleFormat == APE_SAMPLE_FORMAT_INT16)
+            vst1_s16(reinterpret_cast<int16_t *>(pValues), vshrn_n_s32(neonValues, 16));
+        else if (nSampleFormat == APE_SAMPLE_FORMAT_INT24_IN_INT32)
+            vst1q_s32(reinterpret_cast<int32_t *>(pValues), vshrq_n_s32(neonValues, 8));
+        else if (nSampleFormat == APE_SAMPLE_FORMAT_INT32)
+            vst1q_s32(reinterpret_cast<int32_t *>(pValues), neonValues);
+        else
+            vst1q_f32(reinterpret_cast<float *>(pValues), vmulq_n_f32(vcvtq_f32_s32(neonValues), 1.0f / 2147483648.0f));
+    }
+#else
+    (void) pInput; (void) nSamples; (void) nBytesPerSample; (void) nSampleFormat; (void) pOutput;
+#endif
+
+    return nSample;
+}
+
+#endif
+
+}
@@ -0,0 +1,97 @@
+#include "All.h"
+#include "MACLib.h"
+#include "OutputProcessing.h"
+#include "FloatTransform.h"
+#include "GlobalFunctions.h"
+#include "CPUFeatures.h"
+
+namespace APE
+{
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    int64 FloatTransformAVX2(unsigned char * pBuffer, int64 nSamples);
+    int64 Signed8BitAVX2(unsigned char * pBuffer, int64 nSamples);
+    int64 SwitchBufferBytesAVX2(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample);
+#endif
+
+#if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    int64 FloatTransformNeon(unsigned char * pBuffer, int64 nSamples);
+    int64 Signed8BitNeon(unsigned char * pBuffer, int64 nSamples);
+    int64 SwitchBufferBytesNeon(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample);
+#endif
+
+// the SIMD code is picked once (the CPU can't change)
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    static bool UseAVX2() { static const bool bAVX2 = GetAVX2Available() && GetAVX2Supported(); return bAVX2; }
+#endif
+
+#if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    static bool UseNeon() { static const bool bNeon = GetNeonAvailable() && GetNeonSupported(); return bNeon; }
+#endif
+
+/*static*/ void COutputProcessing::Process(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample, int nFlags)
+{
+    if ((nFlags & APE_FORMAT_FLAG_FLOATING_POINT) && (nBytesPerSample == 4))
+        ProcessFloat(pBuffer, nSamples);
+    if ((nFlags & APE_FORMAT_FLAG_SIGNED_8_BIT) && (nBytesPerSample == 1))
+        ProcessSigned8Bit(pBuffer, nSamples);
+    if ((nFlags & APE_FORMAT_FLAG_BIG_ENDIAN) && (nBytesPerSample >= 2))
+        ProcessBigEndian(pBuffer, nSamples, nBytesPerSample);
+}
+
+/*static*/ void COutputProcessing::Unprocess(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample, int nFlags)
+{
+    if ((nFlags & APE_FORMAT_FLAG_BIG_ENDIAN) && (nBytesPerSample >= 2))
+        ProcessBigEndian(pBuffer, nSamples, nBytesPerSample);
+    if ((nFlags & APE_FORMAT_FLAG_SIGNED_8_BIT) && (nBytesPerSample == 1))
+        ProcessSigned8Bit(pBuffer, nSamples);
+    if ((nFlags & APE_FORMAT_FLAG_FLOATING_POINT) && (nBytesPerSample == 4))
+        ProcessFloat(pBuffer, nSamples);
+}
+
+/*static*/ void COutputProcessing::ProcessFloat(unsigned char * pBuffer, int64 nSamples)
+{
+    // the SIMD code does whole vectors and the scalar code does the rest
+    int64 nDone = 0;
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    if (UseAVX2())
+        nDone = FloatTransformAVX2(pBuffer, nSamples);
+#elif defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    if (UseNeon())
+        nDone = FloatTransformNeon(pBuffer, nSamples);
+#endif
+
+    CFloatTransform::Process(reinterpret_cast<uint32 *>(&pBuffer[nDone * 4]), nSamples - nDone);
+}
+
+/*static*/ void COutputProcessing::ProcessSigned8Bit(unsigned char * pBuffer, int64 nSamples)
+{
+    int64 nDone = 0;
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    if (UseAVX2())
+        nDone = Signed8BitAVX2(pBuffer, nSamples);
+#elif defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    if (UseNeon())
+        nDone = Signed8BitNeon(pBuffer, nSamples);
+#endif
+
+    // adding 128 flips the top bit
+    for (int64 nSample = nDone; nSample < nSamples; nSample++)
+        pBuffer[nSample] ^= 0x80;
+}
+
+/*static*/ void COutputProcessing::ProcessBigEndian(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample)
+{
+    int64 nDone = 0;
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    if (UseAVX2())
+        nDone = SwitchBufferBytesAVX2(pBuffer, nSamples, nBytesPerSample);
+#elif defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    if (UseNeon())
+        nDone = SwitchBufferBytesNeon(pBuffer, nSamples, nBytesPerSample);
+#endif
+
+    SwitchBufferBytes(&pBuffer[nDone * nBytesPerSample], nBytesPerSample, static_cast<int>(nSamples - nDone));
+}
+
+}
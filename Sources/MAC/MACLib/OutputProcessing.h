@@ -0,0 +1,26 @@
+#pragma once
+
+namespace APE
+{
+
+/**************************************************************************************************
+COutputProcessing - the fix-ups GetData(...) applies to decoded data for the file's format (see
+APE_GET_DATA_PROCESSING)
+
+The flags are the format flags being fixed up (APE_FORMAT_FLAG_FLOATING_POINT,
+APE_FORMAT_FLAG_SIGNED_8_BIT and APE_FORMAT_FLAG_BIG_ENDIAN); each step is its own inverse, so
+Unprocess(...) runs them backwards
+**************************************************************************************************/
+class COutputProcessing
+{
+public:
+    static void Process(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample, int nFlags);
+    static void Unprocess(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample, int nFlags);
+
+private:
+    static void ProcessFloat(unsigned char * pBuffer, int64 nSamples);
+    static void ProcessSigned8Bit(unsigned char * pBuffer, int64 nSamples);
+    static void ProcessBigEndian(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample);
+};
+
+}
@@ -0,0 +1,120 @@
+#include "All.h"
+#include "CPUFeatures.h"
+
+#if defined(__AVX2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC)) || defined(APE_TARGET_ATTRIBUTES_X86)
+    #define APE_USE_AVX2_INTRINSICS
+#endif
+
+#ifdef APE_USE_AVX2_INTRINSICS
+    #include <immintrin.h> // AVX2
+#endif
+
+namespace APE
+{
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+
+/**************************************************************************************************
+Output processing with AVX2 (see COutputProcessing)
+
+Each function does whole vectors in place and returns how many samples it did (the scalar code does
+the rest)
+**************************************************************************************************/
+APE_TARGET_AVX2 int64 FloatTransformAVX2(unsigned char * pBuffer, int64 nSamples)
+{
+    int64 nSample = 0;
+
+#ifdef APE_USE_AVX2_INTRINSICS
+    // flip bits 26 to 29, then the bits below the sign of negative values (see CFloatTransform::Process(...))
+    const __m256i avxExponentBits = _mm256_set1_epi32(0x3C000000);
+    const __m256i avxMagnitudeBits = _mm256_set1_epi32(0x7FFFFFFF);
+    for (; nSample + 8 <= nSamples; nSample += 8)
+    {
+        __m256i * pValues = reinterpret_cast<__m256i *>(&pBuffer[nSample * 4]);
+        const __m256i avxValues = _mm256_xor_si256(_mm256_loadu_si256(pValues), avxExponentBits);
+        const __m256i avxNegative = _mm256_and_si256(_mm256_srai_epi32(avxValues, 31), avxMagnitudeBits);
+        _mm256_storeu_si256(pValues, _mm256_xor_si256(avxValues, avxNegative));
+    }
+#else
+    (void) pBuffer; (void) nSamples;
+#endif
+
+    return nSample;
+}
+
+APE_TARGET_AVX2 int64 Signed8BitAVX2(unsigned char * pBuffer, int64 nSamples)
+{
+    int64 nSample = 0;
+
+#ifdef APE_USE_AVX2_INTRINSICS
+    const __m256i avxTopBits = _mm256_set1_epi8(static_cast<char>(0x80));
+    for (; nSample + 32 <= nSamples; nSample += 32)
+    {
+        __m256i * pValues = reinterpret_cast<__m256i *>(&pBuffer[nSample]);
+        _mm256_storeu_si256(pValues, _mm256_xor_si256(_mm256_loadu_si256(pValues), avxTopBits));
+    }
+#else
+    (void) pBuffer; (void) nSamples;
+#endif
+
+    return nSample;
+}
+
+APE_TARGET_AVX2 int64 SwitchBufferBytesAVX2(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample)
+{
+    int64 nSample = 0;
+
+#ifdef APE_USE_AVX2_INTRINSICS
+    if (nBytesPerSample == 2)
+    {
+        const __m256i avxShuffle = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+            1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        for (; nSample + 16 <= nSamples; nSample += 16)
+        {
+            __m256i * pValues = reinterpret_cast<__m256i *>(&pBuffer[nSample * 2]);
+            _mm256_storeu_si256(pValues, _mm256_shuffle_epi8(_mm256_loadu_si256(pValues), avxShuffle));
+        }
+    }
+    else if (nBytesPerSample == 3)
+    {
+        // sixteen samples (48 bytes, so three 16 byte vectors) at a time; samples 5 and 10 straddle two
+        // vectors, so each output vector is put together from the shuffles of its neighbours (a shuffle
+        // index of -1 gives a zero byte); the stores never overlap a later load, which would stall
+        const __m128i sseA0 = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -1);
+        const __m128i sseA1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1);
+        const __m128i sseB0 = _mm_setr_epi8(-1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i sseB1 = _mm_setr_epi8(0, -1, 4, 3, 2, 7, 6, 5, 10, 9, 8, 13, 12, 11, -1, 15);
+        const __m128i sseB2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1);
+        const __m128i sseC1 = _mm_setr_epi8(14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i sseC2 = _mm_setr_epi8(-1, 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10, 15, 14, 13);
+        for (; nSample + 16 <= nSamples; nSample += 16)
+        {
+            __m128i * pValues = reinterpret_cast<__m128i *>(&pBuffer[nSample * 3]);
+            const __m128i sseA = _mm_loadu_si128(&pValues[0]);
+            const __m128i sseB = _mm_loadu_si128(&pValues[1]);
+            const __m128i sseC = _mm_loadu_si128(&pValues[2]);
+            _mm_storeu_si128(&pValues[0], _mm_or_si128(_mm_shuffle_epi8(sseA, sseA0), _mm_shuffle_epi8(sseB, sseA1)));
+            _mm_storeu_si128(&pValues[1], _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(sseA, sseB0), _mm_shuffle_epi8(sseB, sseB1)), _mm_shuffle_epi8(sseC, sseB2)));
+            _mm_storeu_si128(&pValues[2], _mm_or_si128(_mm_shuffle_epi8(sseB, sseC1), _mm_shuffle_epi8(sseC, sseC2)));
+        }
+    }
+    else if (nBytesPerSample == 4)
+    {
+        const __m256i avxShuffle = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        for (; nSample + 8 <= nSamples; nSample += 8)
+        {
+            __m256i * pValues = reinterpret_cast<__m256i *>(&pBuffer[nSample * 4]);
+            _mm256_storeu_si256(pValues, _mm256_shuffle_epi8(_mm256_loadu_si256(pValues), avxShuffle));
+        }
+    }
+#else
+    (void) pBuffer; (void) nSamples; (void) nBytesPerSample;
+#endif
+
+    return nSample;
+}
+
+#endif
+
+}
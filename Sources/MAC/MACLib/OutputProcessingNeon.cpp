@@ -0,0 +1,97 @@
+#include "All.h"
+#include "CPUFeatures.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+    #define APE_USE_NEON_INTRINSICS
+#endif
+
+#ifdef APE_USE_NEON_INTRINSICS
+    #include <arm_neon.h> // Neon
+#endif
+
+namespace APE
+{
+
+#if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64) || defined(_M_ARM64EC)
+
+/**************************************************************************************************
+Output processing with Neon (see COutputProcessing)
+
+Each function does whole vectors in place and returns how many samples it did (the scalar code does
+the rest)
+**************************************************************************************************/
+int64 FloatTransformNeon(unsigned char * pBuffer, int64 nSamples)
+{
+    int64 nSample = 0;
+
+#ifdef APE_USE_NEON_INTRINSICS
+    // flip bits 26 to 29, then the bits below the sign of negative values (see CFloatTransform::Process(...))
+    const uint32x4_t neonExponentBits = vdupq_n_u32(0x3C000000);
+    const uint32x4_t neonMagnitudeBits = vdupq_n_u32(0x7FFFFFFF);
+    for (; nSample + 4 <= nSamples; nSample += 4)
+    {
+        uint32 * pValues = reinterpret_cast<uint32 *>(&pBuffer[nSample * 4]);
+        const uint32x4_t neonValues = veorq_u32(vld1q_u32(pValues), neonExponentBits);
+        const uint32x4_t neonNegative = vandq_u32(vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_u32(neonValues), 31)), neonMagnitudeBits);
+        vst1q_u32(pValues, veorq_u32(neonValues, neonNegative));
+    }
+#else
+    (void) pBuffer; (void) nSamples;
+#endif
+
+    return nSample;
+}
+
+int64 Signed8BitNeon(unsigned char * pBuffer, int64 nSamples)
+{
+    int64 nSample = 0;
+
+#ifdef APE_USE_NEON_INTRINSICS
+    const uint8x16_t neonTopBits = vdupq_n_u8(0x80);
+    for (; nSample + 16 <= nSamples; nSample += 16)
+        vst1q_u8(&pBuffer[nSample], veorq_u8(vld1q_u8(&pBuffer[nSample]), neonTopBits));
+#else
+    (void) pBuffer; (void) nSamples;
+#endif
+
+    return nSample;
+}
+
+int64 SwitchBufferBytesNeon(unsigned char * pBuffer, int64 nSamples, int nBytesPerSample)
+{
+    int64 nSample = 0;
+
+#ifdef APE_USE_NEON_INTRINSICS
+    if (nBytesPerSample == 2)
+    {
+        for (; nSample + 8 <= nSamples; nSample += 8)
+            vst1q_u8(&pBuffer[nSample * 2], vrev16q_u8(vld1q_u8(&pBuffer[nSample * 2])));
+    }
+    else if (nBytesPerSample == 3)
+    {
+        // the structure loads split the bytes of sixteen samples apart, so the first and last are just swapped
+        for (; nSample + 16 <= nSamples; nSample += 16)
+        {
+            const uint8x16x3_t neonValues = vld3q_u8(&pBuffer[nSample * 3]);
+            uint8x16x3_t neonSwapped;
+            neonSwapped.val[0] = neonValues.val[2];
+            neonSwapped.val[1] = neonValues.val[1];
+            neonSwapped.val[2] = neonValues.val[0];
+            vst3q_u8(&pBuffer[nSample * 3], neonSwapped);
+        }
+    }
+    else if (nBytesPerSample == 4)
+    {
+        for (; nSample + 4 <= nSamples; nSample += 4)
+            vst1q_u8(&pBuffer[nSample * 4], vrev32q_u8(vld1q_u8(&pBuffer[nSample * 4])));
+    }
+#else
+    (void) pBuffer; (void) nSamples; (void) nBytesPerSample;
+#endif
+
+    return nSample;
+}
+
+#endif
+
+}
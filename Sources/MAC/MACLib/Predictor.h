@@ -5,6 +5,10 @@ namespace APE
 
 /**************************************************************************************************
 IPredictorCompress - the interface for compressing (predicting) data
+
+A run of values can also be compressed in two stages: CompressPrediction(...) does everything up to
+the stage 3 filters for a value, then CompressFilters(...) runs the filters over the whole run in place
+(for several predictors at once, like the channels of a frame, so their filters can run in lockstep)
 **************************************************************************************************/
 class IPredictorCompress
 {
@@ -13,10 +17,22 @@ public:
 
     virtual int64 CompressValue(int nA, int nB = 0) = 0;
     virtual int Flush() = 0;
+
+    // staged compression (by default everything happens in the prediction stage); the predictors passed
+    // to CompressFilters(...) all have to be the same kind as the one it's called on
+    virtual int64 CompressPrediction(int nA, int nB = 0) { return CompressValue(nA, nB); }
+    virtual void CompressFilters(IPredictorCompress **, int64 **, int, int) { }
 };
 
 /**************************************************************************************************
 IPredictorDecompress - the interface for decompressing (un-predicting) data
+
+A run of values can also be decompressed in two stages: DecompressFilters(...) runs the stage 2
+filters over the whole run in place (they only depend on this channel), then DecompressPrediction(...)
+or DecompressPredictions(...) finishes the values (this is where the other channel comes in)
+
+The filters of several predictors can run at once (like the channels of a frame), so the ones that
+can run in lockstep do; the predictors all have to be the same kind as the one it's called on
 **************************************************************************************************/
 class IPredictorDecompress
 {
@@ -26,6 +42,20 @@ public:
     virtual int DecompressValue(int64 nA, int64 nB = 0) = 0;
     virtual int Flush() = 0;
 
+    // staged decompression (by default everything happens in the prediction stage)
+    virtual void DecompressFilters(int64 *, int) { }
+    virtual void DecompressFilters(IPredictorDecompress ** apPredictors, int64 ** apValues, int nPredictors, int nValues)
+    {
+        for (int z = 0; z < nPredictors; z++)
+            apPredictors[z]->DecompressFilters(apValues[z], nValues);
+    }
+    virtual int DecompressPrediction(int64 nA, int64 nB = 0) { return DecompressValue(nA, nB); }
+    virtual void DecompressPredictions(const int64 * paryInput, int * paryOutput, int nValues)
+    {
+        for (int z = 0; z < nValues; z++)
+            paryOutput[z] = DecompressPrediction(paryInput[z], 0);
+    }
+
     virtual void SetInterimMode(bool) { }
 };
 
@@ -2,6 +2,7 @@
 #include "Prepare.h"
 #include "CRC.h"
 #include "GlobalFunctions.h"
+#include "CPUFeatures.h"
 
 #if APE_BYTE_ORDER == APE_LITTLE_ENDIAN
     #define APE_24_SHIFT_1ST 0
@@ -16,6 +17,19 @@
 namespace APE
 {
 
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    int UnprepareBlocksSSE41(const int * paryValues, int nStride, int nBlocks, int nBitsPerSample, int nChannels, unsigned char * pOutput);
+#endif
+
+CPrepare::CPrepare()
+{
+    // the SIMD code is picked once (the CPU can't change)
+    m_bSSE41 = false;
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    m_bSSE41 = GetSSE41Available() && GetSSE41Supported();
+#endif
+}
+
 int CPrepare::Prepare(const unsigned char * pRawData, int nBytes, const WAVEFORMATEX * pWaveFormatEx, int * pOutput, int nFrameBlocks, unsigned int * pCRC, int * pSpecialCodes)
 {
     // error check the parameters
@@ -851,6 +865,123 @@ void CPrepare::Unprepare(int * paryValues, const WAVEFORMATEX * pWaveFormatEx, u
     }
 }
 
+/**************************************************************************************************
+Unprepare a run of blocks
+
+The format is checked once for the run instead of once per block, and mono and stereo (the formats
+that matter for speed) have a loop for each sample size; everything else goes through Unprepare(...)
+**************************************************************************************************/
+template <int BITS> static __forceinline void UnprepareSample(int nValue, unsigned char * & pOutput)
+{
+    if (BITS == 8)
+    {
+        *pOutput++ = static_cast<unsigned char>(nValue + 128);
+    }
+    else if (BITS == 16)
+    {
+        *reinterpret_cast<int16 *>(pOutput) = static_cast<int16>(nValue);
+        pOutput += 2;
+    }
+    else if (BITS == 24)
+    {
+        uint32 nTemp = 0;
+        if (nValue < 0)
+            nTemp = (static_cast<uint32>((nValue + 0x800000)) | 0x800000);
+        else
+            nTemp = static_cast<uint32>(nValue);
+
+        *pOutput++ = static_cast<unsigned char>((nTemp >> APE_24_SHIFT_1ST) & 0xFF);
+        *pOutput++ = static_cast<unsigned char>((nTemp >> APE_24_SHIFT_2ND) & 0xFF);
+        *pOutput++ = static_cast<unsigned char>((nTemp >> APE_24_SHIFT_3RD) & 0xFF);
+    }
+    else if (BITS == 32)
+    {
+        *reinterpret_cast<int *>(pOutput) = nValue;
+        pOutput += 4;
+    }
+}
+
+template <int BITS, int CHANNELS> static int UnprepareBlocksGeneric(const int * paryValues, int nStride, int nBlocks, unsigned char * pOutput)
+{
+    const int * pX = &paryValues[0];
+    const int * pY = &paryValues[nStride];
+
+    for (int z = 0; z < nBlocks; z++)
+    {
+        if (CHANNELS == 2)
+        {
+            // convert from (x,y) -> (r,l)
+            const int nR = pX[z] - (pY[z] / 2);
+            const int nL = nR + pY[z];
+
+            // error check (for overflows)
+            if ((BITS == 16) && ((nR < -32768) || (nR > 32767) || (nL < -32768) || (nL > 32767)))
+                return z;
+
+            UnprepareSample<BITS>(nR, pOutput);
+            UnprepareSample<BITS>(nL, pOutput);
+        }
+        else
+        {
+            UnprepareSample<BITS>(pX[z], pOutput);
+        }
+    }
+
+    return nBlocks;
+}
+
+int CPrepare::UnprepareBlocks(const int * paryValues, int nStride, int nBlocks, const WAVEFORMATEX * pWaveFormatEx, unsigned char * pOutput)
+{
+    const int nBitsPerSample = pWaveFormatEx->wBitsPerSample;
+    const int nChannels = pWaveFormatEx->nChannels;
+    int nDone = 0;
+
+    if ((nChannels > 2) || (nChannels < 1) || ((nBitsPerSample != 8) && (nBitsPerSample != 16) && (nBitsPerSample != 24) && (nBitsPerSample != 32)))
+    {
+        // a block at a time
+        int aryValues[APE_MAXIMUM_CHANNELS];
+        for (int z = 0; z < nBlocks; z++)
+        {
+            for (int nChannel = 0; nChannel < nChannels; nChannel++)
+                aryValues[nChannel] = paryValues[(nChannel * nStride) + z];
+
+            try
+            {
+                Unprepare(aryValues, pWaveFormatEx, &pOutput[z * pWaveFormatEx->nBlockAlign]);
+            }
+            catch(...)
+            {
+                return z;
+            }
+        }
+        return nBlocks;
+    }
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    // the SIMD code does what it can, and stops short of any block it can't output
+    if (m_bSSE41)
+        nDone = UnprepareBlocksSSE41(paryValues, nStride, nBlocks, nBitsPerSample, nChannels, pOutput);
+#endif
+
+    paryValues = &paryValues[nDone];
+    pOutput = &pOutput[nDone * pWaveFormatEx->nBlockAlign];
+    nBlocks -= nDone;
+
+    switch ((nBitsPerSample * 10) + nChannels)
+    {
+    case 81: nDone += UnprepareBlocksGeneric<8, 1>(paryValues, nStride, nBlocks, pOutput); break;
+    case 82: nDone += UnprepareBlocksGeneric<8, 2>(paryValues, nStride, nBlocks, pOutput); break;
+    case 161: nDone += UnprepareBlocksGeneric<16, 1>(paryValues, nStride, nBlocks, pOutput); break;
+    case 162: nDone += UnprepareBlocksGeneric<16, 2>(paryValues, nStride, nBlocks, pOutput); break;
+    case 241: nDone += UnprepareBlocksGeneric<24, 1>(paryValues, nStride, nBlocks, pOutput); break;
+    case 242: nDone += UnprepareBlocksGeneric<24, 2>(paryValues, nStride, nBlocks, pOutput); break;
+    case 321: nDone += UnprepareBlocksGeneric<32, 1>(paryValues, nStride, nBlocks, pOutput); break;
+    case 322: nDone += UnprepareBlocksGeneric<32, 2>(paryValues, nStride, nBlocks, pOutput); break;
+    }
+
+    return nDone;
+}
+
 #ifdef APE_BACKWARDS_COMPATIBILITY
 
 int CPrepare::UnprepareOld(int * pInputX, int * pInputY, int nBlocks, const WAVEFORMATEX * pWaveFormatEx, unsigned char * pRawData, unsigned int * pCRC, int nFileVersion)
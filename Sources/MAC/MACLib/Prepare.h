@@ -25,11 +25,20 @@ class IPredictorDecompress;
 class CPrepare
 {
 public:
+    CPrepare();
+
     int Prepare(const unsigned char * pRawData, int nBytes, const WAVEFORMATEX * pWaveFormatEx, int * pOutput, int nFrameBlocks, unsigned int * pCRC, int * pSpecialCodes);
     void Unprepare(int * paryValues, const WAVEFORMATEX * pWaveFormatEx, unsigned char * pOutput);
+
+    // unprepare a run of blocks (each channel's values are nStride apart); returns the number of blocks
+    // output, which is less than nBlocks if a block overflows the output format
+    int UnprepareBlocks(const int * paryValues, int nStride, int nBlocks, const WAVEFORMATEX * pWaveFormatEx, unsigned char * pOutput);
 #ifdef APE_BACKWARDS_COMPATIBILITY
     int UnprepareOld(int * pInputX, int * pInputY, int nBlocks, const WAVEFORMATEX * pWaveFormatEx, unsigned char * pRawData, unsigned int * pCRC, int nFileVersion);
 #endif
+
+private:
+    bool m_bSSE41;
 };
 
 }
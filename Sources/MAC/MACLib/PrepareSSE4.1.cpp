@@ -0,0 +1,125 @@
+#include "All.h"
+#include "CPUFeatures.h"
+
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) || defined(APE_TARGET_ATTRIBUTES_X86)
+    #define APE_USE_SSE41_INTRINSICS
+#endif
+
+#ifdef APE_USE_SSE41_INTRINSICS
+    #include <smmintrin.h> // SSE4.1
+#endif
+
+namespace APE
+{
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+
+#ifdef APE_USE_SSE41_INTRINSICS
+
+APE_TARGET_SSE41 static __forceinline void UnprepareStereoSSE41(const int * pX, const int * pY, __m128i & sseR, __m128i & sseL)
+{
+    // convert from (x,y) -> (r,l) (y / 2 rounds towards zero)
+    const __m128i sseX = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pX));
+    const __m128i sseY = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pY));
+    const __m128i sseHalfY = _mm_srai_epi32(_mm_add_epi32(sseY, _mm_srli_epi32(sseY, 31)), 1);
+
+    sseR = _mm_sub_epi32(sseX, sseHalfY);
+    sseL = _mm_add_epi32(sseR, sseY);
+}
+
+APE_TARGET_SSE41 static __forceinline void Store24SSE41(unsigned char * pOutput, __m128i sseValues)
+{
+    // negative values are offset the same way as in CPrepare::Unprepare(...), then the low three bytes
+    // of each value are packed together
+    const __m128i sseOffset = _mm_or_si128(_mm_add_epi32(sseValues, _mm_set1_epi32(0x800000)), _mm_set1_epi32(0x800000));
+    sseValues = _mm_blendv_epi8(sseValues, sseOffset, _mm_cmplt_epi32(sseValues, _mm_setzero_si128()));
+
+    const __m128i ssePacked = _mm_shuffle_epi8(sseValues, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(pOutput), ssePacked);
+    *reinterpret_cast<int *>(&pOutput[8]) = _mm_extract_epi32(ssePacked, 2);
+}
+
+#endif
+
+/**************************************************************************************************
+Unprepare with SSE4.1 (see CPrepare::UnprepareBlocks(...))
+
+This does whole groups of blocks; it returns how many blocks it did, and the scalar code does the rest
+(including a group with a 16-bit overflow, so the error is found at the right block)
+**************************************************************************************************/
+APE_TARGET_SSE41 int UnprepareBlocksSSE41(const int * paryValues, int nStride, int nBlocks, int nBitsPerSample, int nChannels, unsigned char * pOutput)
+{
+    int z = 0;
+
+#ifdef APE_USE_SSE41_INTRINSICS
+    const int * pX = &paryValues[0];
+    const int * pY = &paryValues[nStride];
+
+    if (nChannels == 2)
+    {
+        __m128i sseR, sseL;
+        if (nBitsPerSample == 16)
+        {
+            const __m128i sseMinimum = _mm_set1_epi32(-32768);
+            const __m128i sseMaximum = _mm_set1_epi32(32767);
+            for (; z + 4 <= nBlocks; z += 4)
+            {
+                UnprepareStereoSSE41(&pX[z], &pY[z], sseR, sseL);
+
+                const __m128i sseOverflow = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(sseR, sseMinimum), _mm_cmpgt_epi32(sseR, sseMaximum)),
+                    _mm_or_si128(_mm_cmplt_epi32(sseL, sseMinimum), _mm_cmpgt_epi32(sseL, sseMaximum)));
+                if (!_mm_testz_si128(sseOverflow, sseOverflow))
+                    break;
+
+                const __m128i sseOutput = _mm_packs_epi32(_mm_unpacklo_epi32(sseR, sseL), _mm_unpackhi_epi32(sseR, sseL));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(&pOutput[z * 4]), sseOutput);
+            }
+        }
+        else if (nBitsPerSample == 24)
+        {
+            for (; z + 4 <= nBlocks; z += 4)
+            {
+                UnprepareStereoSSE41(&pX[z], &pY[z], sseR, sseL);
+                Store24SSE41(&pOutput[z * 6], _mm_unpacklo_epi32(sseR, sseL));
+                Store24SSE41(&pOutput[(z * 6) + 12], _mm_unpackhi_epi32(sseR, sseL));
+            }
+        }
+        else if (nBitsPerSample == 32)
+        {
+            for (; z + 4 <= nBlocks; z += 4)
+            {
+                UnprepareStereoSSE41(&pX[z], &pY[z], sseR, sseL);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(&pOutput[z * 8]), _mm_unpacklo_epi32(sseR, sseL));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(&pOutput[(z * 8) + 16]), _mm_unpackhi_epi32(sseR, sseL));
+            }
+        }
+    }
+    else if (nChannels == 1)
+    {
+        if (nBitsPerSample == 16)
+        {
+            for (; z + 8 <= nBlocks; z += 8)
+            {
+                // keep the low 16 bits (like a cast) so the pack doesn't saturate
+                const __m128i sseLow = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pX[z]));
+                const __m128i sseHigh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pX[z + 4]));
+                const __m128i sseOutput = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(sseLow, 16), 16), _mm_srai_epi32(_mm_slli_epi32(sseHigh, 16), 16));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(&pOutput[z * 2]), sseOutput);
+            }
+        }
+        else if (nBitsPerSample == 24)
+        {
+            for (; z + 4 <= nBlocks; z += 4)
+                Store24SSE41(&pOutput[z * 3], _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pX[z])));
+        }
+    }
+#else
+    (void) paryValues; (void) nStride; (void) nBlocks; (void) nBitsPerSample; (void) nChannels; (void) pOutput;
+#endif
+
+    return z;
+}
+
+#endif
+
+}
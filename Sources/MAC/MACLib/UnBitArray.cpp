@@ -1,5 +1,6 @@
 #include "All.h"
 #include "UnBitArray.h"
+#include "GlobalFunctions.h"
 
 namespace APE
 {
@@ -17,16 +18,68 @@ CUnBitArray::CUnBitArray(CIO * pIO, intn nVersion, int64 nFurthestReadByte) :
 
     // initialize
     APE_CLEAR(m_RangeCoderInfo);
+    m_pInput = APE_NULL;
+    m_nInputBits = 0;
+    m_nInputCache = 0;
+    m_nInputCacheBytes = 0;
     CreateHelper(pIO, 16384, nVersion);
-
-    // create the range table for the version we're decoding (no need to create both)
-    m_spRangeTable.Assign(new RangeOverflowTable(RANGE_TOTAL_2));
 }
 
 CUnBitArray::~CUnBitArray()
 {
 }
 
+int CUnBitArray::FillAndResetBitArray(int64 nFileLocation, int64 nNewBitIndex)
+{
+    // go back to reading through the I/O object
+    m_pInput = APE_NULL;
+    m_nInputBits = 0;
+    m_nInputCacheBytes = 0;
+    return CUnBitArrayBase::FillAndResetBitArray(nFileLocation, nNewBitIndex);
+}
+
+bool CUnBitArray::SetInput(const unsigned char * pInput, uint32 nBytes, uint32 nBitIndex)
+{
+    m_pInput = pInput;
+    m_nInputBits = nBytes * 8;
+    m_nInputCacheBytes = 0;
+    m_nCurrentBitIndex = nBitIndex;
+    return true;
+}
+
+uint32 CUnBitArray::DecodeValueXBits(uint32 nBits)
+{
+    if (m_pInput == APE_NULL)
+        return CUnBitArrayBase::DecodeValueXBits(nBits);
+
+    if ((m_nCurrentBitIndex + nBits) >= m_nInputBits)
+        throw(1);
+
+    // read the two words the value can span as one 64-bit value
+    const unsigned char * pWord = &m_pInput[(m_nCurrentBitIndex >> 5) * 4];
+    const uint64 nHigh = static_cast<uint64>(pWord[0]) | (static_cast<uint64>(pWord[1]) << 8) | (static_cast<uint64>(pWord[2]) << 16) | (static_cast<uint64>(pWord[3]) << 24);
+    const uint64 nLow = static_cast<uint64>(pWord[4]) | (static_cast<uint64>(pWord[5]) << 8) | (static_cast<uint64>(pWord[6]) << 16) | (static_cast<uint64>(pWord[7]) << 24);
+    const uint64 nWords = (nHigh << 32) | nLow;
+
+    const uint32 nResult = static_cast<uint32>((nWords << (m_nCurrentBitIndex & 31)) >> (64 - nBits));
+    m_nCurrentBitIndex += nBits;
+    return nResult;
+}
+
+__forceinline void CUnBitArray::FillInputCache()
+{
+    // refill a word at a time instead of reading a byte at a time; this loads the current word and the one
+    // after it (the stream is little-endian words read from the top down) and keeps the bytes from the current
+    // one on at the top (the padding after the input covers reading past its end)
+    const unsigned char * pWord = &m_pInput[(m_nCurrentBitIndex >> 5) * 4];
+    uint32 nHigh, nLow;
+    memcpy(&nHigh, &pWord[0], 4);
+    memcpy(&nLow, &pWord[4], 4);
+    const uint32 nByteIndex = (m_nCurrentBitIndex >> 3) & 3;
+    m_nInputCache = ((static_cast<uint64>(ConvertU32LE(nHigh)) << 32) | ConvertU32LE(nLow)) << (nByteIndex * 8);
+    m_nInputCacheBytes = 8 - nByteIndex;
+}
+
 void CUnBitArray::GenerateArray(int * pOutputArray, int nElements, intn)
 {
     GenerateArrayRange(pOutputArray, nElements);
@@ -36,7 +89,7 @@ uint32 CUnBitArray::RangeDecodeFast(int nShift)
 {
     while (m_RangeCoderInfo.range <= BOTTOM_VALUE)
     {
-        m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | DecodeByte();
+        m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | ReadByte();
         m_RangeCoderInfo.low = (m_RangeCoderInfo.low << 8) | ((m_RangeCoderInfo.buffer >> 1) & 0xFF);
         m_RangeCoderInfo.range <<= 8;
 
@@ -64,7 +117,7 @@ uint32 CUnBitArray::RangeDecodeFastWithUpdate(int nShift)
         }
 
         // read byte and update range
-        m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | DecodeByte();
+        m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | ReadByte();
         m_RangeCoderInfo.low = (m_RangeCoderInfo.low << 8) | ((m_RangeCoderInfo.buffer >> 1) & 0xFF);
         m_RangeCoderInfo.range <<= 8;
     }
@@ -93,7 +146,7 @@ uint32 CUnBitArray::DecodeOverflow(uint32 & nPivotValue)
         throw(ERROR_INVALID_INPUT_FILE);
 
     // lookup the symbol from lookup table
-    uint32 nOverflow = m_spRangeTable->Get(nRangeTotal);
+    uint32 nOverflow = GetRangeOverflow(RANGE_TOTAL_2, RANGE_OVERFLOW_2, nRangeTotal);
 
     // update
     m_RangeCoderInfo.low -= m_RangeCoderInfo.range * RANGE_TOTAL_2[nOverflow];
@@ -111,6 +164,7 @@ uint32 CUnBitArray::DecodeOverflow(uint32 & nPivotValue)
         {
             nPivotValue = OVERFLOW_PIVOT_VALUE;
 
+            CheckInput();
             return DecodeOverflow(nPivotValue);
         }
     }
@@ -122,6 +176,9 @@ int64 CUnBitArray::DecodeValueRange(UNBIT_ARRAY_STATE & BitArrayState)
 {
     int64 nValue = 0;
 
+    // stop if an earlier value ran off the end of the input (the early outs below don't check)
+    CheckInput();
+
     // figure the pivot value
     uint32 nPivotValue = APE_MAX(BitArrayState.nKSum / 32, static_cast<uint32>(1));
 
@@ -144,7 +201,7 @@ int64 CUnBitArray::DecodeValueRange(UNBIT_ARRAY_STATE & BitArrayState)
 
             while (m_RangeCoderInfo.range <= BOTTOM_VALUE)
             {
-                m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | DecodeByte();
+                m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | ReadByte();
                 m_RangeCoderInfo.low = (m_RangeCoderInfo.low << 8) | ((m_RangeCoderInfo.buffer >> 1) & 0xFF);
                 m_RangeCoderInfo.range <<= 8;
             }
@@ -154,7 +211,7 @@ int64 CUnBitArray::DecodeValueRange(UNBIT_ARRAY_STATE & BitArrayState)
 
             while (m_RangeCoderInfo.range <= BOTTOM_VALUE)
             {
-                m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | DecodeByte();
+                m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | ReadByte();
                 m_RangeCoderInfo.low = (m_RangeCoderInfo.low << 8) | ((m_RangeCoderInfo.buffer >> 1) & 0xFF);
                 m_RangeCoderInfo.range <<= 8;
             }
@@ -168,7 +225,7 @@ int64 CUnBitArray::DecodeValueRange(UNBIT_ARRAY_STATE & BitArrayState)
         {
             while (m_RangeCoderInfo.range <= BOTTOM_VALUE)
             {
-                m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | DecodeByte();
+                m_RangeCoderInfo.buffer = (m_RangeCoderInfo.buffer << 8) | ReadByte();
                 m_RangeCoderInfo.low = (m_RangeCoderInfo.low << 8) | ((m_RangeCoderInfo.buffer >> 1) & 0xFF);
                 m_RangeCoderInfo.range <<= 8;
 
@@ -186,6 +243,9 @@ int64 CUnBitArray::DecodeValueRange(UNBIT_ARRAY_STATE & BitArrayState)
         }
     }
 
+    // the value is only good if all of its bytes were there
+    CheckInput();
+
     // build the value
     nValue = static_cast<int64>(nBase) + (static_cast<int64>(nOverflow) * nPivotValue);
 
@@ -202,6 +262,27 @@ int64 CUnBitArray::DecodeValueRange(UNBIT_ARRAY_STATE & BitArrayState)
     return (nValue & 1) ? (nValue >> 1) + 1 : -(nValue >> 1);
 }
 
+void CUnBitArray::DecodeValuesRange(UNBIT_ARRAY_STATE ** paryStates, int64 ** paryOutput, int nChannels, int nBlocks)
+{
+    // the same as the base class, but without a virtual call for every value
+    if (nChannels == 2)
+    {
+        for (int z = 0; z < nBlocks; z++)
+        {
+            paryOutput[0][z] = CUnBitArray::DecodeValueRange(*paryStates[0]);
+            paryOutput[1][z] = CUnBitArray::DecodeValueRange(*paryStates[1]);
+        }
+    }
+    else
+    {
+        for (int z = 0; z < nBlocks; z++)
+        {
+            for (int nChannel = 0; nChannel < nChannels; nChannel++)
+                paryOutput[nChannel][z] = CUnBitArray::DecodeValueRange(*paryStates[nChannel]);
+        }
+    }
+}
+
 void CUnBitArray::FlushState(UNBIT_ARRAY_STATE & BitArrayState)
 {
     BitArrayState.k = 10;
@@ -215,10 +296,16 @@ void CUnBitArray::FlushBitArray()
     m_RangeCoderInfo.buffer = DecodeValueXBits(8);
     m_RangeCoderInfo.low = m_RangeCoderInfo.buffer >> (8 - EXTRA_BITS);
     m_RangeCoderInfo.range = static_cast<unsigned int>(1 << EXTRA_BITS);
+
+    // the range decoding reads from here on
+    m_nInputCacheBytes = 0;
 }
 
 void CUnBitArray::Finalize()
 {
+    // anything read ahead is skipped along with the rest
+    m_nInputCacheBytes = 0;
+
     // normalize
     while (m_RangeCoderInfo.range <= BOTTOM_VALUE)
     {
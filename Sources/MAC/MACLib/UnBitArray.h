@@ -17,18 +17,53 @@ public:
     CUnBitArray(APE::CIO * pIO, intn nVersion, int64 nFurthestReadByte);
     ~CUnBitArray();
 
+    int FillAndResetBitArray(int64 nFileLocation = -1, int64 nNewBitIndex = 0) APE_OVERRIDE;
+    bool SetInput(const unsigned char * pInput, uint32 nBytes, uint32 nBitIndex) APE_OVERRIDE;
+
     void GenerateArray(int * pOutputArray, int nElements, intn nBytesRequired) APE_OVERRIDE;
     int64 DecodeValueRange(UNBIT_ARRAY_STATE & BitArrayState) APE_OVERRIDE;
+    void DecodeValuesRange(UNBIT_ARRAY_STATE ** paryStates, int64 ** paryOutput, int nChannels, int nBlocks) APE_OVERRIDE;
     void FlushState(UNBIT_ARRAY_STATE & BitArrayState) APE_OVERRIDE;
     void FlushBitArray() APE_OVERRIDE;
     void Finalize() APE_OVERRIDE;
 
+protected:
+    uint32 DecodeValueXBits(uint32 nBits) APE_OVERRIDE;
+
 private:
     // data
-    CSmartPtr<RangeOverflowTable> m_spRangeTable;
     RANGE_CODER_STRUCT_DECOMPRESS m_RangeCoderInfo;
+    const unsigned char * m_pInput;
+    uint32 m_nInputBits;
+    uint64 m_nInputCache;
+    uint32 m_nInputCacheBytes;
 
     // functions
+    __forceinline uint32 ReadByte()
+    {
+        // the bytes come from a cache that's refilled a word at a time
+        if (m_pInput != APE_NULL)
+        {
+            if (m_nInputCacheBytes == 0)
+                FillInputCache();
+
+            const uint32 nByte = static_cast<uint32>(m_nInputCache >> 56);
+            m_nInputCache <<= 8;
+            m_nInputCacheBytes--;
+            m_nCurrentBitIndex += 8;
+            return nByte;
+        }
+        return DecodeByte();
+    }
+
+    __forceinline void CheckInput() const
+    {
+        // the same as running out of data in the I/O object (the padding covers the value that got us here)
+        if ((m_pInput != APE_NULL) && (m_nCurrentBitIndex >= m_nInputBits))
+            throw(1);
+    }
+
+    void FillInputCache();
     uint32 DecodeOverflow(uint32 & nPivotValue);
     uint32 RangeDecodeFast(int nShift);
     uint32 RangeDecodeFastWithUpdate(int nShift);
@@ -63,25 +63,6 @@ CUnBitArrayBase * CreateUnBitArray(IAPEDecompress * pAPEDecompress, CIO * pIO, i
 #endif
 }
 
-/**************************************************************************************************
-RangeOverflowTable
-**************************************************************************************************/
-RangeOverflowTable::RangeOverflowTable(const uint32 * RANGE_TOTAL)
-{
-    uint8 nOverflow = 0;
-    for (uint32 z = 0; z < 65536; z++)
-    {
-        if (z >= RANGE_TOTAL[nOverflow + 1])
-            nOverflow++;
-
-        m_aryTable[z] = nOverflow;
-    }
-}
-
-RangeOverflowTable::~RangeOverflowTable()
-{
-}
-
 /**************************************************************************************************
 CUnBitArrayBase
 **************************************************************************************************/
@@ -135,6 +116,16 @@ bool CUnBitArrayBase::EnsureBitsAvailable(uint32 nBits, bool bThrowExceptionOnFa
     return bResult;
 }
 
+void CUnBitArrayBase::DecodeValuesRange(UNBIT_ARRAY_STATE ** paryStates, int64 ** paryOutput, int nChannels, int nBlocks)
+{
+    // each block stores a value for every channel (in the order given)
+    for (int z = 0; z < nBlocks; z++)
+    {
+        for (int nChannel = 0; nChannel < nChannels; nChannel++)
+            paryOutput[nChannel][z] = DecodeValueRange(*paryStates[nChannel]);
+    }
+}
+
 uint32 CUnBitArrayBase::DecodeValueXBits(uint32 nBits)
 {
     // get more data if necessary
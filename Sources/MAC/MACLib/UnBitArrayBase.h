@@ -21,12 +21,19 @@ Defines
 
 #define MODEL_ELEMENTS 64
 
+// bytes past the end of a frame that must be readable when a bit array decodes straight from memory
+#define UNBIT_ARRAY_PADDING_BYTES 64
+
 const uint32 RANGE_TOTAL_1[65] = { 0,14824,28224,39348,47855,53994,58171,60926,62682,63786,64463,64878,65126,65276,65365,65419,65450,65469,65480,65487,65491,65493,65494,65495,65496,65497,65498,65499,65500,65501,65502,65503,65504,65505,65506,65507,65508,65509,65510,65511,65512,65513,65514,65515,65516,65517,65518,65519,65520,65521,65522,65523,65524,65525,65526,65527,65528,65529,65530,65531,65532,65533,65534,65535,65536 };
 const uint32 RANGE_WIDTH_1[64] = { 14824,13400,11124,8507,6139,4177,2755,1756,1104,677,415,248,150,89,54,31,19,11,7,4,2,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1 };
 
 const uint32 RANGE_TOTAL_2[65] = { 0,19578,36160,48417,56323,60899,63265,64435,64971,65232,65351,65416,65447,65466,65476,65482,65485,65488,65490,65491,65492,65493,65494,65495,65496,65497,65498,65499,65500,65501,65502,65503,65504,65505,65506,65507,65508,65509,65510,65511,65512,65513,65514,65515,65516,65517,65518,65519,65520,65521,65522,65523,65524,65525,65526,65527,65528,65529,65530,65531,65532,65533,65534,65535,65536 };
 const uint32 RANGE_WIDTH_2[64] = { 19578,16582,12257,7906,4576,2366,1170,536,261,119,65,31,19,10,6,3,3,2,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1 };
 
+// the first symbol in each block of 256 range totals (see GetRangeOverflow(...))
+const uint8 RANGE_OVERFLOW_1[256] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,6,6,6,6,6,6,6,6,6,6,7,7,7,7,7,7,7,8,8,8,8,8,9,9,10,10,11,13 };
+const uint8 RANGE_OVERFLOW_2[256] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,5,5,5,5,5,5,5,5,5,5,6,6,6,6,7,7,8,9 };
+
 /**************************************************************************************************
 UNBIT_ARRAY_STATE
 **************************************************************************************************/
@@ -64,7 +71,12 @@ public:
     virtual void AdvanceToByteBoundary();
     virtual bool EnsureBitsAvailable(uint32 nBits, bool bThrowExceptionOnFailure);
 
+    // decode straight from memory instead of through the I/O object (returns false if not supported)
+    // UNBIT_ARRAY_PADDING_BYTES past the end of the input must be readable
+    virtual bool SetInput(const unsigned char *, uint32, uint32) { return false; }
+
     virtual int64 DecodeValueRange(UNBIT_ARRAY_STATE &) { return 0; }
+    virtual void DecodeValuesRange(UNBIT_ARRAY_STATE ** paryStates, int64 ** paryOutput, int nChannels, int nBlocks);
     virtual void FlushState(UNBIT_ARRAY_STATE &) { }
     virtual void FlushBitArray() { }
     virtual void Finalize() { }
@@ -101,19 +113,18 @@ protected:
 };
 
 /**************************************************************************************************
-RangeOverflowTable
+GetRangeOverflow - the symbol a range total falls in
+
+The table gets us to the right block of 256 totals, and only the narrow symbols near the top share
+a block, so the search almost never takes a step
 **************************************************************************************************/
-class RangeOverflowTable
+__forceinline uint32 GetRangeOverflow(const uint32 * RANGE_TOTAL, const uint8 * RANGE_OVERFLOW, uint32 nRangeTotal)
 {
-public:
-    RangeOverflowTable(const uint32* RANGE_TOTAL);
-    ~RangeOverflowTable();
-
-    __forceinline uint8 Get(uint32 nIndex) const { return m_aryTable[nIndex]; }
-
-private:
-    uint8 m_aryTable[65536];
-};
+    uint32 nOverflow = RANGE_OVERFLOW[nRangeTotal >> 8];
+    while (nRangeTotal >= RANGE_TOTAL[nOverflow + 1])
+        nOverflow++;
+    return nOverflow;
+}
 
 /**************************************************************************************************
 RANGE_CODER_STRUCT_DECOMPRESS
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef PLATFORM_WINDOWS
+#   include <windows.h>
+#   include <winnt.h>
+#endif
+
+namespace APE
+{
+
+/**************************************************************************************************
+CAtomicFlag - a flag that one thread sets and another thread polls (without taking a lock)
+**************************************************************************************************/
+class CAtomicFlag
+{
+public:
+    CAtomicFlag()
+    {
+        m_nValue = 0;
+    }
+
+    void Set(bool bValue)
+    {
+#ifdef PLATFORM_WINDOWS
+        InterlockedExchange(&m_nValue, bValue ? 1 : 0);
+#else
+        __atomic_store_n(&m_nValue, bValue ? 1 : 0, __ATOMIC_RELEASE);
+#endif
+    }
+
+    bool Get() const
+    {
+#ifdef PLATFORM_WINDOWS
+        return (InterlockedCompareExchange(const_cast<volatile LONG *>(&m_nValue), 0, 0) != 0);
+#else
+        return (__atomic_load_n(&m_nValue, __ATOMIC_ACQUIRE) != 0);
+#endif
+    }
+
+private:
+#ifdef PLATFORM_WINDOWS
+    volatile LONG m_nValue;
+#else
+    int m_nValue;
+#endif
+};
+
+}
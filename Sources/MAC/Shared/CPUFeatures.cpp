@@ -10,6 +10,12 @@
         #ifndef HWCAP_NEON
             #define HWCAP_NEON (1 << 12)
         #endif
+    #elif defined(__aarch64__)
+        #include <asm/hwcap.h>
+
+        #ifndef HWCAP_CRC32
+            #define HWCAP_CRC32 (1 << 7)
+        #endif
     #elif defined(__riscv)
         #include <asm/hwcap.h>
 
@@ -63,10 +69,39 @@
     #define CPUID_AVX512_MASK     0x40030000
 #endif
 
+#if !(defined(__PCLMUL__) && defined(__SSE4_1__))
+    #define CPUID_PCLMUL_LEVEL    1
+    #define CPUID_PCLMUL_REGISTER 2
+    #define CPUID_PCLMUL_MASK     0x00000002
+#endif
+
+#if !(defined(__VPCLMULQDQ__) && defined(__AVX512DQ__) && defined(__AVX512BW__))
+    #define CPUID_VPCLMUL_LEVEL    7
+    #define CPUID_VPCLMUL_REGISTER 2
+    #define CPUID_VPCLMUL_MASK     0x00000400
+#endif
+
+#if defined(PLATFORM_WINDOWS) && !defined(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE)
+    #define PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE 31
+#endif
+
+#if !(defined(__AVXVNNI__) && defined(__AVX2__))
+    #define CPUID_AVXVNNI_LEVEL       7
+    #define CPUID_AVXVNNI_SUBLEAF     1
+    #define CPUID_AVXVNNI_REGISTER    0
+    #define CPUID_AVXVNNI_MASK        0x00000010
+#endif
+
+#if !(defined(__AVX512VNNI__) && defined(__AVX512DQ__) && defined(__AVX512BW__))
+    #define CPUID_AVX512VNNI_LEVEL    7
+    #define CPUID_AVX512VNNI_REGISTER 2
+    #define CPUID_AVX512VNNI_MASK     0x00000800
+#endif
+
 namespace APE
 {
 
-static bool GetCPUInfo(uint32 * cpuInfo, int level)
+static bool GetCPUInfo(uint32 * cpuInfo, int level, int subleaf = 0)
 {
 #if defined(MSVC_CPUID)
     int levelInfo[4] = { 0, 0, 0, 0 };
@@ -74,15 +109,15 @@ static bool GetCPUInfo(uint32 * cpuInfo, int level)
     if (levelInfo[0] < level)
         return false;
 
-    __cpuid(reinterpret_cast<int *>(cpuInfo), level);
+    __cpuidex(reinterpret_cast<int *>(cpuInfo), level, subleaf);
     return true;
 #elif defined(GNUC_CPUID)
-    if(__get_cpuid_count(level, 0, &cpuInfo[0], &cpuInfo[1], &cpuInfo[2], &cpuInfo[3]) == 0)
+    if(__get_cpuid_count(static_cast<unsigned int>(level), static_cast<unsigned int>(subleaf), &cpuInfo[0], &cpuInfo[1], &cpuInfo[2], &cpuInfo[3]) == 0)
         return false;
 
     return true;
 #else
-    (void) cpuInfo; (void) level;
+    (void) cpuInfo; (void) level; (void) subleaf;
     return false;
 #endif
 }
@@ -182,6 +217,86 @@ bool GetAVX512Supported()
 #endif
 }
 
+bool GetAVXVNNISupported()
+{
+#if defined(__AVXVNNI__) && defined(__AVX2__)
+    return true;
+#else
+    // the YMM state is checked with AVX2
+    if (!GetAVX2Supported())
+        return false;
+
+    unsigned int cpuInfo[4] = { 0, 0, 0, 0 };
+    if (!GetCPUInfo(cpuInfo, CPUID_AVXVNNI_LEVEL, CPUID_AVXVNNI_SUBLEAF))
+        return false;
+
+    if ((cpuInfo[CPUID_AVXVNNI_REGISTER] & CPUID_AVXVNNI_MASK) == CPUID_AVXVNNI_MASK)
+        return true;
+
+    return false;
+#endif
+}
+
+bool GetAVX512VNNISupported()
+{
+#if defined(__AVX512VNNI__) && defined(__AVX512DQ__) && defined(__AVX512BW__)
+    return true;
+#else
+    // the ZMM state is checked with AVX-512
+    if (!GetAVX512Supported())
+        return false;
+
+    unsigned int cpuInfo[4] = { 0, 0, 0, 0 };
+    if (!GetCPUInfo(cpuInfo, CPUID_AVX512VNNI_LEVEL))
+        return false;
+
+    if ((cpuInfo[CPUID_AVX512VNNI_REGISTER] & CPUID_AVX512VNNI_MASK) == CPUID_AVX512VNNI_MASK)
+        return true;
+
+    return false;
+#endif
+}
+
+bool GetPCLMULSupported()
+{
+#if defined(__PCLMUL__) && defined(__SSE4_1__)
+    return true;
+#else
+    // the folding also uses SSE4.1
+    if (!GetSSE41Supported())
+        return false;
+
+    unsigned int cpuInfo[4] = { 0, 0, 0, 0 };
+    if (!GetCPUInfo(cpuInfo, CPUID_PCLMUL_LEVEL))
+        return false;
+
+    if ((cpuInfo[CPUID_PCLMUL_REGISTER] & CPUID_PCLMUL_MASK) == CPUID_PCLMUL_MASK)
+        return true;
+
+    return false;
+#endif
+}
+
+bool GetVPCLMULSupported()
+{
+#if defined(__VPCLMULQDQ__) && defined(__AVX512DQ__) && defined(__AVX512BW__) && defined(__PCLMUL__) && defined(__SSE4_1__)
+    return true;
+#else
+    // the ZMM state is checked with AVX-512, and the folding finishes with PCLMULQDQ
+    if (!GetAVX512Supported() || !GetPCLMULSupported())
+        return false;
+
+    unsigned int cpuInfo[4] = { 0, 0, 0, 0 };
+    if (!GetCPUInfo(cpuInfo, CPUID_VPCLMUL_LEVEL))
+        return false;
+
+    if ((cpuInfo[CPUID_VPCLMUL_REGISTER] & CPUID_VPCLMUL_MASK) == CPUID_VPCLMUL_MASK)
+        return true;
+
+    return false;
+#endif
+}
+
 bool GetNeonSupported()
 {
 #if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__) || defined(_M_ARM64) || defined(_M_ARM64EC)
@@ -193,6 +308,21 @@ bool GetNeonSupported()
 #endif
 }
 
+bool GetARMCRC32Supported()
+{
+#if defined(__ARM_FEATURE_CRC32)
+    return true;
+#elif defined(__aarch64__) && defined(PLATFORM_LINUX)
+    return getauxval(AT_HWCAP) & HWCAP_CRC32;
+#elif defined(__aarch64__) && defined(PLATFORM_APPLE)
+    return true; // every 64-bit Apple CPU has them
+#elif (defined(_M_ARM64) || defined(_M_ARM64EC)) && defined(PLATFORM_WINDOWS)
+    return IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE) != 0;
+#else
+    return false;
+#endif
+}
+
 bool GetRVVSupported()
 {
 #if defined(__riscv_v)
@@ -1,5 +1,64 @@
 #pragma once
 
+/**************************************************************************************************
+Function target attributes
+
+GCC and Clang only allow intrinsics for instruction sets enabled on the command line, unless the
+function using them is given a target attribute; this lets a baseline build carry the SIMD code
+and leaves the choice to the runtime tests below (MSVC allows any intrinsic, so these are empty)
+**************************************************************************************************/
+#if (defined(__i386__) || defined(__x86_64__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+    #define APE_TARGET_ATTRIBUTES_X86
+    #define APE_TARGET_SSE2   __attribute__((target("sse2")))
+    #define APE_TARGET_SSE41  __attribute__((target("sse4.1")))
+    #define APE_TARGET_AVX2   __attribute__((target("avx2")))
+    #define APE_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq")))
+    #define APE_TARGET_PCLMUL __attribute__((target("sse4.1,pclmul")))
+
+    // VNNI needs a newer compiler (the AVX-VNNI header came with GCC 11 and Clang 12), and so does
+    // VPCLMULQDQ (GCC 8 and Clang 6)
+    #if defined(__has_include)
+        #if __has_include(<avxvnniintrin.h>)
+            #define APE_TARGET_ATTRIBUTES_X86_VNNI
+        #endif
+        #if __has_include(<vpclmulqdqintrin.h>)
+            #define APE_TARGET_ATTRIBUTES_X86_VPCLMUL
+        #endif
+    #endif
+#else
+    #define APE_TARGET_SSE2
+    #define APE_TARGET_SSE41
+    #define APE_TARGET_AVX2
+    #define APE_TARGET_AVX512
+    #define APE_TARGET_PCLMUL
+#endif
+
+#ifdef APE_TARGET_ATTRIBUTES_X86_VNNI
+    #define APE_TARGET_AVXVNNI    __attribute__((target("avx2,avxvnni")))
+    #define APE_TARGET_AVX512VNNI __attribute__((target("avx512f,avx512bw,avx512dq,avx512vnni")))
+#else
+    #define APE_TARGET_AVXVNNI
+    #define APE_TARGET_AVX512VNNI
+#endif
+
+#ifdef APE_TARGET_ATTRIBUTES_X86_VPCLMUL
+    #define APE_TARGET_VPCLMUL __attribute__((target("avx512f,avx512bw,avx512dq,vpclmulqdq,sse4.1,pclmul")))
+#else
+    #define APE_TARGET_VPCLMUL
+#endif
+
+// the ARMv8 CRC32 instructions are optional on 64-bit ARM
+#if defined(__aarch64__) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 6))
+    #define APE_TARGET_ATTRIBUTES_ARM_CRC32
+    #if defined(__clang__)
+        #define APE_TARGET_ARM_CRC32 __attribute__((target("crc")))
+    #else
+        #define APE_TARGET_ARM_CRC32 __attribute__((target("+crc")))
+    #endif
+#else
+    #define APE_TARGET_ARM_CRC32
+#endif
+
 namespace APE
 {
 
@@ -10,8 +69,13 @@ bool GetSSE2Available();
 bool GetSSE41Available();
 bool GetAVX2Available();
 bool GetAVX512Available();
+bool GetAVXVNNIAvailable();
+bool GetAVX512VNNIAvailable();
+bool GetPCLMULAvailable();
+bool GetVPCLMULAvailable();
 
 bool GetNeonAvailable();
+bool GetARMCRC32Available();
 
 bool GetRVVAvailable();
 
@@ -24,8 +88,13 @@ bool GetSSE2Supported();
 bool GetSSE41Supported();
 bool GetAVX2Supported();
 bool GetAVX512Supported();
+bool GetAVXVNNISupported();
+bool GetAVX512VNNISupported();
+bool GetPCLMULSupported();
+bool GetVPCLMULSupported();
 
 bool GetNeonSupported();
+bool GetARMCRC32Supported();
 
 bool GetRVVSupported();
 
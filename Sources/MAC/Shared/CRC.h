@@ -1,13 +1,13 @@
 #pragma once
 
-// If target platform supports hardware optimized CRC32 calculation, define the following:
-//
-// 1) ARMv8 with CRC32 instructions:
-//#define ENABLE_ARM_CRC32_OPT
-
 namespace APE
 {
 
+// updates a CRC-32 (polynomial 0x04C11DB7) with a table, or with carry-less multiplication on x86 or
+// the CRC32 instructions on ARMv8 when the CPU has them (checked at runtime)
 uint32 CRC_update(uint32 crc, const unsigned char * pData, int nBytes);
 
+// updates a CRC-32 with native endian samples as if they were stored little endian
+uint32 CRC_update_samples(uint32 crc, const unsigned char * pData, int nBytesPerSample, int nSamples);
+
 }
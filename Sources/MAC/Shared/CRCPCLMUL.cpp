@@ -0,0 +1,211 @@
+#include "All.h"
+#include "CRC.h"
+#include "CPUFeatures.h"
+
+#if (defined(__PCLMUL__) && defined(__SSE4_1__)) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) || defined(APE_TARGET_ATTRIBUTES_X86)
+    #define APE_USE_PCLMUL_INTRINSICS
+#endif
+
+#if (defined(__VPCLMULQDQ__) && defined(__AVX512DQ__) && defined(__AVX512BW__) && defined(__PCLMUL__) && defined(__SSE4_1__)) || (defined(_MSC_VER) && (_MSC_VER >= 1920) && (defined(_M_IX86) || defined(_M_X64)) && !defined(_M_ARM64EC)) || defined(APE_TARGET_ATTRIBUTES_X86_VPCLMUL)
+    #define APE_USE_VPCLMUL_INTRINSICS
+#endif
+
+#ifdef APE_USE_PCLMUL_INTRINSICS
+    #include <smmintrin.h> // SSE4.1
+    #include <wmmintrin.h> // PCLMULQDQ
+#endif
+
+#ifdef APE_USE_VPCLMUL_INTRINSICS
+    #include <immintrin.h> // AVX-512 and VPCLMULQDQ
+#endif
+
+namespace APE
+{
+
+bool GetPCLMULAvailable()
+{
+#ifdef APE_USE_PCLMUL_INTRINSICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool GetVPCLMULAvailable()
+{
+#ifdef APE_USE_VPCLMUL_INTRINSICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+
+#ifdef APE_USE_PCLMUL_INTRINSICS
+
+// multiply both halves of the value by the two constants and fold the products into the next data
+APE_TARGET_PCLMUL static __forceinline __m128i FoldPCLMUL(__m128i sseValue, __m128i sseConstants, __m128i sseData)
+{
+    const __m128i sseLow = _mm_clmulepi64_si128(sseValue, sseConstants, 0x00);
+    const __m128i sseHigh = _mm_clmulepi64_si128(sseValue, sseConstants, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(sseLow, sseHigh), sseData);
+}
+
+// folds four 16 byte lanes into one, then the rest of the data (a multiple of 16 bytes), then reduces to 32 bits
+APE_TARGET_PCLMUL static __forceinline uint32 FinishPCLMUL(__m128i sse1, __m128i sse2, __m128i sse3, __m128i sse4, const unsigned char * pData, int nBytes)
+{
+    // the constants are powers of x mod P(x), bit reflected
+    const __m128i sseK3K4 = _mm_setr_epi32(0x751997D0, 0x00000001, static_cast<int>(0xCCAA009E), 0x00000000); // to fold over 16 bytes
+    const __m128i sseK5 = _mm_setr_epi32(0x63CD6124, 0x00000001, 0x00000000, 0x00000000); // to fold 64 bits to 32
+    const __m128i ssePoly = _mm_setr_epi32(static_cast<int>(0xDB710641), 0x00000001, static_cast<int>(0xF7011641), 0x00000001); // P(x) and the Barrett constant
+    const __m128i sseMask32 = _mm_setr_epi32(-1, 0, -1, 0);
+
+    // fold the four lanes into one
+    sse1 = FoldPCLMUL(sse1, sseK3K4, sse2);
+    sse1 = FoldPCLMUL(sse1, sseK3K4, sse3);
+    sse1 = FoldPCLMUL(sse1, sseK3K4, sse4);
+
+    // fold 16 bytes at a time
+    while (nBytes >= 16)
+    {
+        sse1 = FoldPCLMUL(sse1, sseK3K4, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pData)));
+        pData += 16;
+        nBytes -= 16;
+    }
+
+    // fold 128 bits to 64 bits
+    __m128i sseTemp = _mm_clmulepi64_si128(sse1, sseK3K4, 0x10);
+    sse1 = _mm_xor_si128(_mm_srli_si128(sse1, 8), sseTemp);
+
+    sseTemp = _mm_srli_si128(sse1, 4);
+    sse1 = _mm_clmulepi64_si128(_mm_and_si128(sse1, sseMask32), sseK5, 0x00);
+    sse1 = _mm_xor_si128(sse1, sseTemp);
+
+    // Barrett reduction to 32 bits
+    sseTemp = _mm_clmulepi64_si128(_mm_and_si128(sse1, sseMask32), ssePoly, 0x10);
+    sseTemp = _mm_clmulepi64_si128(_mm_and_si128(sseTemp, sseMask32), ssePoly, 0x00);
+    sse1 = _mm_xor_si128(sse1, sseTemp);
+
+    return static_cast<uint32>(_mm_extract_epi32(sse1, 1));
+}
+
+#endif
+
+#ifdef APE_USE_VPCLMUL_INTRINSICS
+
+// the same fold on four 16 byte lanes at once
+APE_TARGET_VPCLMUL static __forceinline __m512i FoldVPCLMUL(__m512i avxValue, __m512i avxConstants, __m512i avxData)
+{
+    const __m512i avxLow = _mm512_clmulepi64_epi128(avxValue, avxConstants, 0x00);
+    const __m512i avxHigh = _mm512_clmulepi64_epi128(avxValue, avxConstants, 0x11);
+    return _mm512_ternarylogic_epi64(avxLow, avxHigh, avxData, 0x96); // a ^ b ^ c
+}
+
+#endif
+
+/**************************************************************************************************
+CRC with carry-less multiplication
+
+This is the folding method from Intel's "Fast CRC Computation for Generic Polynomials Using
+PCLMULQDQ Instruction" for the bit reflected polynomial 0x04C11DB7 (the one the table in CRC.cpp
+is for); four 16 byte lanes are folded 64 bytes at a time, then into one lane, then reduced to 32
+bits with a Barrett reduction
+
+The number of bytes must be a multiple of 16 and at least 64 (CRC_update(...) does the rest)
+**************************************************************************************************/
+APE_TARGET_PCLMUL uint32 CRC_update_PCLMUL(uint32 crc, const unsigned char * pData, int nBytes)
+{
+#ifdef APE_USE_PCLMUL_INTRINSICS
+    // the constants are powers of x mod P(x), bit reflected
+    const __m128i sseK1K2 = _mm_setr_epi32(0x54442BD4, 0x00000001, static_cast<int>(0xC6E41596), 0x00000001); // to fold over 64 bytes
+
+    // load the first 64 bytes (with the CRC so far)
+    __m128i sse1 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&pData[0])), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i sse2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pData[16]));
+    __m128i sse3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pData[32]));
+    __m128i sse4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pData[48]));
+    pData += 64;
+    nBytes -= 64;
+
+    // fold 64 bytes at a time
+    while (nBytes >= 64)
+    {
+        sse1 = FoldPCLMUL(sse1, sseK1K2, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pData[0])));
+        sse2 = FoldPCLMUL(sse2, sseK1K2, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pData[16])));
+        sse3 = FoldPCLMUL(sse3, sseK1K2, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pData[32])));
+        sse4 = FoldPCLMUL(sse4, sseK1K2, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pData[48])));
+        pData += 64;
+        nBytes -= 64;
+    }
+
+    return FinishPCLMUL(sse1, sse2, sse3, sse4, pData, nBytes);
+#else
+    (void) pData; (void) nBytes;
+    return crc;
+#endif
+}
+
+/**************************************************************************************************
+CRC with 512-bit carry-less multiplication
+
+The same folding with VPCLMULQDQ, which multiplies four 16 byte lanes in one instruction; four
+64 byte registers are folded 256 bytes at a time, then into one register, which is folded 64
+bytes at a time before its lanes go through the end of the 128-bit folding
+
+The number of bytes must be a multiple of 16 and at least 256 (CRC_update(...) does the rest)
+**************************************************************************************************/
+APE_TARGET_VPCLMUL uint32 CRC_update_VPCLMUL(uint32 crc, const unsigned char * pData, int nBytes)
+{
+#ifdef APE_USE_VPCLMUL_INTRINSICS
+    // the constants are powers of x mod P(x), bit reflected, in every lane
+    const __m512i avxK256 = _mm512_setr4_epi32(0x1542778A, 0x00000001, 0x322D1430, 0x00000001); // to fold over 256 bytes
+    const __m512i avxK64 = _mm512_setr4_epi32(0x54442BD4, 0x00000001, static_cast<int>(0xC6E41596), 0x00000001); // to fold over 64 bytes
+
+    // load the first 256 bytes (with the CRC so far)
+    __m512i avx1 = _mm512_xor_si512(_mm512_loadu_si512(&pData[0]), _mm512_maskz_set1_epi32(1, static_cast<int>(crc)));
+    __m512i avx2 = _mm512_loadu_si512(&pData[64]);
+    __m512i avx3 = _mm512_loadu_si512(&pData[128]);
+    __m512i avx4 = _mm512_loadu_si512(&pData[192]);
+    pData += 256;
+    nBytes -= 256;
+
+    // fold 256 bytes at a time
+    while (nBytes >= 256)
+    {
+        avx1 = FoldVPCLMUL(avx1, avxK256, _mm512_loadu_si512(&pData[0]));
+        avx2 = FoldVPCLMUL(avx2, avxK256, _mm512_loadu_si512(&pData[64]));
+        avx3 = FoldVPCLMUL(avx3, avxK256, _mm512_loadu_si512(&pData[128]));
+        avx4 = FoldVPCLMUL(avx4, avxK256, _mm512_loadu_si512(&pData[192]));
+        pData += 256;
+        nBytes -= 256;
+    }
+
+    // fold the four registers into one, then 64 bytes at a time
+    avx1 = FoldVPCLMUL(avx1, avxK64, avx2);
+    avx1 = FoldVPCLMUL(avx1, avxK64, avx3);
+    avx1 = FoldVPCLMUL(avx1, avxK64, avx4);
+    while (nBytes >= 64)
+    {
+        avx1 = FoldVPCLMUL(avx1, avxK64, _mm512_loadu_si512(pData));
+        pData += 64;
+        nBytes -= 64;
+    }
+
+    // the lanes are four 16 byte lanes like the 128-bit folding has at the end of its loop (the zero-masking
+    // extract keeps GCC's "undefined" pass-through out of it)
+    const uint32 nCRC = FinishPCLMUL(_mm512_maskz_extracti32x4_epi32(0xF, avx1, 0), _mm512_maskz_extracti32x4_epi32(0xF, avx1, 1),
+        _mm512_maskz_extracti32x4_epi32(0xF, avx1, 2), _mm512_maskz_extracti32x4_epi32(0xF, avx1, 3), pData, nBytes);
+
+    _mm256_zeroupper();
+
+    return nCRC;
+#else
+    (void) pData; (void) nBytes;
+    return crc;
+#endif
+}
+
+#endif
+
+}
@@ -1,7 +1,6 @@
 #include "All.h"
 #include "CircleBuffer.h"
 #include "CRC.h"
-#include "GlobalFunctions.h"
 
 namespace APE
 {
@@ -48,20 +47,10 @@ uint32 CCircleBuffer::UpdateCRC(uint32 nCRC, uint32 nBytesPerBlock, uint32 nBloc
     const uint32 nFrontBytes = APE_MIN(m_nTail, nBlocks * nBytesPerBlock);
     const uint32 nHeadBytes = nBlocks * nBytesPerBlock - nFrontBytes;
 
-#if APE_BYTE_ORDER == APE_BIG_ENDIAN
-    SwitchBufferBytes(&m_spBuffer[m_nEndCap - nHeadBytes], nBytesPerBlock, nHeadBytes / nBytesPerBlock);
-    SwitchBufferBytes(&m_spBuffer[m_nTail - nFrontBytes], nBytesPerBlock, nFrontBytes / nBytesPerBlock);
-#endif
-
     if (nHeadBytes > 0)
-        nCRC = CRC_update(nCRC, &m_spBuffer[m_nEndCap - nHeadBytes], static_cast<int>(nHeadBytes));
-
-    nCRC = CRC_update(nCRC, &m_spBuffer[m_nTail - nFrontBytes], static_cast<int>(nFrontBytes));
+        nCRC = CRC_update_samples(nCRC, &m_spBuffer[m_nEndCap - nHeadBytes], static_cast<int>(nBytesPerBlock), static_cast<int>(nHeadBytes / nBytesPerBlock));
 
-#if APE_BYTE_ORDER == APE_BIG_ENDIAN
-    SwitchBufferBytes(&m_spBuffer[m_nEndCap - nHeadBytes], nBytesPerBlock, nHeadBytes / nBytesPerBlock);
-    SwitchBufferBytes(&m_spBuffer[m_nTail - nFrontBytes], nBytesPerBlock, nFrontBytes / nBytesPerBlock);
-#endif
+    nCRC = CRC_update_samples(nCRC, &m_spBuffer[m_nTail - nFrontBytes], static_cast<int>(nBytesPerBlock), static_cast<int>(nFrontBytes / nBytesPerBlock));
 
     return nCRC;
 }
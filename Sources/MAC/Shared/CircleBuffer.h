@@ -16,6 +16,7 @@ public:
     // query
     uint32 MaxAdd() const;
     uint32 MaxGet() const;
+    uint32 GetMaxDirectWriteBytes() const { return m_nMaxDirectWriteBytes; }
 
     // direct writing
     __forceinline unsigned char * GetDirectWritePointer()
@@ -38,6 +39,12 @@ public:
         }
     }
 
+    // direct reading (the data from the head to the end cap or tail is contiguous)
+    __forceinline unsigned char * GetDirectReadPointer()
+    {
+        return &m_spBuffer[m_nHead];
+    }
+
     // update CRC for last nBytes bytes
     uint32 UpdateCRC(uint32 nCRC, uint32 nBytesPerBlock, uint32 nBlocks);
 
@@ -0,0 +1,222 @@
+#include "All.h"
+#include "MappedFileIO.h"
+#include "CharacterHelper.h"
+
+#ifndef PLATFORM_WINDOWS
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace APE
+{
+
+static int64 s_nMappedFileThreshold = -1;
+
+int64 CMappedFileIO::SetThreshold(int64 nBytes)
+{
+    const int64 nOldThreshold = s_nMappedFileThreshold;
+    s_nMappedFileThreshold = APE_MAX(nBytes, -1);
+    return nOldThreshold;
+}
+
+int64 CMappedFileIO::GetThreshold()
+{
+    return s_nMappedFileThreshold;
+}
+
+CMappedFileIO::CMappedFileIO()
+{
+    APE_CLEAR(m_cFileName);
+    m_pData = APE_NULL;
+    m_nSize = 0;
+    m_nPosition = 0;
+#ifdef PLATFORM_WINDOWS
+    m_hFile = INVALID_HANDLE_VALUE;
+    m_hMapping = APE_NULL;
+#endif
+}
+
+CMappedFileIO::~CMappedFileIO()
+{
+    Close();
+}
+
+int CMappedFileIO::Open(const wchar_t * pName, bool)
+{
+    Close();
+
+    if (wcslen(pName) >= APE_MAX_PATH)
+        return ERROR_UNDEFINED;
+
+    // pipes can't be mapped
+    if ((wcscmp(pName, L"-") == 0) || (wcscmp(pName, L"/dev/stdin") == 0))
+        return ERROR_UNDEFINED;
+
+#ifdef PLATFORM_WINDOWS
+    m_hFile = ::CreateFileW(pName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, APE_NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, APE_NULL);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return ERROR_INVALID_INPUT_FILE;
+
+    LARGE_INTEGER nFileSize;
+    if (!GetFileSizeEx(m_hFile, &nFileSize) || (nFileSize.QuadPart <= 0) || (static_cast<uint64>(nFileSize.QuadPart) != static_cast<size_t>(nFileSize.QuadPart)))
+    {
+        Close();
+        return ERROR_UNDEFINED;
+    }
+
+    m_hMapping = ::CreateFileMappingW(m_hFile, APE_NULL, PAGE_READONLY, 0, 0, APE_NULL);
+    if (m_hMapping != APE_NULL)
+        m_pData = static_cast<unsigned char *>(::MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_pData == APE_NULL)
+    {
+        Close();
+        return ERROR_UNDEFINED;
+    }
+
+    m_nSize = nFileSize.QuadPart;
+#else
+    CSmartPtr<char> spFilenameUTF8(reinterpret_cast<char *>(CAPECharacterHelper::GetUTF8FromUTF16(pName)), true);
+    const int nFile = open(spFilenameUTF8, O_RDONLY | O_CLOEXEC);
+    if (nFile < 0)
+        return ERROR_INVALID_INPUT_FILE;
+
+    // the mapping holds on to the file, so the descriptor isn't needed once it's made
+    struct stat Stat;
+    void * pData = MAP_FAILED;
+    if ((fstat(nFile, &Stat) == 0) && (Stat.st_size > 0) && (static_cast<uint64>(Stat.st_size) == static_cast<size_t>(Stat.st_size)))
+        pData = mmap(APE_NULL, static_cast<size_t>(Stat.st_size), PROT_READ, MAP_SHARED, nFile, 0);
+    close(nFile);
+
+    if (pData == MAP_FAILED)
+        return ERROR_UNDEFINED;
+
+    m_pData = static_cast<unsigned char *>(pData);
+    m_nSize = static_cast<int64>(Stat.st_size);
+
+    // we mostly stream through the file
+    madvise(m_pData, static_cast<size_t>(m_nSize), MADV_SEQUENTIAL);
+#endif
+
+    m_nPosition = 0;
+    wcscpy(m_cFileName, pName);
+
+    return ERROR_SUCCESS;
+}
+
+int CMappedFileIO::Close()
+{
+    const int nResult = (m_pData != APE_NULL) ? ERROR_SUCCESS : ERROR_UNDEFINED;
+
+#ifdef PLATFORM_WINDOWS
+    if (m_pData != APE_NULL)
+        ::UnmapViewOfFile(m_pData);
+    if (m_hMapping != APE_NULL)
+        ::CloseHandle(m_hMapping);
+    APE_SAFE_FILE_CLOSE(m_hFile)
+    m_hMapping = APE_NULL;
+#else
+    if (m_pData != APE_NULL)
+        munmap(m_pData, static_cast<size_t>(m_nSize));
+#endif
+
+    m_pData = APE_NULL;
+    m_nSize = 0;
+    m_nPosition = 0;
+
+    return nResult;
+}
+
+int CMappedFileIO::Read(void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead)
+{
+    RETURN_ON_ERROR(ReadAt(m_nPosition, pBuffer, nBytesToRead, pBytesRead))
+    m_nPosition += *pBytesRead;
+    return ERROR_SUCCESS;
+}
+
+int CMappedFileIO::Write(const void *, unsigned int, unsigned int * pBytesWritten)
+{
+    *pBytesWritten = 0;
+    return ERROR_IO_WRITE;
+}
+
+int CMappedFileIO::ReadAt(int64 nPosition, void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead)
+{
+    *pBytesRead = 0;
+    if ((m_pData == APE_NULL) || (nPosition < 0) || (nPosition > m_nSize))
+        return ERROR_IO_READ;
+
+    *pBytesRead = static_cast<unsigned int>(APE_MIN(static_cast<int64>(nBytesToRead), m_nSize - nPosition));
+    memcpy(pBuffer, &m_pData[nPosition], *pBytesRead);
+    return ERROR_SUCCESS;
+}
+
+unsigned char * CMappedFileIO::GetDirectReadPointer(int64 nPosition, unsigned int nBytes)
+{
+    if ((m_pData == APE_NULL) || (nPosition < 0) || (nPosition + nBytes > m_nSize))
+        return APE_NULL;
+
+    // the caller is about to use the range, so ask for it to be paged in ahead of time
+#ifdef PLATFORM_WINDOWS
+    #if _WIN32_WINNT >= 0x602
+        WIN32_MEMORY_RANGE_ENTRY Range;
+        Range.VirtualAddress = &m_pData[nPosition];
+        Range.NumberOfBytes = nBytes;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+    #endif
+#else
+    const int64 nPageBytes = static_cast<int64>(sysconf(_SC_PAGESIZE));
+    const int64 nStart = (nPageBytes > 0) ? (nPosition - (nPosition % nPageBytes)) : nPosition;
+    madvise(&m_pData[nStart], static_cast<size_t>(nPosition + nBytes - nStart), MADV_WILLNEED);
+#endif
+
+    return &m_pData[nPosition];
+}
+
+int CMappedFileIO::Seek(int64 nPosition, SeekMethod nMethod)
+{
+    if (nMethod == SeekFileCurrent)
+        nPosition += m_nPosition;
+    else if (nMethod == SeekFileEnd)
+        nPosition = m_nSize - ((nPosition < 0) ? -nPosition : nPosition);
+
+    if ((nPosition < 0) || (nPosition > m_nSize))
+        return ERROR_UNDEFINED;
+
+    m_nPosition = nPosition;
+    return ERROR_SUCCESS;
+}
+
+int CMappedFileIO::SetEOF()
+{
+    return ERROR_UNDEFINED;
+}
+
+int CMappedFileIO::Create(const wchar_t *)
+{
+    return ERROR_UNDEFINED;
+}
+
+int CMappedFileIO::Delete()
+{
+    return ERROR_UNDEFINED;
+}
+
+int64 CMappedFileIO::GetPosition()
+{
+    return m_nPosition;
+}
+
+int64 CMappedFileIO::GetSize()
+{
+    return m_nSize;
+}
+
+int CMappedFileIO::GetName(wchar_t * pBuffer)
+{
+    wcscpy(pBuffer, m_cFileName);
+    return ERROR_SUCCESS;
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "IO.h"
+
+namespace APE
+{
+
+/**************************************************************************************************
+CMappedFileIO - read-only access to a file through a memory map
+
+The whole file is mapped, so frames can be decoded in place (see GetDirectReadPointer(...)) without
+being copied out of the page cache first, and without reading a large file up front
+
+Mapping is opt-in (see SetMappedFileThreshold(...)) because a mapped file has to stay the same while
+it's open: if another process truncates it, touching the pages past the new end raises SIGBUS on
+POSIX (or an access violation on Windows) instead of returning a read error
+**************************************************************************************************/
+class CMappedFileIO : public CIO
+{
+public:
+    // files this size or larger are mapped when they're read whole (-1, the default, never maps them);
+    // set it before opening files; returns the previous threshold
+    static int64 SetThreshold(int64 nBytes);
+    static int64 GetThreshold();
+
+    // construction / destruction
+    CMappedFileIO();
+    ~CMappedFileIO();
+
+    // open / close
+    int Open(const wchar_t * pName, bool bOpenReadOnly = false) APE_OVERRIDE;
+    int Close() APE_OVERRIDE;
+
+    // read / write
+    int Read(void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead) APE_OVERRIDE;
+    int Write(const void * pBuffer, unsigned int nBytesToWrite, unsigned int * pBytesWritten) APE_OVERRIDE;
+    int ReadAt(int64 nPosition, void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead) APE_OVERRIDE;
+    unsigned char * GetDirectReadPointer(int64 nPosition, unsigned int nBytes) APE_OVERRIDE;
+
+    // seek
+    int Seek(int64 nPosition, SeekMethod nMethod) APE_OVERRIDE;
+
+    // other functions
+    int SetEOF() APE_OVERRIDE;
+    unsigned char * GetBuffer(int *) APE_OVERRIDE { return APE_NULL; }
+
+    // creation / destruction
+    int Create(const wchar_t * pName) APE_OVERRIDE;
+    int Delete() APE_OVERRIDE;
+
+    // attributes
+    int64 GetPosition() APE_OVERRIDE;
+    int64 GetSize() APE_OVERRIDE;
+    int GetName(wchar_t * pBuffer) APE_OVERRIDE;
+
+private:
+    wchar_t m_cFileName[APE_MAX_PATH];
+    unsigned char * m_pData;
+    int64 m_nSize;
+    int64 m_nPosition;
+#ifdef PLATFORM_WINDOWS
+    HANDLE m_hFile;
+    HANDLE m_hMapping;
+#endif
+};
+
+}
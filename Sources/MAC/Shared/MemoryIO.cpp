@@ -37,6 +37,25 @@ int CMemoryIO::Read(void * pBuffer, unsigned int nBytesToRead, unsigned int * pB
     return ERROR_SUCCESS;
 }
 
+int CMemoryIO::ReadAt(int64 nPosition, void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead)
+{
+    *pBytesRead = 0;
+    if ((nPosition < 0) || (nPosition > m_nBufferBytes))
+        return ERROR_IO_READ;
+
+    *pBytesRead = APE_MIN(nBytesToRead, static_cast<unsigned int>(m_nBufferBytes - nPosition));
+    memcpy(pBuffer, m_pBuffer + nPosition, *pBytesRead);
+    return ERROR_SUCCESS;
+}
+
+unsigned char * CMemoryIO::GetDirectReadPointer(int64 nPosition, unsigned int nBytes)
+{
+    if ((nPosition < 0) || (nPosition + nBytes > m_nBufferBytes))
+        return APE_NULL;
+
+    return m_pBuffer + nPosition;
+}
+
 int CMemoryIO::Write(const void * pBuffer, unsigned int nBytesToWrite, unsigned int * pBytesWritten)
 {
     *pBytesWritten = APE_MIN(nBytesToWrite, static_cast<unsigned int>(m_nBufferBytes - m_nPosition));
@@ -83,6 +102,14 @@ unsigned char * CMemoryIO::GetBuffer(int * pnBufferBytes)
     return m_pBuffer;
 }
 
+void CMemoryIO::SetBuffer(unsigned char * pBuffer, int nBufferBytes)
+{
+    m_pBuffer = pBuffer;
+    m_nBufferBytes = nBufferBytes;
+
+    m_nPosition = 0;
+}
+
 int64 CMemoryIO::GetPosition()
 {
     return m_nPosition;
@@ -5,13 +5,16 @@ namespace APE
 
 /**************************************************************************************************
 CRollBuffer
+
+The window (how many elements can be added between rolls) is WINDOW_ELEMENTS unless a larger one is
+asked for; a roll copies the whole history, so a long history wants a long window
 **************************************************************************************************/
 template <class TYPE, int WINDOW_ELEMENTS> class CRollBuffer
 {
 public:
-    CRollBuffer(int nHistoryElements)
+    CRollBuffer(int nHistoryElements, int nWindowElements = WINDOW_ELEMENTS)
     : m_nHistoryElements(nHistoryElements),
-      m_nTotalElements(WINDOW_ELEMENTS + m_nHistoryElements)
+      m_nTotalElements(APE_MAX(nWindowElements, WINDOW_ELEMENTS) + m_nHistoryElements)
     {
         m_pData = new TYPE [static_cast<size_t>(m_nTotalElements)];
         Flush();
@@ -46,6 +49,12 @@ public:
         m_pCurrent++;
     }
 
+    // how many more times IncrementFast() can be called before a Roll() is needed
+    __forceinline int GetRollElements() const
+    {
+        return static_cast<int>(&m_pData[m_nTotalElements] - m_pCurrent);
+    }
+
     __forceinline TYPE & operator[](const int nIndex) const
     {
         return m_pCurrent[nIndex];
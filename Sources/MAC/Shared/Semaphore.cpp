@@ -4,16 +4,20 @@
 namespace APE
 {
 
-CSemaphore::CSemaphore(int count)
+CSemaphore::CSemaphore(int count, int maximum)
 {
+    // the maximum defaults to the initial count
+    if (maximum <= 0)
+        maximum = count;
+
 #ifdef PLATFORM_WINDOWS
-    m_hSemaphore = CreateSemaphore(APE_NULL, count, count, APE_NULL);
+    m_hSemaphore = CreateSemaphore(APE_NULL, count, maximum, APE_NULL);
 #else
     m_pMutex = new pthread_mutex_t;
     m_pCondition = new pthread_cond_t;
 
     m_nCount = count;
-    m_nMax = count;
+    m_nMax = maximum;
 
     int result = pthread_mutex_init(m_pMutex, APE_NULL);
 
@@ -13,7 +13,7 @@ namespace APE
 class CSemaphore
 {
 public:
-    CSemaphore(int count);
+    CSemaphore(int count, int maximum = 0);
     ~CSemaphore();
 
     bool Wait();
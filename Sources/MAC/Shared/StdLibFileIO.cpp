@@ -192,6 +192,36 @@ int CStdLibFileIO::Read(void * pBuffer, unsigned int nBytesToRead, unsigned int
     else return ferror(m_pFile) ? ERROR_IO_READ : ERROR_SUCCESS;
 }
 
+int CStdLibFileIO::ReadAt(int64 nPosition, void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead)
+{
+    *pBytesRead = 0;
+
+    // a pipe can't be read out of order
+    if ((m_pFile == APE_NULL) || m_bPipe)
+        return ERROR_UNDEFINED;
+
+    // pread(...) leaves the file position (and the stdio buffer) alone
+    const int nFile = FILENO(m_pFile);
+    unsigned char * pOutput = static_cast<unsigned char *>(pBuffer);
+    while (*pBytesRead < nBytesToRead)
+    {
+        const ssize_t nRead = pread(nFile, &pOutput[*pBytesRead], nBytesToRead - *pBytesRead, static_cast<off_t>(nPosition + *pBytesRead));
+        if (nRead < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return ERROR_IO_READ;
+        }
+        if (nRead == 0)
+            break;
+
+        *pBytesRead += static_cast<unsigned int>(nRead);
+    }
+
+    if ((*pBytesRead == 0) && (nBytesToRead > 0)) return ERROR_IO_READ;
+    else return ERROR_SUCCESS;
+}
+
 int CStdLibFileIO::Write(const void * pBuffer, unsigned  int nBytesToWrite, unsigned int * pBytesWritten)
 {
     *pBytesWritten = (unsigned int) fwrite(pBuffer, 1, nBytesToWrite, m_pFile);
@@ -21,6 +21,7 @@ public:
     // read / write
     int Read(void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead);
     int Write(const void * pBuffer, unsigned int nBytesToWrite, unsigned int * pBytesWritten);
+    int ReadAt(int64 nPosition, void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead);
 
     // seek
     int Seek(int64 nPosition, SeekMethod nMethod);
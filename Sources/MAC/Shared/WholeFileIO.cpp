@@ -97,6 +97,27 @@ int CWholeFileIO::Read(void * pBuffer, unsigned int nBytesToRead, unsigned int *
     return bRetVal ? ERROR_SUCCESS : ERROR_IO_READ;
 }
 
+int CWholeFileIO::ReadAt(int64 nPosition, void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead)
+{
+    *pBytesRead = 0;
+    if ((nPosition < 0) || (nPosition > GetSize()))
+        return ERROR_IO_READ;
+
+    nBytesToRead = static_cast<unsigned int>(APE_MIN(static_cast<int64>(nBytesToRead), GetSize() - nPosition));
+    memcpy(pBuffer, &m_spWholeFile[nPosition], nBytesToRead);
+    *pBytesRead = nBytesToRead;
+
+    return ERROR_SUCCESS;
+}
+
+unsigned char * CWholeFileIO::GetDirectReadPointer(int64 nPosition, unsigned int nBytes)
+{
+    if ((nPosition < 0) || (nPosition + nBytes > GetSize()))
+        return APE_NULL;
+
+    return &m_spWholeFile[nPosition];
+}
+
 int CWholeFileIO::Write(const void * , unsigned int , unsigned int *)
 {
     return ERROR_IO_WRITE;
@@ -19,6 +19,8 @@ public:
     // read / write
     int Read(void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead) APE_OVERRIDE;
     int Write(const void * pBuffer, unsigned int nBytesToWrite, unsigned int * pBytesWritten) APE_OVERRIDE;
+    int ReadAt(int64 nPosition, void * pBuffer, unsigned int nBytesToRead, unsigned int * pBytesRead) APE_OVERRIDE;
+    unsigned char * GetDirectReadPointer(int64 nPosition, unsigned int nBytes) APE_OVERRIDE;
 
     // seek
     int Seek(int64 nPosition, SeekMethod nMethod) APE_OVERRIDE;
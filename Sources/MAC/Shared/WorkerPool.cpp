@@ -0,0 +1,226 @@
+#include "All.h"
+#include "WorkerPool.h"
+
+namespace APE
+{
+
+/**************************************************************************************************
+CWorkerPoolTask
+**************************************************************************************************/
+CWorkerPoolTask::CWorkerPoolTask()
+: m_semIdle(1)
+{
+    m_pNextTask = APE_NULL;
+}
+
+CWorkerPoolTask::~CWorkerPoolTask()
+{
+}
+
+void CWorkerPoolTask::WaitForTask()
+{
+    m_semIdle.Wait();
+    m_semIdle.Post();
+}
+
+/**************************************************************************************************
+CWorkerPool
+**************************************************************************************************/
+CWorkerPool::CWorkerPool()
+: m_semLock(1), m_semTasks(0, 0x7FFFFFFF)
+{
+    APE_CLEAR(m_aryQueues);
+    m_nThreads = 0;
+    m_nNextQueue = 0;
+    m_bExit = false;
+}
+
+CWorkerPool::~CWorkerPool()
+{
+    // wake every thread, so it exits
+    m_semLock.Wait();
+    m_bExit = true;
+    m_semLock.Post();
+
+    for (int i = 0; i < m_nThreads; i++)
+        m_semTasks.Post();
+
+    for (int i = 0; i < m_nThreads; i++)
+        m_spThreads[i].Delete();
+}
+
+CWorkerPool & CWorkerPool::GetInstance()
+{
+    static CWorkerPool s_WorkerPool;
+    return s_WorkerPool;
+}
+
+CWorkerPool * CWorkerPool::GetShared()
+{
+    CWorkerPool & WorkerPool = GetInstance();
+    return (WorkerPool.GetThreads() > 0) ? &WorkerPool : APE_NULL;
+}
+
+int CWorkerPool::SetSharedThreads(int nThreads)
+{
+    return GetInstance().AddThreads(APE_CAP(nThreads, 0, APE_MAXIMUM_THREADS));
+}
+
+int CWorkerPool::AddThreads(int nThreads)
+{
+    // the pool only grows since encoders and decoders may already be using it
+    m_semLock.Wait();
+    while (m_nThreads < nThreads)
+    {
+        m_spThreads[m_nThreads].Assign(new CWorkerPoolThread(this, m_nThreads));
+        m_spThreads[m_nThreads]->Start();
+        m_nThreads++;
+    }
+    const int nResult = m_nThreads;
+    m_semLock.Post();
+
+    return nResult;
+}
+
+int CWorkerPool::GetThreads()
+{
+    // AddThreads(...) can grow the pool from another thread
+    m_semLock.Wait();
+    const int nThreads = m_nThreads;
+    m_semLock.Post();
+
+    return nThreads;
+}
+
+void CWorkerPool::Submit(CWorkerPoolTask * pTask)
+{
+    // mark the task as busy (this also waits out a previous run of the same task)
+    pTask->m_semIdle.Wait();
+    pTask->m_pNextTask = APE_NULL;
+
+    // spread the tasks over the thread queues
+    m_semLock.Wait();
+    TASK_QUEUE & Queue = m_aryQueues[m_nNextQueue];
+    m_nNextQueue = (m_nNextQueue + 1) % m_nThreads;
+
+    if (Queue.pTail != APE_NULL)
+        Queue.pTail->m_pNextTask = pTask;
+    else
+        Queue.pHead = pTask;
+    Queue.pTail = pTask;
+    m_semLock.Post();
+
+    m_semTasks.Post();
+}
+
+void CWorkerPool::WaitForTask(CWorkerPoolTask * pTask)
+{
+    // run the task here if it's still queued (its count on m_semTasks just wakes a thread that finds nothing)
+    if (RemoveTask(pTask))
+    {
+        pTask->RunTask();
+        pTask->m_semIdle.Post();
+    }
+    else
+    {
+        pTask->WaitForTask();
+    }
+}
+
+bool CWorkerPool::RemoveTask(CWorkerPoolTask * pTask)
+{
+    bool bRemoved = false;
+
+    m_semLock.Wait();
+
+    for (int i = 0; (i < m_nThreads) && !bRemoved; i++)
+    {
+        TASK_QUEUE & Queue = m_aryQueues[i];
+        CWorkerPoolTask * pPrevious = APE_NULL;
+        for (CWorkerPoolTask * pQueued = Queue.pHead; pQueued != APE_NULL; pQueued = pQueued->m_pNextTask)
+        {
+            if (pQueued == pTask)
+            {
+                if (pPrevious != APE_NULL)
+                    pPrevious->m_pNextTask = pTask->m_pNextTask;
+                else
+                    Queue.pHead = pTask->m_pNextTask;
+                if (Queue.pTail == pTask)
+                    Queue.pTail = pPrevious;
+
+                bRemoved = true;
+                break;
+            }
+            pPrevious = pQueued;
+        }
+    }
+
+    m_semLock.Post();
+
+    return bRemoved;
+}
+
+CWorkerPoolTask * CWorkerPool::TakeTask(int nIndex)
+{
+    CWorkerPoolTask * pTask = APE_NULL;
+
+    m_semLock.Wait();
+
+    // take from our own queue first, then steal the oldest task from the other threads
+    for (int i = 0; (i < m_nThreads) && (pTask == APE_NULL); i++)
+    {
+        TASK_QUEUE & Queue = m_aryQueues[(nIndex + i) % m_nThreads];
+        if (Queue.pHead != APE_NULL)
+        {
+            pTask = Queue.pHead;
+            Queue.pHead = pTask->m_pNextTask;
+            if (Queue.pHead == APE_NULL)
+                Queue.pTail = APE_NULL;
+        }
+    }
+
+    m_semLock.Post();
+
+    return pTask;
+}
+
+/**************************************************************************************************
+CWorkerPoolThread
+**************************************************************************************************/
+CWorkerPool::CWorkerPoolThread::CWorkerPoolThread(CWorkerPool * pPool, int nIndex)
+{
+    m_pPool = pPool;
+    m_nIndex = nIndex;
+}
+
+CWorkerPool::CWorkerPoolThread::~CWorkerPoolThread()
+{
+    Wait();
+}
+
+void CWorkerPool::CWorkerPoolThread::Run()
+{
+    while (true)
+    {
+        // there's one count for every task submitted (or one per thread when exiting)
+        m_pPool->m_semTasks.Wait();
+
+        m_pPool->m_semLock.Wait();
+        const bool bExit = m_pPool->m_bExit;
+        m_pPool->m_semLock.Post();
+        if (bExit)
+            break;
+
+        // (the task may have been taken back by WaitForTask(...))
+        CWorkerPoolTask * pTask = m_pPool->TakeTask(m_nIndex);
+        if (pTask == APE_NULL)
+            continue;
+
+        pTask->RunTask();
+
+        // the task may be deleted as soon as it's idle, so don't touch it after this
+        pTask->m_semIdle.Post();
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Thread.h"
+#include "Semaphore.h"
+
+namespace APE
+{
+
+class CWorkerPool;
+
+/**************************************************************************************************
+CWorkerPoolTask - a unit of work (a frame to encode or decode) that can run on the worker pool
+**************************************************************************************************/
+class CWorkerPoolTask
+{
+public:
+    CWorkerPoolTask();
+    virtual ~CWorkerPoolTask();
+
+    // blocks until the task is no longer queued or running
+    void WaitForTask();
+
+protected:
+    virtual void RunTask() = 0;
+
+private:
+    friend class CWorkerPool;
+
+    CSemaphore m_semIdle;
+    CWorkerPoolTask * m_pNextTask;
+};
+
+/**************************************************************************************************
+CWorkerPool - a process-wide pool of threads shared by every encoder and decoder
+
+Each thread has its own queue of tasks, and a thread that runs out of work steals the oldest task
+from the other queues, so a fixed thread budget serves any number of streams
+
+The pool is opt-in (see SetSharedWorkerPoolThreads(...)); until it's enabled, encoders and
+decoders start their own threads like they always have
+**************************************************************************************************/
+class CWorkerPool
+{
+public:
+    // the shared pool (APE_NULL if it hasn't been enabled)
+    static CWorkerPool * GetShared();
+
+    // enable the shared pool (or grow it); returns the number of threads in the pool
+    static int SetSharedThreads(int nThreads);
+
+    void Submit(CWorkerPoolTask * pTask);
+    int GetThreads();
+
+    // waits for a submitted task, running it on the calling thread if no pool thread has taken it yet
+    // (so a task can wait for tasks it submitted without deadlocking a busy pool)
+    void WaitForTask(CWorkerPoolTask * pTask);
+
+private:
+    CWorkerPool();
+    ~CWorkerPool();
+
+    class CWorkerPoolThread : public CThread
+    {
+    public:
+        CWorkerPoolThread(CWorkerPool * pPool, int nIndex);
+        ~CWorkerPoolThread();
+
+    protected:
+        void Run();
+
+        CWorkerPool * m_pPool;
+        int m_nIndex;
+    };
+
+    struct TASK_QUEUE
+    {
+        CWorkerPoolTask * pHead;
+        CWorkerPoolTask * pTail;
+    };
+
+    static CWorkerPool & GetInstance();
+    int AddThreads(int nThreads);
+    CWorkerPoolTask * TakeTask(int nIndex);
+    bool RemoveTask(CWorkerPoolTask * pTask);
+
+    CSemaphore m_semLock;
+    CSemaphore m_semTasks;
+    TASK_QUEUE m_aryQueues[APE_MAXIMUM_THREADS];
+    CSmartPtr<CWorkerPoolThread> m_spThreads[APE_MAXIMUM_THREADS];
+    int m_nThreads;
+    int m_nNextQueue;
+    bool m_bExit;
+};
+
+}
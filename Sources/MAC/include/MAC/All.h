@@ -324,6 +324,11 @@ Channels
 #define APE_MINIMUM_CHANNELS 1
 #define APE_MAXIMUM_CHANNELS 32
 
+/**************************************************************************************************
+Threads
+**************************************************************************************************/
+#define APE_MAXIMUM_THREADS 256
+
 /**************************************************************************************************
 Macros
 **************************************************************************************************/
@@ -27,6 +27,15 @@ public:
     // seek
     virtual int Seek(int64 nPosition, SeekMethod nMethod) = 0;
 
+    // positional read (reads from an offset without using or moving the file position, so it's safe to
+    // call from several threads at once); returns ERROR_UNDEFINED if the object doesn't support it,
+    // in which case the caller has to fall back to Seek(...) and Read(...)
+    virtual int ReadAt(int64, void *, unsigned int, unsigned int * pBytesRead) { *pBytesRead = 0; return ERROR_UNDEFINED; }
+
+    // direct access (a pointer to a range of the file that stays valid while the object is open, or
+    // APE_NULL if the object doesn't hold the whole range in memory)
+    virtual unsigned char * GetDirectReadPointer(int64, unsigned int) { return APE_NULL; }
+
     // creation / destruction
     virtual int Create(const wchar_t * pName) = 0;
     virtual int Delete() = 0;
@@ -76,6 +76,18 @@ Defines
 #define APE_COMPRESSION_LEVEL_EXTRA_HIGH    4000
 #define APE_COMPRESSION_LEVEL_INSANE        5000
 
+#define APE_DECODE_MODE_INTERLEAVED         0           // each block goes through every stage of decoding in turn (the default)
+#define APE_DECODE_MODE_STAGED              1           // each stage of decoding runs over thousands of blocks at a time
+#define APE_DECODE_MODE_PARALLEL_CHANNELS   2           // staged, with the channels' NN filters running on separate threads
+
+#define APE_ENCODE_MODE_INTERLEAVED         0           // each block is predicted and range coded in turn (the default)
+#define APE_ENCODE_MODE_PARALLEL_CHANNELS   1           // the channels are predicted on separate threads, then range coded in order
+
+#define APE_SAMPLE_FORMAT_INT16             1           // 16-bit integers (deeper files lose their low bits)
+#define APE_SAMPLE_FORMAT_INT24_IN_INT32    2           // 32-bit integers holding 24-bit values (-8388608 to 8388607)
+#define APE_SAMPLE_FORMAT_INT32             3           // 32-bit integers at full scale
+#define APE_SAMPLE_FORMAT_FLOAT32           4           // 32-bit floats from -1 to 1 (floating point files are output as they are)
+
 #define APE_FORMAT_FLAG_8_BIT               (1 << 0)    // is 8-bit [OBSOLETE]
 #define APE_FORMAT_FLAG_CRC                 (1 << 1)    // uses the new CRC32 error detection [OBSOLETE]
 #define APE_FORMAT_FLAG_HAS_PEAK_LEVEL      (1 << 2)    // uint32 nPeakLevel after the header [OBSOLETE]
@@ -282,6 +294,7 @@ public:
         APE_DECOMPRESS_CURRENT_BITRATE = 2004,      // current bitrate [ignored, ignored]
         APE_DECOMPRESS_AVERAGE_BITRATE = 2005,      // average bitrate (works with ranges) [ignored, ignored]
         APE_DECOMPRESS_CURRENT_FRAME = 2006,        // current frame
+        APE_DECOMPRESS_SEEK_MICROSECONDS = 2007,    // microseconds from the last Seek(...) until the first frame after it was decoded (0 if not measured yet) [ignored, ignored]
 
         APE_INTERNAL_INFO = 3000,                   // for internal use -- don't use (returns APE_FILE_INFO *) [ignored, ignored]
     };
@@ -312,6 +325,32 @@ public:
     };
     virtual int GetData(unsigned char * pBuffer, int64 nBlocks, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) = 0;
 
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    // GetDataEx(...) - gets decompressed audio converted to a sample format, interleaved or planar
+    //
+    // The decoding threads convert each frame as they decode it, so the audio never has to be
+    // converted again after it's read; it reads from the same position as GetData(...), but
+    // switching between the two (or changing the format) makes the frames decoded ahead be decoded
+    // again, so it's best to stick to one
+    //
+    // Parameters:
+    //    unsigned char ** apBuffers
+    //        the buffer to put the data into (the first), or when planar one for each channel output
+    //    int64 nBlocks
+    //        the number of audio blocks desired
+    //    int64 * pBlocksRetrieved
+    //        the number of blocks actually retrieved (could be less at end of file or on critical failure)
+    //    const APE_OUTPUT_FORMAT * pFormat
+    //        the format to output
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    struct APE_OUTPUT_FORMAT
+    {
+        int nSampleFormat;      // APE_SAMPLE_FORMAT_INT16, APE_SAMPLE_FORMAT_INT24_IN_INT32, APE_SAMPLE_FORMAT_INT32, or APE_SAMPLE_FORMAT_FLOAT32
+        bool bPlanar;           // each channel goes to a buffer of its own (otherwise they're interleaved in the first)
+        uint32 nChannelMask;    // the channels to output, in order (bit n is channel n), or 0 for all of them
+    };
+    virtual int GetDataEx(unsigned char ** apBuffers, int64 nBlocks, int64 * pBlocksRetrieved, const APE_OUTPUT_FORMAT * pFormat) = 0;
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     // Seek(...) - seeks
     //
@@ -321,6 +360,42 @@ public:
     //////////////////////////////////////////////////////////////////////////////////////////////
     virtual int Seek(int64 nBlockOffset) = 0;
 
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    // LeaseFrameData(...) - gets the rest of the current frame's decompressed audio without copying it
+    //
+    // The buffer belongs to the decompressor and stays valid until the next call to GetData(...),
+    // LeaseFrameData(...), ReleaseFrameData(), or Seek(...); it gets the same processing as GetData(...)
+    // and it's writable (the data won't be read again)
+    //
+    // Parameters:
+    //    unsigned char ** ppBuffer
+    //        receives a pointer to the audio data
+    //    int64 * pBlocksRetrieved
+    //        the number of blocks in the buffer (0 at the end of the file)
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    virtual int LeaseFrameData(unsigned char ** ppBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) = 0;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    // ReleaseFrameData() - hands a leased frame back early so the decompressor can reuse it
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    virtual int ReleaseFrameData() = 0;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    // DecodeFrame(...) - decodes a single frame of the file
+    //
+    // This doesn't use or move the GetData(...) / Seek(...) position, and it can be called from any
+    // number of threads at the same time (frames are independent, so each call decodes on its own)
+    //
+    // Parameters:
+    //    int64 nFrameIndex
+    //        the frame to decode (0 to APE_INFO_TOTAL_FRAMES - 1; ranges are ignored)
+    //    unsigned char * pBuffer
+    //        a buffer that can hold APE_INFO_BLOCKS_PER_FRAME blocks
+    //    int64 * pBlocksRetrieved
+    //        the number of blocks in the frame (0 on failure)
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    virtual int DecodeFrame(int64 nFrameIndex, unsigned char * pBuffer, int64 * pBlocksRetrieved, APE_GET_DATA_PROCESSING * pProcessing = APE_NULL) = 0;
+
     /**************************************************************************************************
     * Get Information
     **************************************************************************************************/
@@ -346,6 +421,38 @@ public:
     // SetNumberOfThreads(...) - sets the number of threads to use for decompressing
     //////////////////////////////////////////////////////////////////////////////////////////////
     virtual int SetNumberOfThreads(int nThreads) = 0;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    // SetFramesInFlight(...) - sets how many frames can be decoding ahead of the reader
+    //
+    // Frames are handed to whichever thread is free, may finish in any order, and are always
+    // returned in order; 0 uses twice the number of threads (it's never less than the threads),
+    // and like the thread count it must be set before the first GetData(...) or Seek(...)
+    //
+    // Parameters:
+    //    int nFrames
+    //        the number of frames (0 for the default)
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    virtual int SetFramesInFlight(int nFrames) = 0;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    // SetDecodeMode(...) - sets how the blocks of a frame are decoded
+    //
+    // Staged decoding range decodes the residuals for every channel, then runs each channel's
+    // prediction over its residuals, then converts the output; on one core the interleaved
+    // default is faster (the stages overlap), so this is for spreading the stages out
+    //
+    // Parallel channels also splits the NN filters (most of the work at Extra High and Insane)
+    // over up to four threads per decoding thread, one or more channels each, which cuts the
+    // time to decode a frame when there are few frames to share out
+    //
+    // Like the thread count it must be set before the first GetData(...) or Seek(...)
+    //
+    // Parameters:
+    //    int nMode
+    //        APE_DECODE_MODE_INTERLEAVED, APE_DECODE_MODE_STAGED, or APE_DECODE_MODE_PARALLEL_CHANNELS
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    virtual int SetDecodeMode(int nMode) = 0;
 };
 
 /**************************************************************************************************
@@ -489,6 +596,22 @@ public:
     // SetNumberOfThreads(...) - sets the number of threads to use for compressing
     //////////////////////////////////////////////////////////////////////////////////////////////
     virtual int SetNumberOfThreads(int nThreads) = 0;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    // SetEncodeMode(...) - sets how the blocks of a frame are encoded
+    //
+    // Parallel channels runs the prediction for each channel (nearly all the work) on up to four
+    // threads per encoding thread, a few thousand blocks at a time, then range codes the results
+    // in the usual order; the output is identical, but a frame is encoded sooner, which helps when
+    // there are fewer frames in flight than cores (like a single file at Insane)
+    //
+    // It must be set before Start(...)
+    //
+    // Parameters:
+    //    int nMode
+    //        APE_ENCODE_MODE_INTERLEAVED or APE_ENCODE_MODE_PARALLEL_CHANNELS
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    virtual int SetEncodeMode(int nMode) = 0;
 };
 
 } // namespace APE
@@ -552,4 +675,16 @@ extern "C"
     DLLEXPORT int __stdcall GetAPEFileType(const APE::str_utfn * pInputFilename, APE::str_ansi cFileType[8]);
     DLLEXPORT void __stdcall GetAPECompressionLevelName(int nCompressionLevel, APE::str_utfn * pCompressionLevel, size_t nBufferCharacters, bool bTitleCase);
     DLLEXPORT void __stdcall GetAPEModeName(APE::APE_MODES Mode, APE::str_utfn * pModeName, size_t nBufferCharacters, bool bActive);
+
+    // threading (once the shared worker pool is enabled, encoders and decoders created afterwards run their
+    // frames on it instead of starting their own threads; SetNumberOfThreads(...) then sets how many frames
+    // each object keeps in flight; the pool can grow but never shrinks; returns the threads in the pool)
+    DLLEXPORT int __stdcall SetSharedWorkerPoolThreads(int nThreads);
+
+    // memory mapped input (files opened read-only to be read whole that are at least this many bytes are
+    // mapped instead of read into memory; -1, the default, never maps, and 0 maps every file; only opt in
+    // for files nothing else will truncate while they're open, since reading a truncated mapping raises
+    // SIGBUS on POSIX or an access violation on Windows; set it before opening files; returns the previous
+    // threshold)
+    DLLEXPORT APE::int64 __stdcall SetMappedFileThreshold(APE::int64 nBytes);
 }
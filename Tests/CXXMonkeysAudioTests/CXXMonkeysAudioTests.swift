@@ -1,12 +1,63 @@
 import XCTest
-//@testable import MAC
+import MACTestSupport
 
+// each check encodes generated audio, decodes it again, and returns the number of mismatches
+// (which it also prints)
 final class CXXMonkeysAudioTests: XCTestCase {
-    func testExample() throws {
-        // XCTest Documentation
-        // https://developer.apple.com/documentation/xctest
+    func testDecodeAcrossThreadsAndFramesInFlight() throws {
+        XCTAssertEqual(MACTestDecodeAcrossThreadsAndFramesInFlight(), 0)
+    }
+
+    func testEncodeAcrossThreads() throws {
+        XCTAssertEqual(MACTestEncodeAcrossThreads(), 0)
+    }
+
+    func testLeaseFrameData() throws {
+        XCTAssertEqual(MACTestLeaseFrameData(), 0)
+    }
+
+    func testDecodeFrameWhileGettingData() throws {
+        XCTAssertEqual(MACTestDecodeFrameWhileGettingData(), 0)
+    }
+
+    func testDecodeFrameBadCompressionLevel() throws {
+        XCTAssertEqual(MACTestDecodeFrameBadCompressionLevel(), 0)
+    }
+
+    func testSeekWhileFramesAreDecoding() throws {
+        XCTAssertEqual(MACTestSeekWhileFramesAreDecoding(), 0)
+    }
+
+    func testSeekWithinFrames() throws {
+        XCTAssertEqual(MACTestSeekWithinFrames(), 0)
+    }
+
+    func testDecodeStaged() throws {
+        XCTAssertEqual(MACTestDecodeStaged(), 0)
+    }
+
+    func testDecodeParallelChannels() throws {
+        XCTAssertEqual(MACTestDecodeParallelChannels(), 0)
+    }
+
+    func testDecodeReadWholeFile() throws {
+        XCTAssertEqual(MACTestDecodeReadWholeFile(), 0)
+    }
+
+    func testEncodeParallelChannels() throws {
+        XCTAssertEqual(MACTestEncodeParallelChannels(), 0)
+    }
+
+    func testGetDataExFormats() throws {
+        XCTAssertEqual(MACTestGetDataExFormats(), 0)
+    }
+
+    func testOutputProcessing() throws {
+        XCTAssertEqual(MACTestOutputProcessing(), 0)
+    }
 
-        // Defining Test Cases and Test Methods
-        // https://developer.apple.com/documentation/xctest/defining_test_cases_and_test_methods
+    // XCTest runs the tests in name order, so this starts the shared pool after the others have run
+    func testZWorkerPool() throws {
+        XCTAssertEqual(MACTestWorkerPool(), 0)
     }
 }
@@ -0,0 +1,310 @@
+#include "TestSupport.h"
+#include "MACTestSupport.h"
+#include <stdio.h>
+
+using namespace APE;
+
+/**************************************************************************************************
+Decoding window
+**************************************************************************************************/
+int MACTestDecodeAcrossThreadsAndFramesInFlight(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile File("decode");
+        if (Encode(Audio, File.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        // frames in flight are never fewer than the threads (0 is the default, twice the threads)
+        const int aryThreads[] = { 1, 3 };
+        const int aryFramesInFlight[] = { 0, 1, 5 };
+        for (int nThreads = 0; nThreads < 2; nThreads++)
+        {
+            for (int nFrames = 0; nFrames < 3; nFrames++)
+                nFailures += CheckDecode(Audio, File.GetName(), aryThreads[nThreads], aryFramesInFlight[nFrames], APE_DECODE_MODE_INTERLEAVED);
+        }
+    }
+    return nFailures;
+}
+
+/**************************************************************************************************
+Leasing frames
+**************************************************************************************************/
+static int CheckLease(const CTestAudio & Audio, IAPEDecompress * pDecompress, int64 nStart, const char * pWhat)
+{
+    // lease from nStart to the end of the file, handing every third lease back early and reading some
+    // pieces with GetData(...) in between, so leases start part way through frames too
+    if (pDecompress->Seek(nStart) != ERROR_SUCCESS)
+        return 1;
+
+    CSmartPtr<unsigned char> spBuffer(new unsigned char [static_cast<size_t>(1000 * Audio.m_nBlockAlign)], true);
+    int64 nPosition = nStart;
+    for (int nLease = 0; ; nLease++)
+    {
+        int64 nRetrieved = 0;
+        if ((nLease % 4) == 3)
+        {
+            if ((pDecompress->GetData(spBuffer, 1000, &nRetrieved) != ERROR_SUCCESS) || (CheckBlocks(Audio, nPosition, spBuffer, nRetrieved, pWhat) != 0))
+                return 1;
+            nPosition += nRetrieved;
+            continue;
+        }
+
+        unsigned char * pBuffer = APE_NULL;
+        const int nResult = pDecompress->LeaseFrameData(&pBuffer, &nRetrieved);
+        if (nResult != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: %s: LeaseFrameData at %lld returned %d\n", Audio.m_Audio.pName, pWhat, static_cast<long long>(nPosition), nResult);
+            return 1;
+        }
+        if (nRetrieved == 0)
+            break;
+        if (CheckBlocks(Audio, nPosition, pBuffer, nRetrieved, pWhat) != 0)
+            return 1;
+        nPosition += nRetrieved;
+
+        if ((nLease % 3) == 2)
+            pDecompress->ReleaseFrameData();
+    }
+
+    if (nPosition != Audio.m_Audio.nBlocks)
+    {
+        fprintf(stderr, "%s: %s: leasing stopped at %lld\n", Audio.m_Audio.pName, pWhat, static_cast<long long>(nPosition));
+        return 1;
+    }
+    return 0;
+}
+
+int MACTestLeaseFrameData(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile File("lease");
+        if (Encode(Audio, File.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        const int aryThreads[] = { 1, 3 };
+        for (int nThreads = 0; nThreads < 2; nThreads++)
+        {
+            char cWhat[64];
+            snprintf(cWhat, sizeof(cWhat), "leasing with %d threads", aryThreads[nThreads]);
+
+            CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(File.GetName(), aryThreads[nThreads]));
+            if (spDecompress == APE_NULL)
+            {
+                nFailures++;
+                continue;
+            }
+
+            // from the start, and from part way into the first frame after a read
+            const int64 nBlocksPerFrame = spDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCKS_PER_FRAME);
+            nFailures += CheckLease(Audio, spDecompress, 0, cWhat);
+            nFailures += CheckGetData(Audio, spDecompress, 100, 5000, 5000, cWhat);
+            nFailures += CheckLease(Audio, spDecompress, APE_MIN(nBlocksPerFrame / 3, Audio.m_Audio.nBlocks / 2), cWhat);
+        }
+    }
+    return nFailures;
+}
+
+/**************************************************************************************************
+Seeking while frames are decoding
+**************************************************************************************************/
+int MACTestSeekWhileFramesAreDecoding(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile File("seek");
+        if (Encode(Audio, File.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        // a short read starts a window of frames, and the seek after it cancels the ones still decoding
+        const int aryThreads[] = { 1, 3 };
+        for (int nThreads = 0; nThreads < 2; nThreads++)
+        {
+            CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(File.GetName(), aryThreads[nThreads], 8));
+            if (spDecompress == APE_NULL)
+            {
+                nFailures++;
+                continue;
+            }
+
+            uint32 nRandom = 777;
+            for (int nSeek = 0; nSeek < 12; nSeek++)
+            {
+                nRandom = (nRandom * 1103515245) + 12345;
+                const int64 nStart = static_cast<int64>(nRandom >> 8) % Audio.m_Audio.nBlocks;
+
+                // sometimes seek twice in a row, so the first seek's frames are cancelled before they're read
+                if ((nSeek % 5) == 4)
+                    spDecompress->Seek(Audio.m_Audio.nBlocks - nStart - 1);
+
+                nFailures += CheckGetData(Audio, spDecompress, nStart, 1 + (nRandom % 3000), 1000, "reading after a seek while frames are decoding");
+            }
+        }
+    }
+    return nFailures;
+}
+
+/**************************************************************************************************
+Seeking within frames
+**************************************************************************************************/
+int MACTestSeekWithinFrames(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile File("seekwithin");
+        if (Encode(Audio, File.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        const int aryThreads[] = { 1, 2 };
+        for (int nThreads = 0; nThreads < 2; nThreads++)
+        {
+            CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(File.GetName(), aryThreads[nThreads]));
+            if (spDecompress == APE_NULL)
+            {
+                nFailures++;
+                continue;
+            }
+
+            // around the start and the middle of every frame (the blocks before the seek point are decoded
+            // but not output, so a single block and a longer read both have to line up)
+            const int64 nBlocksPerFrame = spDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCKS_PER_FRAME);
+            for (int64 nFrameStart = 0; nFrameStart < Audio.m_Audio.nBlocks; nFrameStart += nBlocksPerFrame)
+            {
+                const int64 arySeeks[] = { nFrameStart - 1, nFrameStart, nFrameStart + 1, nFrameStart + (nBlocksPerFrame / 2) };
+                for (int nSeek = 0; nSeek < 4; nSeek++)
+                {
+                    if ((arySeeks[nSeek] < 0) || (arySeeks[nSeek] >= Audio.m_Audio.nBlocks))
+                        continue;
+                    nFailures += CheckGetData(Audio, spDecompress, arySeeks[nSeek], 1, 1, "a block after a seek");
+                    nFailures += CheckGetData(Audio, spDecompress, arySeeks[nSeek], 2000, 2000, "blocks after a seek");
+                }
+            }
+
+            // the last block, and past the end (which stops at the last block)
+            nFailures += CheckGetData(Audio, spDecompress, Audio.m_Audio.nBlocks - 1, 100, 100, "the last block");
+
+            CSmartPtr<unsigned char> spBuffer(new unsigned char [static_cast<size_t>(100 * Audio.m_nBlockAlign)], true);
+            int64 nRetrieved = 0;
+            if ((spDecompress->Seek(Audio.m_Audio.nBlocks + 100) != ERROR_SUCCESS) || (spDecompress->GetData(spBuffer, 100, &nRetrieved) != ERROR_SUCCESS) ||
+                (nRetrieved != 1) || (CheckBlocks(Audio, Audio.m_Audio.nBlocks - 1, spBuffer, 1, "seeking past the end") != 0))
+            {
+                fprintf(stderr, "%s: seeking past the end didn't stop at the last block (%lld blocks read)\n", Audio.m_Audio.pName, static_cast<long long>(nRetrieved));
+                nFailures++;
+            }
+        }
+    }
+    return nFailures;
+}
+
+/**************************************************************************************************
+Decode modes
+**************************************************************************************************/
+static int CheckDecodeMode(int nDecodeMode)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile File("decodemode");
+        if (Encode(Audio, File.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        const int aryThreads[] = { 1, 3 };
+        const int aryFramesInFlight[] = { 0, 5 };
+        for (int nThreads = 0; nThreads < 2; nThreads++)
+        {
+            for (int nFrames = 0; nFrames < 2; nFrames++)
+                nFailures += CheckDecode(Audio, File.GetName(), aryThreads[nThreads], aryFramesInFlight[nFrames], nDecodeMode);
+        }
+
+        // leasing from part way into a frame
+        CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(File.GetName(), 2, 0, nDecodeMode));
+        if (spDecompress == APE_NULL)
+            nFailures++;
+        else
+            nFailures += CheckLease(Audio, spDecompress, Audio.m_Audio.nBlocks / 3, "leasing");
+    }
+    return nFailures;
+}
+
+int MACTestDecodeStaged(void)
+{
+    return CheckDecodeMode(APE_DECODE_MODE_STAGED);
+}
+
+int MACTestDecodeParallelChannels(void)
+{
+    return CheckDecodeMode(APE_DECODE_MODE_PARALLEL_CHANNELS);
+}
+
+/**************************************************************************************************
+Input
+**************************************************************************************************/
+static int CheckReadWholeFile(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile File("input");
+        if (Encode(Audio, File.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        // frames are decoded in place from the file in memory
+        nFailures += CheckDecode(Audio, File.GetName(), 1, 0, APE_DECODE_MODE_INTERLEAVED, true);
+        nFailures += CheckDecode(Audio, File.GetName(), 3, 5, APE_DECODE_MODE_INTERLEAVED, true);
+        nFailures += CheckDecode(Audio, File.GetName(), 3, 0, APE_DECODE_MODE_STAGED, true);
+
+        // leasing (the leased frames can point into the file)
+        CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(File.GetName(), 2, 0, APE_DECODE_MODE_INTERLEAVED, true));
+        if (spDecompress == APE_NULL)
+            nFailures++;
+        else
+            nFailures += CheckLease(Audio, spDecompress, Audio.m_Audio.nBlocks / 3, "leasing the whole file");
+    }
+    return nFailures;
+}
+
+int MACTestDecodeReadWholeFile(void)
+{
+    // the small files are read into memory, then mapped
+    const int64 nOldThreshold = SetMappedFileThreshold(-1);
+    int nFailures = CheckReadWholeFile();
+    SetMappedFileThreshold(0);
+    nFailures += CheckReadWholeFile();
+    SetMappedFileThreshold(nOldThreshold);
+    return nFailures;
+}
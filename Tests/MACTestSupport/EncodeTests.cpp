@@ -0,0 +1,56 @@
+#include "TestSupport.h"
+#include "MACTestSupport.h"
+#include <stdio.h>
+
+using namespace APE;
+
+/**************************************************************************************************
+Encoding queue
+**************************************************************************************************/
+int MACTestEncodeAcrossThreads(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        // the reference is one thread, and it has to decode to the source
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile Reference("encode-reference");
+        if ((Encode(Audio, Reference.GetName()) != ERROR_SUCCESS) || (CheckDecode(Audio, Reference.GetName(), 1, 0, APE_DECODE_MODE_INTERLEAVED) != 0))
+        {
+            fprintf(stderr, "%s: encoding the reference failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        // frames are committed in order however many are encoding at once
+        const int aryThreads[] = { 2, 4, 7 };
+        for (int nThreads = 0; nThreads < 3; nThreads++)
+            nFailures += CheckEncode(Audio, Reference, aryThreads[nThreads], APE_ENCODE_MODE_INTERLEAVED);
+    }
+    return nFailures;
+}
+
+/**************************************************************************************************
+Encode modes
+**************************************************************************************************/
+int MACTestEncodeParallelChannels(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile Reference("encode-reference");
+        if (Encode(Audio, Reference.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding the reference failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        // predicting the channels on separate threads doesn't change the file
+        const int aryThreads[] = { 1, 2, 4 };
+        for (int nThreads = 0; nThreads < 3; nThreads++)
+            nFailures += CheckEncode(Audio, Reference, aryThreads[nThreads], APE_ENCODE_MODE_PARALLEL_CHANNELS);
+    }
+    return nFailures;
+}
@@ -0,0 +1,346 @@
+#include "TestSupport.h"
+#include "MACTestSupport.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+using namespace APE;
+
+/**************************************************************************************************
+Output formats
+**************************************************************************************************/
+static void GetReferenceSample(const CTestAudio & Audio, int64 nBlock, int nChannel, int nSampleFormat, unsigned char * pOutput)
+{
+    // the source sample in the output format (integers are scaled to 32 bits and shifted down or
+    // scaled to a float, and floats are rounded and clipped to integers)
+    const unsigned char * pSample = &Audio.m_spPCM[(nBlock * Audio.m_nBlockAlign) + (nChannel * Audio.m_nBytesPerSample)];
+    if (Audio.m_Audio.bFloat)
+    {
+        float fValue;
+        memcpy(&fValue, pSample, 4);
+        if (nSampleFormat == APE_SAMPLE_FORMAT_FLOAT32)
+        {
+            memcpy(pOutput, &fValue, 4);
+            return;
+        }
+
+        const int nBits = (nSampleFormat == APE_SAMPLE_FORMAT_INT16) ? 16 : ((nSampleFormat == APE_SAMPLE_FORMAT_INT24_IN_INT32) ? 24 : 32);
+        const double dMaximum = static_cast<double>((static_cast<int64>(1) << (nBits - 1)) - 1);
+        double dValue = floor(static_cast<double>(fValue) * (dMaximum + 1) + 0.5);
+        dValue = APE_MIN(dValue, dMaximum);
+        dValue = APE_MAX(dValue, -dMaximum - 1);
+        if (nBits == 16)
+        {
+            const int16 nValue = static_cast<int16>(dValue);
+            memcpy(pOutput, &nValue, 2);
+        }
+        else
+        {
+            const int32 nValue = static_cast<int32>(dValue);
+            memcpy(pOutput, &nValue, 4);
+        }
+        return;
+    }
+
+    int64 nValue = 0;
+    if (Audio.m_nBytesPerSample == 1)
+    {
+        nValue = static_cast<int>(pSample[0]) - 128;
+    }
+    else
+    {
+        for (int z = 0; z < Audio.m_nBytesPerSample; z++)
+            nValue |= static_cast<int64>(pSample[z]) << (z * 8);
+        nValue = (nValue << (64 - Audio.m_Audio.nBitsPerSample)) >> (64 - Audio.m_Audio.nBitsPerSample);
+    }
+
+    const int64 nFullScale = nValue << (32 - Audio.m_Audio.nBitsPerSample);
+    if (nSampleFormat == APE_SAMPLE_FORMAT_INT16)
+    {
+        const int16 nOutput = static_cast<int16>(nFullScale >> 16);
+        memcpy(pOutput, &nOutput, 2);
+    }
+    else if (nSampleFormat == APE_SAMPLE_FORMAT_INT24_IN_INT32)
+    {
+        const int32 nOutput = static_cast<int32>(nFullScale >> 8);
+        memcpy(pOutput, &nOutput, 4);
+    }
+    else if (nSampleFormat == APE_SAMPLE_FORMAT_INT32)
+    {
+        const int32 nOutput = static_cast<int32>(nFullScale);
+        memcpy(pOutput, &nOutput, 4);
+    }
+    else
+    {
+        const float fOutput = static_cast<float>(static_cast<double>(nFullScale) / 2147483648.0);
+        memcpy(pOutput, &fOutput, 4);
+    }
+}
+
+static int CheckGetDataEx(const CTestAudio & Audio, IAPEDecompress * pDecompress, int64 nStart, int64 nBlocks, const IAPEDecompress::APE_OUTPUT_FORMAT & Format)
+{
+    const uint32 nChannelMask = (Format.nChannelMask != 0) ? Format.nChannelMask : ((static_cast<uint32>(1) << Audio.m_Audio.nChannels) - 1);
+    int aryChannels[32];
+    int nChannels = 0;
+    for (int nChannel = 0; nChannel < Audio.m_Audio.nChannels; nChannel++)
+    {
+        if (nChannelMask & (static_cast<uint32>(1) << nChannel))
+            aryChannels[nChannels++] = nChannel;
+    }
+
+    // one buffer, or one for each channel (a little bigger than needed, to catch overruns)
+    const int nBytesPerSample = (Format.nSampleFormat == APE_SAMPLE_FORMAT_INT16) ? 2 : 4;
+    const int64 nPieceBlocks = 5003;
+    const int nBuffers = Format.bPlanar ? nChannels : 1;
+    const int64 nBufferBytes = (Format.bPlanar ? nPieceBlocks : nPieceBlocks * nChannels) * nBytesPerSample;
+    CSmartPtr<unsigned char> spBuffers(new unsigned char [static_cast<size_t>((nBufferBytes + 16) * nBuffers)], true);
+    unsigned char * apBuffers[32];
+    for (int z = 0; z < nBuffers; z++)
+        apBuffers[z] = &spBuffers[(nBufferBytes + 16) * z];
+
+    char cWhat[128];
+    snprintf(cWhat, sizeof(cWhat), "GetDataEx format %d, %s, mask 0x%x", Format.nSampleFormat, Format.bPlanar ? "planar" : "interleaved", static_cast<unsigned int>(Format.nChannelMask));
+
+    if (pDecompress->Seek(nStart) != ERROR_SUCCESS)
+        return 1;
+
+    const int64 nFinish = APE_MIN(nStart + nBlocks, Audio.m_Audio.nBlocks);
+    int64 nPosition = nStart;
+    while (nPosition < nFinish)
+    {
+        memset(spBuffers, 0xCD, static_cast<size_t>((nBufferBytes + 16) * nBuffers));
+
+        int64 nRetrieved = 0;
+        const int nResult = pDecompress->GetDataEx(apBuffers, APE_MIN(nPieceBlocks, nFinish - nPosition), &nRetrieved, &Format);
+        if ((nResult != ERROR_SUCCESS) || (nRetrieved <= 0))
+        {
+            fprintf(stderr, "%s: %s: returned %d with %lld blocks at %lld\n", Audio.m_Audio.pName, cWhat, nResult, static_cast<long long>(nRetrieved), static_cast<long long>(nPosition));
+            return 1;
+        }
+
+        for (int64 nBlock = 0; nBlock < nRetrieved; nBlock++)
+        {
+            for (int nOutput = 0; nOutput < nChannels; nOutput++)
+            {
+                unsigned char cReference[4];
+                GetReferenceSample(Audio, nPosition + nBlock, aryChannels[nOutput], Format.nSampleFormat, cReference);
+                const unsigned char * pSample = Format.bPlanar ? &apBuffers[nOutput][nBlock * nBytesPerSample] : &apBuffers[0][((nBlock * nChannels) + nOutput) * nBytesPerSample];
+                if (memcmp(pSample, cReference, static_cast<size_t>(nBytesPerSample)) != 0)
+                {
+                    fprintf(stderr, "%s: %s: block %lld, channel %d doesn't match\n", Audio.m_Audio.pName, cWhat, static_cast<long long>(nPosition + nBlock), aryChannels[nOutput]);
+                    return 1;
+                }
+            }
+        }
+
+        // nothing is written past the blocks retrieved
+        for (int z = 0; z < nBuffers; z++)
+        {
+            const int64 nUsedBytes = (Format.bPlanar ? nRetrieved : nRetrieved * nChannels) * nBytesPerSample;
+            if (apBuffers[z][nUsedBytes] != 0xCD)
+            {
+                fprintf(stderr, "%s: %s: buffer %d was overrun at %lld\n", Audio.m_Audio.pName, cWhat, z, static_cast<long long>(nPosition));
+                return 1;
+            }
+        }
+
+        nPosition += nRetrieved;
+    }
+    return 0;
+}
+
+int MACTestGetDataExFormats(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile File("getdataex");
+        if (Encode(Audio, File.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        const int aryModes[] = { APE_DECODE_MODE_INTERLEAVED, APE_DECODE_MODE_PARALLEL_CHANNELS };
+        for (int nMode = 0; nMode < 2; nMode++)
+        {
+            CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(File.GetName(), 2, 0, aryModes[nMode]));
+            if (spDecompress == APE_NULL)
+            {
+                nFailures++;
+                continue;
+            }
+            const int64 nBlocksPerFrame = spDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCKS_PER_FRAME);
+
+            // every channel, and some of them (every other one, or all but the first)
+            const uint32 nAllChannels = (static_cast<uint32>(1) << Audio.m_Audio.nChannels) - 1;
+            uint32 aryMasks[2] = { 0, nAllChannels & 0x55555555 };
+            if ((aryMasks[1] == nAllChannels) && (Audio.m_Audio.nChannels > 1))
+                aryMasks[1] = nAllChannels & ~static_cast<uint32>(1);
+
+            for (int nSampleFormat = APE_SAMPLE_FORMAT_INT16; nSampleFormat <= APE_SAMPLE_FORMAT_FLOAT32; nSampleFormat++)
+            {
+                for (int nPlanar = 0; nPlanar < 2; nPlanar++)
+                {
+                    for (int nMask = 0; nMask < 2; nMask++)
+                    {
+                        // across a frame boundary, from a seek
+                        IAPEDecompress::APE_OUTPUT_FORMAT Format = { nSampleFormat, nPlanar != 0, aryMasks[nMask] };
+                        nFailures += CheckGetDataEx(Audio, spDecompress, nBlocksPerFrame - 12345 - (nSampleFormat * 7), 30000, Format);
+                    }
+                }
+            }
+
+            // a bad format is refused
+            unsigned char cBuffer[64];
+            unsigned char * apBuffers[1] = { cBuffer };
+            int64 nRetrieved = 0;
+            IAPEDecompress::APE_OUTPUT_FORMAT BadFormat = { 9, false, 0 };
+            IAPEDecompress::APE_OUTPUT_FORMAT BadMask = { APE_SAMPLE_FORMAT_INT16, false, nAllChannels + 1 };
+            if ((spDecompress->GetDataEx(apBuffers, 1, &nRetrieved, &BadFormat) != ERROR_BAD_PARAMETER) ||
+                (spDecompress->GetDataEx(apBuffers, 1, &nRetrieved, &BadMask) != ERROR_BAD_PARAMETER))
+            {
+                fprintf(stderr, "%s: GetDataEx took a bad format\n", Audio.m_Audio.pName);
+                nFailures++;
+            }
+        }
+    }
+    return nFailures;
+}
+
+/**************************************************************************************************
+Output processing
+**************************************************************************************************/
+static int CheckProcessedBlocks(const CTestAudio & Audio, int64 nStart, const unsigned char * pData, int64 nBlocks, bool bProcessed, int nFlags, const char * pWhat)
+{
+    // the source, with the bytes of each sample swapped for big endian files and the top bit flipped
+    // for signed 8-bit files when the processing is applied
+    CSmartPtr<unsigned char> spExpected(new unsigned char [static_cast<size_t>(nBlocks * Audio.m_nBlockAlign + 1)], true);
+    memcpy(spExpected, &Audio.m_spPCM[nStart * Audio.m_nBlockAlign], static_cast<size_t>(nBlocks * Audio.m_nBlockAlign));
+    const int64 nSamples = nBlocks * Audio.m_Audio.nChannels;
+    if (bProcessed && (nFlags & APE_FORMAT_FLAG_SIGNED_8_BIT) && (Audio.m_nBytesPerSample == 1))
+    {
+        for (int64 nSample = 0; nSample < nSamples; nSample++)
+            spExpected[nSample] ^= 0x80;
+    }
+    if (bProcessed && (nFlags & APE_FORMAT_FLAG_BIG_ENDIAN) && (Audio.m_nBytesPerSample > 1))
+    {
+        for (int64 nSample = 0; nSample < nSamples; nSample++)
+        {
+            unsigned char * pSample = &spExpected[nSample * Audio.m_nBytesPerSample];
+            for (int nByte = 0; nByte < Audio.m_nBytesPerSample / 2; nByte++)
+            {
+                const unsigned char cTemp = pSample[nByte];
+                pSample[nByte] = pSample[Audio.m_nBytesPerSample - 1 - nByte];
+                pSample[Audio.m_nBytesPerSample - 1 - nByte] = cTemp;
+            }
+        }
+    }
+
+    for (int64 nBlock = 0; nBlock < nBlocks; nBlock++)
+    {
+        if (memcmp(&pData[nBlock * Audio.m_nBlockAlign], &spExpected[nBlock * Audio.m_nBlockAlign], static_cast<size_t>(Audio.m_nBlockAlign)) != 0)
+        {
+            fprintf(stderr, "%s: %s (%s): block %lld doesn't match\n", Audio.m_Audio.pName, pWhat, bProcessed ? "processed" : "not processed", static_cast<long long>(nStart + nBlock));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int CheckProcessing(const CTestAudio & Audio, const str_utfn * pFilename, int nFlags, int nDecodeMode)
+{
+    CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(pFilename, 2, 0, nDecodeMode));
+    if (spDecompress == APE_NULL)
+        return 1;
+    if ((spDecompress->GetInfo(IAPEDecompress::APE_INFO_FORMAT_FLAGS) & nFlags) != nFlags)
+    {
+        fprintf(stderr, "%s: the format flags weren't stored\n", Audio.m_Audio.pName);
+        return 1;
+    }
+
+    // the default is to apply the processing, and reads can turn it off and on again part way through frames
+    // (the odd piece sizes leave tails the vector code doesn't cover)
+    IAPEDecompress::APE_GET_DATA_PROCESSING Processed = { true, true, true };
+    IAPEDecompress::APE_GET_DATA_PROCESSING NotProcessed = { true, false, false };
+    IAPEDecompress::APE_GET_DATA_PROCESSING * aryProcessing[3] = { APE_NULL, &NotProcessed, &Processed };
+    const int64 aryPieceBlocks[] = { 10007, 1, 4099, 7, 33 };
+    CSmartPtr<unsigned char> spBuffer(new unsigned char [static_cast<size_t>(TEST_NORMAL_BLOCKS_PER_FRAME * Audio.m_nBlockAlign)], true);
+    int64 nPosition = 0;
+    for (int nRead = 0; nPosition < Audio.m_Audio.nBlocks; nRead++)
+    {
+        IAPEDecompress::APE_GET_DATA_PROCESSING * pProcessing = aryProcessing[nRead % 3];
+        int64 nRetrieved = 0;
+        if ((spDecompress->GetData(spBuffer, aryPieceBlocks[nRead % 5], &nRetrieved, pProcessing) != ERROR_SUCCESS) || (nRetrieved <= 0))
+        {
+            fprintf(stderr, "%s: GetData with processing failed at %lld\n", Audio.m_Audio.pName, static_cast<long long>(nPosition));
+            return 1;
+        }
+        if (CheckProcessedBlocks(Audio, nPosition, spBuffer, nRetrieved, pProcessing != &NotProcessed, nFlags, "GetData") != 0)
+            return 1;
+        nPosition += nRetrieved;
+    }
+
+    // leasing from part way into a frame to the end, switching the processing each lease
+    int nFailures = 0;
+    const int64 nBlocksPerFrame = spDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCKS_PER_FRAME);
+    nPosition = APE_MIN(nBlocksPerFrame / 2, Audio.m_Audio.nBlocks / 2) + 3;
+    if (spDecompress->Seek(nPosition) != ERROR_SUCCESS)
+        return 1;
+    for (int nLease = 0; nPosition < Audio.m_Audio.nBlocks; nLease++)
+    {
+        IAPEDecompress::APE_GET_DATA_PROCESSING * pProcessing = aryProcessing[(nLease + 1) % 3];
+        unsigned char * pBuffer = APE_NULL;
+        int64 nRetrieved = 0;
+        if ((spDecompress->LeaseFrameData(&pBuffer, &nRetrieved, pProcessing) != ERROR_SUCCESS) || (nRetrieved <= 0))
+        {
+            fprintf(stderr, "%s: LeaseFrameData with processing failed at %lld\n", Audio.m_Audio.pName, static_cast<long long>(nPosition));
+            return 1;
+        }
+        nFailures += CheckProcessedBlocks(Audio, nPosition, pBuffer, nRetrieved, pProcessing != &NotProcessed, nFlags, "LeaseFrameData");
+        nPosition += nRetrieved;
+    }
+
+    // decoding the last frame both ways
+    const int64 nLastFrame = spDecompress->GetInfo(IAPEDecompress::APE_INFO_TOTAL_FRAMES) - 1;
+    for (int nDecode = 0; nDecode < 2; nDecode++)
+    {
+        IAPEDecompress::APE_GET_DATA_PROCESSING * pProcessing = (nDecode == 0) ? &NotProcessed : APE_NULL;
+        int64 nRetrieved = 0;
+        if ((spDecompress->DecodeFrame(nLastFrame, spBuffer, &nRetrieved, pProcessing) != ERROR_SUCCESS) || (nRetrieved != Audio.m_Audio.nBlocks - nLastFrame * nBlocksPerFrame))
+        {
+            fprintf(stderr, "%s: DecodeFrame with processing failed\n", Audio.m_Audio.pName);
+            return 1;
+        }
+        nFailures += CheckProcessedBlocks(Audio, nLastFrame * nBlocksPerFrame, spBuffer, nRetrieved, pProcessing == APE_NULL, nFlags, "DecodeFrame");
+    }
+    return nFailures;
+}
+
+int MACTestOutputProcessing(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        // big endian integers, and signed 8-bit (the samples are encoded as they're given, and the
+        // processing turns them back when they're decoded)
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        if (Audio.m_Audio.bFloat)
+            continue;
+        const int nFlags = (Audio.m_nBytesPerSample == 1) ? APE_FORMAT_FLAG_SIGNED_8_BIT : APE_FORMAT_FLAG_BIG_ENDIAN;
+
+        CTestFile File("processing");
+        if (Encode(Audio, File.GetName(), 1, APE_ENCODE_MODE_INTERLEAVED, nFlags) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        nFailures += CheckProcessing(Audio, File.GetName(), nFlags, APE_DECODE_MODE_INTERLEAVED);
+        nFailures += CheckProcessing(Audio, File.GetName(), nFlags, APE_DECODE_MODE_STAGED);
+    }
+    return nFailures;
+}
@@ -0,0 +1,136 @@
+#include "TestSupport.h"
+#include "MACTestSupport.h"
+#include <stdio.h>
+#include <thread>
+
+using namespace APE;
+
+/**************************************************************************************************
+Random access decoding
+**************************************************************************************************/
+static void DecodeFrames(const CTestAudio * pAudio, IAPEDecompress * pDecompress, int nStartFrame, int * pFailures)
+{
+    // every frame twice, starting at a different frame on each thread
+    const int64 nBlocksPerFrame = pDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCKS_PER_FRAME);
+    const int nFrames = static_cast<int>(pDecompress->GetInfo(IAPEDecompress::APE_INFO_TOTAL_FRAMES));
+    CSmartPtr<unsigned char> spBuffer(new unsigned char [static_cast<size_t>(nBlocksPerFrame * pAudio->m_nBlockAlign)], true);
+
+    for (int z = 0; z < nFrames * 2; z++)
+    {
+        const int nFrame = (nStartFrame + z) % nFrames;
+        int64 nRetrieved = 0;
+        const int nResult = pDecompress->DecodeFrame(nFrame, spBuffer, &nRetrieved);
+        const int64 nExpected = APE_MIN(nBlocksPerFrame, pAudio->m_Audio.nBlocks - (nFrame * nBlocksPerFrame));
+        if ((nResult != ERROR_SUCCESS) || (nRetrieved != nExpected))
+        {
+            fprintf(stderr, "%s: DecodeFrame(%d) returned %d with %lld blocks\n", pAudio->m_Audio.pName, nFrame, nResult, static_cast<long long>(nRetrieved));
+            (*pFailures)++;
+        }
+        else
+        {
+            *pFailures += CheckBlocks(*pAudio, nFrame * nBlocksPerFrame, spBuffer, nRetrieved, "DecodeFrame");
+        }
+    }
+}
+
+int MACTestDecodeFrameWhileGettingData(void)
+{
+    int nFailures = 0;
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile File("decodeframe");
+        if (Encode(Audio, File.GetName()) != ERROR_SUCCESS)
+        {
+            fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(File.GetName(), 2));
+        if (spDecompress == APE_NULL)
+        {
+            nFailures++;
+            continue;
+        }
+
+        // a frame that doesn't exist is refused
+        unsigned char cBuffer[16];
+        int64 nRetrieved = 0;
+        if ((spDecompress->DecodeFrame(-1, cBuffer, &nRetrieved) != ERROR_BAD_PARAMETER) ||
+            (spDecompress->DecodeFrame(spDecompress->GetInfo(IAPEDecompress::APE_INFO_TOTAL_FRAMES), cBuffer, &nRetrieved) != ERROR_BAD_PARAMETER))
+        {
+            fprintf(stderr, "%s: DecodeFrame(...) took a frame outside the file\n", Audio.m_Audio.pName);
+            nFailures++;
+        }
+
+        // DecodeFrame(...) on three threads while this one reads and seeks
+        const int nThreads = 3;
+        int aryFailures[nThreads] = { 0, 0, 0 };
+        std::thread aryThreads[nThreads];
+        for (int z = 0; z < nThreads; z++)
+            aryThreads[z] = std::thread(DecodeFrames, &Audio, spDecompress.GetPtr(), z * 2, &aryFailures[z]);
+
+        const int64 nBlocksPerFrame = spDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCKS_PER_FRAME);
+        nFailures += CheckGetData(Audio, spDecompress, 0, Audio.m_Audio.nBlocks, 4099, "GetData while decoding frames");
+        nFailures += CheckGetData(Audio, spDecompress, APE_MIN(nBlocksPerFrame - 17, Audio.m_Audio.nBlocks / 2), 50000, 4099, "GetData after a seek while decoding frames");
+
+        for (int z = 0; z < nThreads; z++)
+        {
+            aryThreads[z].join();
+            nFailures += aryFailures[z];
+        }
+    }
+    return nFailures;
+}
+
+int MACTestDecodeFrameBadCompressionLevel(void)
+{
+    // a file with a compression level the predictors don't know
+    CTestAudio Audio(g_aryTestAudio[0]);
+    CTestFile File("decodeframe-source");
+    CTestFile BadFile("decodeframe-bad-level");
+    CSmartPtr<unsigned char> spData;
+    int64 nBytes = 0;
+    if ((Encode(Audio, File.GetName()) != ERROR_SUCCESS) || (File.Read(spData, &nBytes) != ERROR_SUCCESS) || (nBytes < 64))
+    {
+        fprintf(stderr, "%s: encoding failed\n", Audio.m_Audio.pName);
+        return 1;
+    }
+
+    // the header (and its compression level) comes right after the descriptor
+    const uint32 nDescriptorBytes = static_cast<uint32>(spData[8]) | (static_cast<uint32>(spData[9]) << 8) | (static_cast<uint32>(spData[10]) << 16) | (static_cast<uint32>(spData[11]) << 24);
+    spData[nDescriptorBytes] = 1500 & 0xFF;
+    spData[nDescriptorBytes + 1] = 1500 >> 8;
+    if (BadFile.Write(spData, nBytes) != ERROR_SUCCESS)
+        return 1;
+
+    CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(BadFile.GetName(), 2));
+    if (spDecompress == APE_NULL)
+    {
+        fprintf(stderr, "%s: opening the file with a bad compression level failed\n", Audio.m_Audio.pName);
+        return 1;
+    }
+
+    // every call fails, including the ones that borrow a decoder that failed to be created before
+    int nFailures = 0;
+    CSmartPtr<unsigned char> spBuffer(new unsigned char [static_cast<size_t>(TEST_NORMAL_BLOCKS_PER_FRAME * Audio.m_nBlockAlign)], true);
+    for (int nCall = 0; nCall < 3; nCall++)
+    {
+        int64 nRetrieved = 0;
+        const int nResult = spDecompress->DecodeFrame(nCall, spBuffer, &nRetrieved);
+        if ((nResult != ERROR_INVALID_INPUT_FILE) || (nRetrieved != 0))
+        {
+            fprintf(stderr, "%s: DecodeFrame(%d) with a bad compression level returned %d with %lld blocks\n", Audio.m_Audio.pName, nCall, nResult, static_cast<long long>(nRetrieved));
+            nFailures++;
+        }
+    }
+
+    int64 nRetrieved = 0;
+    if ((spDecompress->GetData(spBuffer, 1000, &nRetrieved) == ERROR_SUCCESS) && (nRetrieved != 0))
+    {
+        fprintf(stderr, "%s: GetData(...) with a bad compression level returned %lld blocks\n", Audio.m_Audio.pName, static_cast<long long>(nRetrieved));
+        nFailures++;
+    }
+    return nFailures;
+}
@@ -0,0 +1,279 @@
+#include "TestSupport.h"
+#include "MAC/CharacterHelper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+namespace APE
+{
+
+/**************************************************************************************************
+Test audio
+**************************************************************************************************/
+const TEST_AUDIO g_aryTestAudio[] =
+{
+    { "stereo16", 16, 2, false, APE_COMPRESSION_LEVEL_NORMAL, (TEST_NORMAL_BLOCKS_PER_FRAME * 4) + 1234, true },
+    { "mono8", 8, 1, false, APE_COMPRESSION_LEVEL_FAST, (TEST_NORMAL_BLOCKS_PER_FRAME * 2) + 77, false },
+    { "surround24", 24, 6, false, APE_COMPRESSION_LEVEL_HIGH, (TEST_NORMAL_BLOCKS_PER_FRAME * 2) + 4321, false },
+    { "stereo32float", 32, 2, true, APE_COMPRESSION_LEVEL_EXTRA_HIGH, 300000, false },
+    { "mono32", 32, 1, false, APE_COMPRESSION_LEVEL_INSANE, 60000, false },
+};
+
+const int g_nTestAudio = static_cast<int>(sizeof(g_aryTestAudio) / sizeof(g_aryTestAudio[0]));
+
+CTestAudio::CTestAudio(const TEST_AUDIO & Audio)
+    : m_Audio(Audio)
+{
+    m_nBytesPerSample = Audio.nBitsPerSample / 8;
+    m_nBlockAlign = m_nBytesPerSample * Audio.nChannels;
+    m_spPCM.Assign(new unsigned char [static_cast<size_t>(Audio.nBlocks * m_nBlockAlign)], true);
+    Generate();
+}
+
+void CTestAudio::Generate()
+{
+    uint32 nRandom = 12345;
+    for (int64 nBlock = 0; nBlock < m_Audio.nBlocks; nBlock++)
+    {
+        const int64 nFrame = nBlock / TEST_NORMAL_BLOCKS_PER_FRAME;
+        for (int nChannel = 0; nChannel < m_Audio.nChannels; nChannel++)
+        {
+            nRandom = (nRandom * 1103515245) + 12345;
+            double dValue = (0.6 * sin((static_cast<double>(nBlock) * 0.013) + nChannel)) + (static_cast<double>(static_cast<int>((nRandom >> 16) % 2001) - 1000) / 10000.0);
+            if ((nBlock % 5000) == 7)
+                dValue = 1.0;
+            else if ((nBlock % 5000) == 8)
+                dValue = -1.0;
+
+            if (m_Audio.bSpecialFrames && (nFrame == 1))
+                dValue = 0;
+
+            unsigned char * pSample = &m_spPCM[(nBlock * m_nBlockAlign) + (nChannel * m_nBytesPerSample)];
+            if (m_Audio.bSpecialFrames && (nFrame == 2) && (nChannel > 0))
+            {
+                memcpy(pSample, &m_spPCM[nBlock * m_nBlockAlign], static_cast<size_t>(m_nBytesPerSample));
+            }
+            else if (m_Audio.bFloat)
+            {
+                const float fValue = static_cast<float>(dValue * 1.1);
+                memcpy(pSample, &fValue, 4);
+            }
+            else if (m_nBytesPerSample == 1)
+            {
+                pSample[0] = static_cast<unsigned char>(static_cast<int>(dValue * 127) + 128);
+            }
+            else
+            {
+                // little endian, like a WAV
+                const double dMaximum = static_cast<double>((static_cast<int64>(1) << (m_Audio.nBitsPerSample - 1)) - 1);
+                const uint32 nValue = static_cast<uint32>(static_cast<int32>(dValue * dMaximum));
+                for (int z = 0; z < m_nBytesPerSample; z++)
+                    pSample[z] = static_cast<unsigned char>(nValue >> (z * 8));
+            }
+        }
+    }
+}
+
+/**************************************************************************************************
+Test files
+**************************************************************************************************/
+CTestFile::CTestFile(const char * pName)
+{
+    const char * pDirectory = getenv("TMPDIR");
+    if ((pDirectory == APE_NULL) || (pDirectory[0] == 0))
+        pDirectory = "/tmp";
+
+    char cFilename[1024];
+    snprintf(cFilename, sizeof(cFilename), "%s/MACTestSupport-%d-%s.ape", pDirectory, static_cast<int>(getpid()), pName);
+    m_spName.Assign(CAPECharacterHelper::GetUTF16FromANSI(cFilename), true);
+}
+
+CTestFile::~CTestFile()
+{
+    CSmartPtr<str_ansi> spFilename(CAPECharacterHelper::GetANSIFromUTF16(m_spName), true);
+    remove(spFilename);
+}
+
+int CTestFile::Read(CSmartPtr<unsigned char> & spData, int64 * pBytes) const
+{
+    *pBytes = 0;
+    CSmartPtr<str_ansi> spFilename(CAPECharacterHelper::GetANSIFromUTF16(m_spName), true);
+    FILE * pFile = fopen(spFilename, "rb");
+    if (pFile == APE_NULL)
+        return ERROR_INVALID_INPUT_FILE;
+
+    fseek(pFile, 0, SEEK_END);
+    const int64 nBytes = static_cast<int64>(ftell(pFile));
+    fseek(pFile, 0, SEEK_SET);
+    spData.Assign(new unsigned char [static_cast<size_t>(nBytes + 1)], true);
+    const size_t nRead = fread(spData, 1, static_cast<size_t>(nBytes), pFile);
+    fclose(pFile);
+
+    *pBytes = static_cast<int64>(nRead);
+    return (static_cast<int64>(nRead) == nBytes) ? ERROR_SUCCESS : ERROR_IO_READ;
+}
+
+int CTestFile::Write(const unsigned char * pData, int64 nBytes) const
+{
+    CSmartPtr<str_ansi> spFilename(CAPECharacterHelper::GetANSIFromUTF16(m_spName), true);
+    FILE * pFile = fopen(spFilename, "wb");
+    if (pFile == APE_NULL)
+        return ERROR_IO_WRITE;
+
+    const size_t nWritten = fwrite(pData, 1, static_cast<size_t>(nBytes), pFile);
+    fclose(pFile);
+
+    return (static_cast<int64>(nWritten) == nBytes) ? ERROR_SUCCESS : ERROR_IO_WRITE;
+}
+
+/**************************************************************************************************
+Encoding and decoding
+**************************************************************************************************/
+int Encode(const CTestAudio & Audio, const str_utfn * pFilename, int nThreads, int nEncodeMode, int nFlags)
+{
+    WAVEFORMATEX wfeAudio;
+    FillWaveFormatEx(&wfeAudio, Audio.m_Audio.bFloat ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM, 44100, Audio.m_Audio.nBitsPerSample, Audio.m_Audio.nChannels);
+
+    int nErrorCode = ERROR_SUCCESS;
+    CSmartPtr<IAPECompress> spCompress(CreateIAPECompress(&nErrorCode));
+    if (spCompress == APE_NULL)
+        return (nErrorCode != ERROR_SUCCESS) ? nErrorCode : ERROR_UNDEFINED;
+
+    // the setters return the value in use
+    if ((spCompress->SetNumberOfThreads(nThreads) != nThreads) || (spCompress->SetEncodeMode(nEncodeMode) != nEncodeMode))
+        return ERROR_BAD_PARAMETER;
+
+    RETURN_ON_ERROR(spCompress->Start(pFilename, &wfeAudio, Audio.m_Audio.bFloat, MAX_AUDIO_BYTES_UNKNOWN, Audio.m_Audio.nCompressionLevel, APE_NULL, 0, nFlags))
+
+    // added in uneven pieces, so the pieces don't line up with the frames
+    const int64 nBytes = Audio.m_Audio.nBlocks * Audio.m_nBlockAlign;
+    const int64 nPieceBytes = 100003 * static_cast<int64>(Audio.m_nBlockAlign);
+    for (int64 nStart = 0; nStart < nBytes; nStart += nPieceBytes)
+    {
+        const int64 nResult = spCompress->AddData(&Audio.m_spPCM[nStart], APE_MIN(nBytes - nStart, nPieceBytes));
+        if (nResult != ERROR_SUCCESS)
+            return static_cast<int>(nResult);
+    }
+
+    return spCompress->Finish(APE_NULL, 0, 0);
+}
+
+IAPEDecompress * CreateDecompress(const str_utfn * pFilename, int nThreads, int nFramesInFlight, int nDecodeMode, bool bReadWholeFile)
+{
+    int nErrorCode = ERROR_SUCCESS;
+    IAPEDecompress * pDecompress = CreateIAPEDecompress(pFilename, &nErrorCode, true, true, bReadWholeFile);
+    if (pDecompress == APE_NULL)
+        return APE_NULL;
+
+    // the setters return the value in use
+    if ((pDecompress->SetNumberOfThreads(nThreads) != nThreads) ||
+        (pDecompress->SetFramesInFlight(nFramesInFlight) != nFramesInFlight) ||
+        (pDecompress->SetDecodeMode(nDecodeMode) != nDecodeMode))
+    {
+        delete pDecompress;
+        return APE_NULL;
+    }
+    return pDecompress;
+}
+
+/**************************************************************************************************
+Checks
+**************************************************************************************************/
+int CheckBlocks(const CTestAudio & Audio, int64 nStart, const unsigned char * pData, int64 nBlocks, const char * pWhat)
+{
+    if ((nStart < 0) || (nBlocks < 0) || (nStart + nBlocks > Audio.m_Audio.nBlocks))
+    {
+        fprintf(stderr, "%s: %s: blocks %lld to %lld are outside the file\n", Audio.m_Audio.pName, pWhat, static_cast<long long>(nStart), static_cast<long long>(nStart + nBlocks));
+        return 1;
+    }
+
+    if (memcmp(pData, &Audio.m_spPCM[nStart * Audio.m_nBlockAlign], static_cast<size_t>(nBlocks * Audio.m_nBlockAlign)) != 0)
+    {
+        fprintf(stderr, "%s: %s: blocks %lld to %lld don't match\n", Audio.m_Audio.pName, pWhat, static_cast<long long>(nStart), static_cast<long long>(nStart + nBlocks));
+        return 1;
+    }
+    return 0;
+}
+
+int CheckGetData(const CTestAudio & Audio, IAPEDecompress * pDecompress, int64 nStart, int64 nBlocks, int64 nPieceBlocks, const char * pWhat)
+{
+    CSmartPtr<unsigned char> spBuffer(new unsigned char [static_cast<size_t>(nPieceBlocks * Audio.m_nBlockAlign)], true);
+    const int64 nFinish = APE_MIN(nStart + nBlocks, Audio.m_Audio.nBlocks);
+
+    if (pDecompress->Seek(nStart) != ERROR_SUCCESS)
+    {
+        fprintf(stderr, "%s: %s: seek to %lld failed\n", Audio.m_Audio.pName, pWhat, static_cast<long long>(nStart));
+        return 1;
+    }
+
+    int64 nPosition = nStart;
+    while (nPosition < nFinish)
+    {
+        int64 nRetrieved = 0;
+        const int nResult = pDecompress->GetData(spBuffer, APE_MIN(nPieceBlocks, nFinish - nPosition), &nRetrieved);
+        if ((nResult != ERROR_SUCCESS) || (nRetrieved <= 0))
+        {
+            fprintf(stderr, "%s: %s: GetData at %lld returned %d with %lld blocks\n", Audio.m_Audio.pName, pWhat, static_cast<long long>(nPosition), nResult, static_cast<long long>(nRetrieved));
+            return 1;
+        }
+        if (CheckBlocks(Audio, nPosition, spBuffer, nRetrieved, pWhat) != 0)
+            return 1;
+        nPosition += nRetrieved;
+    }
+    return 0;
+}
+
+int CheckDecode(const CTestAudio & Audio, const str_utfn * pFilename, int nThreads, int nFramesInFlight, int nDecodeMode, bool bReadWholeFile)
+{
+    char cWhat[128];
+    snprintf(cWhat, sizeof(cWhat), "%d threads, %d frames in flight, decode mode %d%s", nThreads, nFramesInFlight, nDecodeMode, bReadWholeFile ? ", whole file" : "");
+
+    CSmartPtr<IAPEDecompress> spDecompress(CreateDecompress(pFilename, nThreads, nFramesInFlight, nDecodeMode, bReadWholeFile));
+    if (spDecompress == APE_NULL)
+    {
+        fprintf(stderr, "%s: %s: opening failed\n", Audio.m_Audio.pName, cWhat);
+        return 1;
+    }
+    const int64 nBlocksPerFrame = spDecompress->GetInfo(IAPEDecompress::APE_INFO_BLOCKS_PER_FRAME);
+
+    // the whole file
+    int nFailures = CheckGetData(Audio, spDecompress, 0, Audio.m_Audio.nBlocks, 10007, cWhat);
+
+    // seeks (the reads are cut short, so there are frames in flight at each seek)
+    const int64 arySeeks[] = { nBlocksPerFrame + 5, 3, nBlocksPerFrame - 1, Audio.m_Audio.nBlocks - 1, nBlocksPerFrame * 2, nBlocksPerFrame / 2, 0, Audio.m_Audio.nBlocks - 4000 };
+    for (int nSeek = 0; nSeek < static_cast<int>(sizeof(arySeeks) / sizeof(arySeeks[0])); nSeek++)
+    {
+        if (arySeeks[nSeek] < Audio.m_Audio.nBlocks)
+            nFailures += CheckGetData(Audio, spDecompress, arySeeks[nSeek], 30000, 7001, cWhat);
+    }
+
+    return nFailures;
+}
+
+int CheckEncode(const CTestAudio & Audio, const CTestFile & Reference, int nThreads, int nEncodeMode)
+{
+    CSmartPtr<unsigned char> spReference;
+    int64 nReferenceBytes = 0;
+    if (Reference.Read(spReference, &nReferenceBytes) != ERROR_SUCCESS)
+    {
+        fprintf(stderr, "%s: the reference can't be read\n", Audio.m_Audio.pName);
+        return 1;
+    }
+
+    CTestFile File("encode");
+    CSmartPtr<unsigned char> spData;
+    int64 nBytes = 0;
+    const int nResult = Encode(Audio, File.GetName(), nThreads, nEncodeMode);
+    if ((nResult != ERROR_SUCCESS) || (File.Read(spData, &nBytes) != ERROR_SUCCESS) ||
+        (nBytes != nReferenceBytes) || (memcmp(spData, spReference, static_cast<size_t>(nBytes)) != 0))
+    {
+        fprintf(stderr, "%s: %d threads, encode mode %d: the file differs from the reference (error %d, %lld bytes against %lld)\n",
+            Audio.m_Audio.pName, nThreads, nEncodeMode, nResult, static_cast<long long>(nBytes), static_cast<long long>(nReferenceBytes));
+        return 1;
+    }
+    return 0;
+}
+
+}
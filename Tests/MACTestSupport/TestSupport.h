@@ -0,0 +1,84 @@
+#pragma once
+
+#include "MAC/All.h"
+#include "MAC/MACLib.h"
+
+namespace APE
+{
+
+/**************************************************************************************************
+Test audio
+
+The audio is generated (a tone with noise and some full scale samples), and the stereo file has a
+silent frame and a frame with both channels the same, so the special frame codes get used
+**************************************************************************************************/
+#define TEST_NORMAL_BLOCKS_PER_FRAME 73728
+
+struct TEST_AUDIO
+{
+    const char * pName;
+    int nBitsPerSample;
+    int nChannels;
+    bool bFloat;
+    int nCompressionLevel;
+    int64 nBlocks;
+    bool bSpecialFrames;
+};
+
+extern const TEST_AUDIO g_aryTestAudio[];
+extern const int g_nTestAudio;
+
+class CTestAudio
+{
+public:
+    CTestAudio(const TEST_AUDIO & Audio);
+
+    const TEST_AUDIO & m_Audio;
+    int m_nBytesPerSample;
+    int m_nBlockAlign;
+    CSmartPtr<unsigned char> m_spPCM;
+
+private:
+    void Generate();
+};
+
+/**************************************************************************************************
+Test files (a file in the temporary directory for this process, deleted with the object)
+**************************************************************************************************/
+class CTestFile
+{
+public:
+    CTestFile(const char * pName);
+    ~CTestFile();
+
+    const str_utfn * GetName() const { return m_spName; }
+    int Read(CSmartPtr<unsigned char> & spData, int64 * pBytes) const;
+    int Write(const unsigned char * pData, int64 nBytes) const;
+
+private:
+    CSmartPtr<str_utfn> m_spName;
+};
+
+/**************************************************************************************************
+Encoding and decoding
+**************************************************************************************************/
+int Encode(const CTestAudio & Audio, const str_utfn * pFilename, int nThreads = 1, int nEncodeMode = APE_ENCODE_MODE_INTERLEAVED, int nFlags = 0);
+IAPEDecompress * CreateDecompress(const str_utfn * pFilename, int nThreads, int nFramesInFlight = 0, int nDecodeMode = APE_DECODE_MODE_INTERLEAVED, bool bReadWholeFile = false);
+
+/**************************************************************************************************
+Checks (each returns the number of mismatches, and prints what didn't match)
+**************************************************************************************************/
+// the blocks are the source from nStart
+int CheckBlocks(const CTestAudio & Audio, int64 nStart, const unsigned char * pData, int64 nBlocks, const char * pWhat);
+
+// seeks to nStart and reads nBlocks (or to the end of the file) a piece at a time with GetData(...)
+int CheckGetData(const CTestAudio & Audio, IAPEDecompress * pDecompress, int64 nStart, int64 nBlocks, int64 nPieceBlocks, const char * pWhat);
+
+// opens the file with the settings, reads all of it, then reads after seeks back and forward, into frames and
+// onto their edges
+int CheckDecode(const CTestAudio & Audio, const str_utfn * pFilename, int nThreads, int nFramesInFlight, int nDecodeMode, bool bReadWholeFile = false);
+
+// encodes the audio with the settings and checks the file is the same as the reference, byte for byte
+int CheckEncode(const CTestAudio & Audio, const CTestFile & Reference, int nThreads, int nEncodeMode);
+
+}
@@ -0,0 +1,77 @@
+#include "TestSupport.h"
+#include "MACTestSupport.h"
+#include <stdio.h>
+#include <thread>
+
+using namespace APE;
+
+/**************************************************************************************************
+Shared worker pool
+**************************************************************************************************/
+static void CheckFile(const CTestAudio * pAudio, int * pFailures)
+{
+    char cName[64];
+    snprintf(cName, sizeof(cName), "pool-%s", pAudio->m_Audio.pName);
+    CTestFile File(cName);
+    if (Encode(*pAudio, File.GetName(), 3) != ERROR_SUCCESS)
+    {
+        fprintf(stderr, "%s: encoding on the pool failed\n", pAudio->m_Audio.pName);
+        (*pFailures)++;
+        return;
+    }
+    *pFailures += CheckDecode(*pAudio, File.GetName(), 3, 0, APE_DECODE_MODE_INTERLEAVED);
+    *pFailures += CheckDecode(*pAudio, File.GetName(), 2, 0, APE_DECODE_MODE_PARALLEL_CHANNELS);
+}
+
+int MACTestWorkerPool(void)
+{
+    int nFailures = 0;
+    if (SetSharedWorkerPoolThreads(3) < 3)
+    {
+        fprintf(stderr, "the shared worker pool couldn't be started\n");
+        return 1;
+    }
+
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        // the reference is one frame at a time, and it has to decode to the source
+        CTestAudio Audio(g_aryTestAudio[nAudio]);
+        CTestFile Reference("pool-reference");
+        if ((Encode(Audio, Reference.GetName()) != ERROR_SUCCESS) || (CheckDecode(Audio, Reference.GetName(), 1, 0, APE_DECODE_MODE_INTERLEAVED) != 0))
+        {
+            fprintf(stderr, "%s: encoding the reference on the pool failed\n", Audio.m_Audio.pName);
+            nFailures++;
+            continue;
+        }
+
+        // frames and channels run as pool tasks (the thread count is how many frames are in flight)
+        const int aryThreads[] = { 2, 5 };
+        for (int nThreads = 0; nThreads < 2; nThreads++)
+        {
+            nFailures += CheckEncode(Audio, Reference, aryThreads[nThreads], APE_ENCODE_MODE_INTERLEAVED);
+            nFailures += CheckEncode(Audio, Reference, aryThreads[nThreads], APE_ENCODE_MODE_PARALLEL_CHANNELS);
+            nFailures += CheckDecode(Audio, Reference.GetName(), aryThreads[nThreads], 0, APE_DECODE_MODE_INTERLEAVED);
+            nFailures += CheckDecode(Audio, Reference.GetName(), aryThreads[nThreads], 6, APE_DECODE_MODE_INTERLEAVED);
+            nFailures += CheckDecode(Audio, Reference.GetName(), aryThreads[nThreads], 0, APE_DECODE_MODE_STAGED);
+            nFailures += CheckDecode(Audio, Reference.GetName(), aryThreads[nThreads], 0, APE_DECODE_MODE_PARALLEL_CHANNELS);
+        }
+    }
+
+    // every file encoding and decoding at once, sharing the pool
+    CTestAudio * apAudio[16];
+    std::thread aryThreads[16];
+    int aryFailures[16] = { 0 };
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        apAudio[nAudio] = new CTestAudio(g_aryTestAudio[nAudio]);
+        aryThreads[nAudio] = std::thread(CheckFile, apAudio[nAudio], &aryFailures[nAudio]);
+    }
+    for (int nAudio = 0; nAudio < g_nTestAudio; nAudio++)
+    {
+        aryThreads[nAudio].join();
+        nFailures += aryFailures[nAudio];
+        delete apAudio[nAudio];
+    }
+
+    return nFailures;
+}
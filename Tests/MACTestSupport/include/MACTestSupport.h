@@ -0,0 +1,61 @@
+#pragma once
+
+/**************************************************************************************************
+MACTestSupport - round trip checks of MACLib for the test target
+
+MACLib is C++, so the checks are written against it here and exported as plain C functions the
+Swift tests can call; each encodes generated audio to temporary files, decodes it again, and
+returns 0 if everything matched (otherwise the number of mismatches, which are also printed)
+**************************************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// decoding gives back the source with a range of thread counts and frames in flight, and after seeks
+int MACTestDecodeAcrossThreadsAndFramesInFlight(void);
+
+// LeaseFrameData(...) gives back the source, mixed with GetData(...) and with leases handed back early
+int MACTestLeaseFrameData(void);
+
+// seeking cancels the frames still decoding, and the reads after it give back the source
+int MACTestSeekWhileFramesAreDecoding(void);
+
+// seeking to the edges and middle of frames, and past the end, reads from the right block
+int MACTestSeekWithinFrames(void);
+
+// staged decoding gives back the source with a range of thread counts and frames in flight, and after seeks
+int MACTestDecodeStaged(void);
+
+// the same with the channels' filters running on separate threads
+int MACTestDecodeParallelChannels(void);
+
+// the same reading the file into memory, and mapping it
+int MACTestDecodeReadWholeFile(void);
+
+// DecodeFrame(...) on several threads gives back the source while GetData(...) reads the same file
+int MACTestDecodeFrameWhileGettingData(void);
+
+// DecodeFrame(...) and GetData(...) fail cleanly, every time, on a file the decoder can't be created for
+int MACTestDecodeFrameBadCompressionLevel(void);
+
+// the encoded file is the same byte for byte with any thread count
+int MACTestEncodeAcrossThreads(void);
+
+// the same with the channels predicted on separate threads
+int MACTestEncodeParallelChannels(void);
+
+// GetDataEx(...) gives back the source in every sample format, interleaved and planar, with and
+// without a channel mask
+int MACTestGetDataExFormats(void);
+
+// GetData(...), LeaseFrameData(...) and DecodeFrame(...) swap the bytes of big endian files and flip
+// signed 8-bit files back, and leave them alone when asked
+int MACTestOutputProcessing(void);
+
+// encoding and decoding on the shared worker pool matches the source and the file from one thread,
+// with several files at once (this starts the pool for the rest of the process, so it runs last)
+int MACTestWorkerPool(void);
+
+#ifdef __cplusplus
+}
+#endif